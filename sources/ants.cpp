@@ -1,27 +1,94 @@
 #include "ants.hpp"
 #include "environment.hpp"
 #include "logger.hpp"
-#include <algorithm> // for generate_n
+#include "profiler.hpp"
+#include "snapshot.hpp"
+#include <algorithm> // for any_of, min and max
 #include <array>     // for circles of vision of the ant
 #include <cmath>
+#include <cstdint>
 #include <fstream>   // for ofstream and ifstream
+#include <functional>
+#include <optional>  // for the pheromones sensed
 #include <random>    // for random turning
 #include <stdexcept> // invalid_argument
+#include <thread>    // for hardware_concurrency
+#include <utility>   // for as_const
 
 namespace kape {
+// EnvironmentChanges implementation
+void EnvironmentChanges::clear()
+{
+  pheromone_deposits.clear();
+  food_pickups.clear();
+  food_delivered_to_anthill = 0;
+}
+
 // Ant class implementation
+// the circles of vision are rotated by CIRCLE_OF_VISION_ANGLE, 0 and
+// -CIRCLE_OF_VISION_ANGLE from the direction the ant is facing
+double const SIN_CIRCLE_OF_VISION_ANGLE{std::sin(Ant::CIRCLE_OF_VISION_ANGLE)};
+double const COS_CIRCLE_OF_VISION_ANGLE{std::cos(Ant::CIRCLE_OF_VISION_ANGLE)};
+
+// pointers to the arrays read and written by placeCirclesOfVision()
+struct AntsVision
+{
+  double const* position_x;
+  double const* position_y;
+  double const* velocity_x;
+  double const* velocity_y;
+  // three per ant, see AntsSoA::circles_of_vision_x
+  double* center_x;
+  double* center_y;
+};
+
+// computes the centers of the circles of vision of the ants in [first, last):
+// it's the kernel of both Ant::calculateCirclesOfVision() and
+// AntsSoA::updateCirclesOfVision(). The operations are the same as
+// normalize() and rotate(), but the loop has no calls and no branches, so
+// that the compiler can vectorise it
+void placeCirclesOfVision(AntsVision const& ants, std::size_t first,
+                          std::size_t last)
+{
+  double const sin_angle{SIN_CIRCLE_OF_VISION_ANGLE};
+  double const cos_angle{COS_CIRCLE_OF_VISION_ANGLE};
+  double const distance{Ant::CIRCLE_OF_VISION_DISTANCE};
+
+  for (std::size_t i{first}; i < last; ++i) {
+    // note: velocity can't be null for class invariant
+    double const inverse_speed{
+        1. / std::sqrt(ants.velocity_x[i] * ants.velocity_x[i]
+                       + ants.velocity_y[i] * ants.velocity_y[i])};
+    double const direction_x{inverse_speed * ants.velocity_x[i]};
+    double const direction_y{inverse_speed * ants.velocity_y[i]};
+
+    double const left_x{direction_x * cos_angle - direction_y * sin_angle};
+    double const left_y{direction_x * sin_angle + direction_y * cos_angle};
+    double const right_x{direction_x * cos_angle - direction_y * -sin_angle};
+    double const right_y{direction_x * -sin_angle + direction_y * cos_angle};
+
+    ants.center_x[3 * i]     = ants.position_x[i] + distance * left_x;
+    ants.center_y[3 * i]     = ants.position_y[i] + distance * left_y;
+    ants.center_x[3 * i + 1] = ants.position_x[i] + distance * direction_x;
+    ants.center_y[3 * i + 1] = ants.position_y[i] + distance * direction_y;
+    ants.center_x[3 * i + 2] = ants.position_x[i] + distance * right_x;
+    ants.center_y[3 * i + 2] = ants.position_y[i] + distance * right_y;
+  }
+}
+
 void Ant::calculateCirclesOfVision(
     std::array<Circle, 3>& circles_of_vision) const
 {
-  // note: velocity can't be null for class invariant
-  Vector2d facing_dir{velocity_ / norm(velocity_)};
+  std::array<double, 3> center_x;
+  std::array<double, 3> center_y;
+  placeCirclesOfVision(AntsVision{&position_.x, &position_.y, &velocity_.x,
+                                  &velocity_.y, center_x.data(),
+                                  center_y.data()},
+                       0, 1);
 
-  double angle{CIRCLE_OF_VISION_ANGLE};
-  for (auto& cov : circles_of_vision) {
-    cov.setCircleRadius(CIRCLE_OF_VISION_RADIUS);
-    cov.setCircleCenter(
-        position_ + CIRCLE_OF_VISION_DISTANCE * rotate(facing_dir, angle));
-    angle -= CIRCLE_OF_VISION_ANGLE;
+  for (std::size_t i{0}; i != circles_of_vision.size(); ++i) {
+    circles_of_vision[i].setCircleRadius(CIRCLE_OF_VISION_RADIUS);
+    circles_of_vision[i].setCircleCenter(Vector2d{center_x[i], center_y[i]});
   }
 }
 
@@ -35,9 +102,10 @@ double Ant::calculateAngleToAvoidObstacles(
 
   double rotate_by_angle{0.};
 
-  bool any_obs_left{obs.anyObstaclesInCircle(cov[0])};
-  bool any_obs_ahead{obs.anyObstaclesInCircle(cov[1])};
-  bool any_obs_right{obs.anyObstaclesInCircle(cov[2])};
+  std::array<bool, 3> const any_obs{obs.anyObstaclesInCircles(cov)};
+  bool any_obs_left{any_obs[0]};
+  bool any_obs_ahead{any_obs[1]};
+  bool any_obs_right{any_obs[2]};
 
   if (!any_obs_left && any_obs_ahead && !any_obs_right) {
     std::uniform_int_distribution coinflip{0, 1};
@@ -58,32 +126,50 @@ double Ant::calculateAngleToAvoidObstacles(
   return rotate_by_angle;
 }
 
-void Ant::applyPheromonesInfluence(std::array<Circle, 3> const& cov,
-                                   Pheromones& ph_to_follow)
+// function only used by Ant::applyPheromonesInfluence: returns the direction
+// towards the most intense of the pheromones found, {0., 0.} if none was found
+Vector2d directionToStrongestPheromone(
+    std::array<Pheromones::SensedPheromones, 3> const& sensed,
+    Vector2d const& position)
 {
-  std::vector<Pheromones::Iterator> valid_pheromones;
-  for (auto const& circle_of_vision : cov) {
-    auto max_intensity_particle_in_circle{
-        ph_to_follow.getRandomMaxPheromoneParticleInCircle(circle_of_vision)};
-    if (max_intensity_particle_in_circle != ph_to_follow.end()) {
-      valid_pheromones.push_back(max_intensity_particle_in_circle);
+  std::optional<PheromoneParticle> const* strongest{nullptr};
+  for (auto const& circle_sensed : sensed) {
+    // ties go to the first circle, like std::max_element
+    if (circle_sensed.max_particle.has_value()
+        && (strongest == nullptr
+            || circle_sensed.max_particle->getIntensity()
+                   > (*strongest)->getIntensity())) {
+      strongest = &circle_sensed.max_particle;
     }
   }
 
-  if (valid_pheromones.empty()) {
-    return;
+  if (strongest == nullptr) {
+    return Vector2d{0., 0.};
   }
+  Vector2d direction{(*strongest)->getPosition() - position};
+  // norm can't be null because the circles of vision are not on the ant
+  return normalize(direction);
+}
 
-  auto max_pheromone{
-      std::max_element(valid_pheromones.begin(), valid_pheromones.end(),
-                       [](auto const& lhs, auto const& rhs) {
-                         return lhs->getIntensity() < rhs->getIntensity();
-                       })};
+void Ant::applyPheromonesInfluence(std::array<Circle, 3> const& cov,
+                                   Pheromones& ph_to_follow)
+{
+  Vector2d const direction{
+      directionToStrongestPheromone(ph_to_follow.sense(cov, false), position_)};
+  if (norm2(direction) != 0.) {
+    desired_direction_ = direction;
+  }
+}
 
-  desired_direction_ = (*max_pheromone)->getPosition() - position_;
-  desired_direction_ /=
-      norm(desired_direction_); // norm can't be null because the circles of
-                                // vision are not on the ant
+void Ant::applyPheromonesInfluence(std::array<Circle, 3> const& cov,
+                                   Pheromones const& ph_to_follow,
+                                   std::default_random_engine& random_engine)
+{
+  Vector2d const direction{directionToStrongestPheromone(
+      ph_to_follow.sense(cov, random_engine, false), position_)};
+  if (norm2(direction) != 0.) {
+    desired_direction_ = direction;
+  }
 }
 
 void Ant::applyRandomTurning(std::default_random_engine& random_engine)
@@ -130,6 +216,20 @@ Ant::Ant(Vector2d const& position, Vector2d const& direction, int current_frame,
   }
 }
 
+Ant::Ant(Vector2d const& desired_direction, Vector2d const& position,
+         Vector2d const& velocity, bool has_food, double pheromone_reserve,
+         double time_since_last_pheromone_release,
+         double time_since_last_pheromone_search, int current_frame)
+    : desired_direction_{desired_direction}
+    , position_{position}
+    , velocity_{velocity}
+    , has_food_{has_food}
+    , pheromone_reserve_{pheromone_reserve}
+    , time_since_last_pheromone_release_{time_since_last_pheromone_release}
+    , time_since_last_pheromone_search_{time_since_last_pheromone_search}
+    , current_frame_{current_frame}
+{}
+
 Vector2d const& Ant::getPosition() const
 {
   return position_;
@@ -175,39 +275,120 @@ bool Ant::timeToSearchPheromone(double delta_t)
   return time_to_search_pheromones;
 }
 
+// pointers to the arrays read and written by moveAnts()
+struct AntsKinematics
+{
+  double* position_x;
+  double* position_y;
+  double* velocity_x;
+  double* velocity_y;
+  double const* desired_direction_x;
+  double const* desired_direction_y;
+};
+
+// below this angle (in radians) sin and cos are computed through their Taylor
+// polynomials, that unlike std::sin and std::cos can be inlined and vectorised.
+// The first neglected terms are < 1e-18
+double const SMALL_ANGLE_LIMIT{0.1};
+
+double smallAngleSin(double angle)
+{
+  double const angle2{angle * angle};
+  return angle
+       * (1.
+          + angle2 / -6.
+                * (1.
+                   + angle2 / -20.
+                         * (1. + angle2 / -42. * (1. + angle2 / -72.))));
+}
+
+double smallAngleCos(double angle)
+{
+  double const angle2{angle * angle};
+  return 1.
+       + angle2 / -2.
+             * (1.
+                + angle2 / -12.
+                      * (1.
+                         + angle2 / -30.
+                               * (1. + angle2 / -56. * (1. + angle2 / -90.))));
+}
+
+// the body of the loop has no branches and no calls (if SMALL_ANGLES), so that
+// the compiler can vectorise it
+template<bool SMALL_ANGLES>
+void moveAntsKernel(AntsKinematics const& ants, std::size_t first,
+                    std::size_t last, double delta_t)
+{
+  for (std::size_t i{first}; i < last; ++i) {
+    // we consider the ant as a bar long ANT_LENGTH that rotates along its
+    // center; this rotation is considered a consequence from two forces, one at
+    // the top and on at the bottom of the ant, that cooperatively try to rotate
+    // its velocity vector to align it to the desired direction. To try and not
+    // overshoot the desired direction the ants acts with a force that decreases
+    // with the alignment of the velocity and desired direction vector
+    double const inverse_speed{
+        1. / std::sqrt(ants.velocity_x[i] * ants.velocity_x[i]
+                       + ants.velocity_y[i] * ants.velocity_y[i])};
+    double const direction_x{inverse_speed * ants.velocity_x[i]};
+    double const direction_y{inverse_speed * ants.velocity_y[i]};
+
+    // note: dot-product
+    double force_multiplier{direction_x * ants.desired_direction_x[i]
+                            + direction_y * ants.desired_direction_y[i]};
+    // i.e. the vectors are more than PI/2 radians apart
+    force_multiplier = force_multiplier < 0. ? 0. : force_multiplier;
+    // decreases from 1 to 0 in [PI/2, 0], is = 1 if they are more than PI/2
+    // apart. note: it's analogus for negative angles
+    force_multiplier = 1. - force_multiplier;
+    //+1 : the rotation will be anticlockwise
+    //-1 : the rotation will be clockwise
+    double const cross_product{direction_x * ants.desired_direction_y[i]
+                               - direction_y * ants.desired_direction_x[i]};
+    double const force_sign{cross_product > 0. ? +1. : -1.};
+    double const force{force_sign * force_multiplier * Ant::ANT_FORCE_MAX};
+    // cosidered the ant's angular velocity to start from 0 rad/s each frame and
+    // to be constantly increasing for delta_t sec
+    double const delta_theta{6. * force / (Ant::ANT_MASS * Ant::ANT_LENGTH)
+                             * delta_t * delta_t};
+
+    double const cos_theta{SMALL_ANGLES ? smallAngleCos(delta_theta)
+                                  : std::cos(delta_theta)};
+    double const sin_theta{SMALL_ANGLES ? smallAngleSin(delta_theta)
+                                  : std::sin(delta_theta)};
+    // we aren't just rotating the velocity to be sure its norm = ANT_SPEED
+    // even if there are small errors in floating point arithmetic
+    ants.velocity_x[i] =
+        (direction_x * cos_theta - direction_y * sin_theta) * Ant::ANT_SPEED;
+    ants.velocity_y[i] =
+        (direction_x * sin_theta + direction_y * cos_theta) * Ant::ANT_SPEED;
+    ants.position_x[i] += delta_t * ants.velocity_x[i];
+    ants.position_y[i] += delta_t * ants.velocity_y[i];
+  }
+}
+
+// moves the ants in [first, last) by delta_t: it's the kernel of both
+// Ant::updatePositionAndVelocity() and AntsSoA::updatePositionsAndVelocities()
+void moveAnts(AntsKinematics const& ants, std::size_t first, std::size_t last,
+              double delta_t)
+{
+  // the biggest rotation possible in delta_t
+  double const max_delta_theta{6. * Ant::ANT_FORCE_MAX
+                               / (Ant::ANT_MASS * Ant::ANT_LENGTH) * delta_t
+                               * delta_t};
+  if (max_delta_theta <= SMALL_ANGLE_LIMIT) {
+    moveAntsKernel<true>(ants, first, last, delta_t);
+  } else {
+    moveAntsKernel<false>(ants, first, last, delta_t);
+  }
+}
+
 void Ant::updatePositionAndVelocity(double delta_t)
 {
-  // we  consider the ant as a bar long        position_ +
-  // CIRCLE_OF_VISION_DISTANCE * rotate(facing_dir, angle)); ANTS::ANT_LENGHT
-  // that rotates along its center; this rotation is considered a consequence
-  // from two forces, one at the top and on at the bottom of the ant, that
-  // cooperatively try to rotate its velocity_ vector to align it to the
-  // desired_direction_. To try and not overshoot the desired_direction the ants
-  // acts with a force that decreases with the alignment of the velocity_ and
-  // desired_direction_ vector
-  Vector2d current_direction{velocity_ / norm(velocity_)};
-  double force_multiplier{current_direction
-                          * desired_direction_}; // note: dot-product
-  if (force_multiplier < 0.) { // i.e. the vectors are more than PI/2 radians
-                               // apart
-    force_multiplier = 0.;
-  }
-  // decreases from 1 to 0 in [PI/2, 0], is = 1 if they are more than PI/2 apart
-  // note: it's analogus for negative angles
-  force_multiplier = 1. - force_multiplier;
-  //+1 : the rotation will be anticlockwise
-  //-1 : the rotation will be clockwise
-  double force_sign{
-      cross_product(current_direction, desired_direction_) > 0. ? +1. : -1.};
-  double force{force_sign * force_multiplier * ANT_FORCE_MAX};
-  // cosidered the ant's angular velocity to start from 0 rad/s each frame and
-  // to be constantly increasing for delta_t sec
-  double delta_theta{6. * force / (ANT_MASS * ANT_LENGTH) * delta_t * delta_t};
-  // we aren't just rotating the current_velocity to be sure its norm =
-  // ANT_SPEED even if there are small errors in floatingnpoint arithmatic
-  current_direction = rotate(current_direction, delta_theta);
-  velocity_         = current_direction * ANT_SPEED;
-  position_ += delta_t * velocity_;
+  moveAnts(AntsKinematics{&position_.x, &position_.y, &velocity_.x,
+                          &velocity_.y, &desired_direction_.x,
+                          &desired_direction_.y},
+           0, 1, delta_t);
 }
 
 // function only used by Ant::update
@@ -222,9 +403,43 @@ bool seesTheAnthill(std::array<Circle, 3> const& cov, Anthill const& anthill)
 // may throw invalid_argument if to_anthill_ph isn't of type
 // Pheromones::Type::TO_ANTHILL or if to_food_ph isn't of type
 // Pheromones::Type::TO_FOOD
+// may throw std::invalid_argument if delta_t < 0.
 void Ant::update(Food& food, Pheromones& to_anthill_ph, Pheromones& to_food_ph,
                  Anthill& anthill, Obstacles const& obstacles,
                  std::default_random_engine& random_engine, double delta_t)
+{
+  EnvironmentChanges changes;
+  update(std::as_const(food), std::as_const(to_anthill_ph),
+         std::as_const(to_food_ph), std::as_const(anthill), obstacles,
+         random_engine, 0, changes, delta_t);
+
+  KAPE_PROFILE_SCOPE(timer, Phase::DEPOSITS);
+  for (auto const& deposit : changes.pheromone_deposits) {
+    Pheromones& pheromones{deposit.type == Pheromones::Type::TO_ANTHILL
+                               ? to_anthill_ph
+                               : to_food_ph};
+    pheromones.addPheromoneParticle(deposit.position, deposit.intensity);
+  }
+  for (auto const& pickup : changes.food_pickups) {
+    if (food.removeOneFoodParticleInCircle(pickup.circle)) {
+      pickUpFood();
+    }
+  }
+  for (int i{0}; i != changes.food_delivered_to_anthill; ++i) {
+    anthill.addFood();
+  }
+}
+
+// may throw invalid_argument if to_anthill_ph isn't of type
+// Pheromones::Type::TO_ANTHILL or if to_food_ph isn't of type
+// Pheromones::Type::TO_FOOD
+// may throw std::invalid_argument if delta_t < 0.
+void Ant::update(Food const& food, Pheromones const& to_anthill_ph,
+                 Pheromones const& to_food_ph, Anthill const& anthill,
+                 Obstacles const& obstacles,
+                 std::default_random_engine& random_engine,
+                 std::size_t ant_index, EnvironmentChanges& changes,
+                 double delta_t)
 {
   if (to_anthill_ph.getPheromonesType() != Pheromones::Type::TO_ANTHILL) {
     throw std::invalid_argument{
@@ -243,73 +458,136 @@ void Ant::update(Food& food, Pheromones& to_anthill_ph, Pheromones& to_food_ph,
   bool time_to_release_pheromone{timeToReleasePheromone(delta_t)};
   bool time_to_search_pheromones{timeToSearchPheromone(delta_t)};
 
-  updatePositionAndVelocity(delta_t);
-
   //[0]: left [1]: center [2]: right
   std::array<Circle, 3> circles_of_vision;
-  calculateCirclesOfVision(circles_of_vision);
+  {
+    KAPE_PROFILE_SCOPE(timer, Phase::MOVEMENT);
+    updatePositionAndVelocity(delta_t);
+    calculateCirclesOfVision(circles_of_vision);
+  }
 
+  if (react(food, to_anthill_ph, to_food_ph, anthill, obstacles, random_engine,
+            circles_of_vision, time_to_release_pheromone,
+            time_to_search_pheromones, SensingGrid::ANYTHING_, ant_index,
+            changes)) {
+    followPheromones(circles_of_vision, to_anthill_ph, to_food_ph,
+                     random_engine);
+  }
+}
+
+bool Ant::react(Food const& food, Pheromones const& to_anthill_ph,
+                Pheromones const& to_food_ph, Anthill const& anthill,
+                Obstacles const& obstacles,
+                std::default_random_engine& random_engine,
+                std::array<Circle, 3> const& circles_of_vision,
+                bool time_to_release_pheromone, bool time_to_search_pheromones,
+                std::uint8_t nearby, std::size_t ant_index,
+                EnvironmentChanges& changes)
+{
+  // the phases follow one another, and the timer records the last one when it
+  // returns
+  KAPE_PROFILE_SCOPE(timer, Phase::DEPOSITS);
   if (time_to_release_pheromone) {
-    double pheromone_intensity{pheromone_reserve_
-                               * PERCENTAGE_DECREASE_PHEROMONE_RELEASE};
-    if (has_food_) {
-      if (pheromone_intensity > to_food_ph.getMinPheromoneIntensity()) {
-        to_food_ph.addPheromoneParticle(position_, pheromone_intensity);
-      }
-    } else {
-      if (pheromone_intensity > to_anthill_ph.getMinPheromoneIntensity()) {
-        to_anthill_ph.addPheromoneParticle(position_, pheromone_intensity);
-      }
-    }
-    pheromone_reserve_ -= pheromone_intensity;
+    releasePheromone(to_anthill_ph, to_food_ph, changes);
   }
 
   // avoid obstacles
-  double angle_to_avoid_obstacles{calculateAngleToAvoidObstacles(
-      circles_of_vision, obstacles, random_engine)};
-  if (angle_to_avoid_obstacles != 0.) {
-    velocity_          = rotate(velocity_, angle_to_avoid_obstacles);
-    desired_direction_ = velocity_ / norm(velocity_);
-    return;
+  KAPE_PROFILE_SWITCH(timer, Phase::OBSTACLE_AVOIDANCE);
+  if ((nearby & SensingGrid::OBSTACLES_) != 0
+      && avoidObstacles(circles_of_vision, obstacles, random_engine)) {
+    return false;
   }
 
-  // search for food in circles_of_vision
-  if (!has_food_) {
+  // search for food in circles_of_vision, unless the ant is far from all of
+  // it: the circles of vision are inside vision_radius around the ant, with
+  // a margin for the rounding
+  KAPE_PROFILE_SWITCH(timer, Phase::FOOD_SEARCH);
+  double const vision_radius{CIRCLE_OF_VISION_DISTANCE
+                             + 2. * CIRCLE_OF_VISION_RADIUS};
+  if (!has_food_ && (nearby & SensingGrid::FOOD_) != 0
+      && food.isNearFood(Circle{position_, vision_radius})) {
     for (auto const& cov : circles_of_vision) {
-      if (food.removeOneFoodParticleInCircle(cov)) {
-        has_food_          = true;
-        pheromone_reserve_ = MAX_PHEROMONE_RESERVE;
-        velocity_ *= -1.;
-        desired_direction_ = velocity_ / norm(velocity_);
-        return;
+      if (food.isThereFoodInCircle(cov)) {
+        changes.food_pickups.push_back({ant_index, cov});
+        return false;
       }
     }
   }
 
-  // deal with anthill
+  // deal with anthill, if it's near
+  KAPE_PROFILE_SWITCH(timer, Phase::ANTHILL_CHECKS);
+  if ((nearby & SensingGrid::ANTHILL_) == 0) {
+    return time_to_search_pheromones;
+  }
   if (anthill.isInside(position_)) { // inside anthill
     pheromone_reserve_ = MAX_PHEROMONE_RESERVE;
 
     if (has_food_) {
-      anthill.addFood();
+      ++changes.food_delivered_to_anthill;
       has_food_ = false;
       velocity_ *= -1;
-      desired_direction_ = velocity_ / norm(velocity_);
-      return;
+      desired_direction_ = normalize(velocity_);
+      return false;
     }
-  } else if (seesTheAnthill(circles_of_vision, anthill)
-             && has_food_) { // we see the anthill and we have food
-    desired_direction_ = (anthill.getCenter() - position_)
-                       / norm(anthill.getCenter() - position_);
-    return;
+  } else if (has_food_ && seesTheAnthill(circles_of_vision, anthill)) {
+    // we have food and we see the anthill: the ant isn't inside the anthill,
+    // so it can't be on its center
+    desired_direction_ = normalize(anthill.getCenter() - position_);
+    return false;
   }
 
-  // follow pheromones
-  if (time_to_search_pheromones) {
-    Pheromones& pheromones_to_follow{has_food_ ? to_anthill_ph : to_food_ph};
-    applyPheromonesInfluence(circles_of_vision, pheromones_to_follow);
-    applyRandomTurning(random_engine);
+  return time_to_search_pheromones;
+}
+
+void Ant::releasePheromone(Pheromones const& to_anthill_ph,
+                           Pheromones const& to_food_ph,
+                           EnvironmentChanges& changes)
+{
+  double pheromone_intensity{pheromone_reserve_
+                             * PERCENTAGE_DECREASE_PHEROMONE_RELEASE};
+  Pheromones const& pheromones_to_release{has_food_ ? to_food_ph
+                                                    : to_anthill_ph};
+  if (pheromone_intensity > pheromones_to_release.getMinPheromoneIntensity()) {
+    changes.pheromone_deposits.push_back(
+        {pheromones_to_release.getPheromonesType(), position_,
+         pheromone_intensity});
+  }
+  pheromone_reserve_ -= pheromone_intensity;
+}
+
+bool Ant::avoidObstacles(std::array<Circle, 3> const& circles_of_vision,
+                         Obstacles const& obstacles,
+                         std::default_random_engine& random_engine)
+{
+  double angle_to_avoid_obstacles{calculateAngleToAvoidObstacles(
+      circles_of_vision, obstacles, random_engine)};
+  if (angle_to_avoid_obstacles == 0.) {
+    return false;
   }
+  velocity_          = rotate(velocity_, angle_to_avoid_obstacles);
+  desired_direction_ = normalize(velocity_);
+  return true;
+}
+
+void Ant::followPheromones(std::array<Circle, 3> const& circles_of_vision,
+                           Pheromones const& to_anthill_ph,
+                           Pheromones const& to_food_ph,
+                           std::default_random_engine& random_engine)
+{
+  KAPE_PROFILE_SCOPE(timer, Phase::PHEROMONE_QUERIES);
+  Pheromones const& pheromones_to_follow{has_food_ ? to_anthill_ph
+                                                   : to_food_ph};
+  applyPheromonesInfluence(circles_of_vision, pheromones_to_follow,
+                           random_engine);
+  applyRandomTurning(random_engine);
+}
+
+void Ant::pickUpFood()
+{
+  has_food_          = true;
+  pheromone_reserve_ = MAX_PHEROMONE_RESERVE;
+  velocity_ *= -1.;
+  desired_direction_ = normalize(velocity_);
 }
 
 int Ant::getCurrentFrame() const
@@ -321,27 +599,261 @@ void Ant::goToNextFrame()
   current_frame_ = (current_frame_ + 1) % ANIMATION_TOTAL_NUMBER_OF_FRAMES;
 }
 
+// AntsSoA struct implementation---------------------
+std::size_t AntsSoA::size() const
+{
+  return position_x.size();
+}
+
+void AntsSoA::reserve(std::size_t number_of_ants)
+{
+  position_x.reserve(number_of_ants);
+  position_y.reserve(number_of_ants);
+  velocity_x.reserve(number_of_ants);
+  velocity_y.reserve(number_of_ants);
+  desired_direction_x.reserve(number_of_ants);
+  desired_direction_y.reserve(number_of_ants);
+  pheromone_reserve.reserve(number_of_ants);
+  time_since_last_pheromone_release.reserve(number_of_ants);
+  time_since_last_pheromone_search.reserve(number_of_ants);
+  current_frame.reserve(number_of_ants);
+  has_food.reserve(number_of_ants);
+  time_to_release_pheromone.reserve(number_of_ants);
+  time_to_search_pheromones.reserve(number_of_ants);
+  circles_of_vision_x.reserve(3 * number_of_ants);
+  circles_of_vision_y.reserve(3 * number_of_ants);
+}
+
+void AntsSoA::clear()
+{
+  position_x.clear();
+  position_y.clear();
+  velocity_x.clear();
+  velocity_y.clear();
+  desired_direction_x.clear();
+  desired_direction_y.clear();
+  pheromone_reserve.clear();
+  time_since_last_pheromone_release.clear();
+  time_since_last_pheromone_search.clear();
+  current_frame.clear();
+  has_food.clear();
+  time_to_release_pheromone.clear();
+  time_to_search_pheromones.clear();
+  circles_of_vision_x.clear();
+  circles_of_vision_y.clear();
+}
+
+void AntsSoA::pushBack(Ant const& ant)
+{
+  position_x.push_back(ant.position_.x);
+  position_y.push_back(ant.position_.y);
+  velocity_x.push_back(ant.velocity_.x);
+  velocity_y.push_back(ant.velocity_.y);
+  desired_direction_x.push_back(ant.desired_direction_.x);
+  desired_direction_y.push_back(ant.desired_direction_.y);
+  pheromone_reserve.push_back(ant.pheromone_reserve_);
+  time_since_last_pheromone_release.push_back(
+      ant.time_since_last_pheromone_release_);
+  time_since_last_pheromone_search.push_back(
+      ant.time_since_last_pheromone_search_);
+  current_frame.push_back(ant.current_frame_);
+  has_food.push_back(ant.has_food_);
+  time_to_release_pheromone.push_back(false);
+  time_to_search_pheromones.push_back(false);
+  circles_of_vision_x.resize(circles_of_vision_x.size() + 3);
+  circles_of_vision_y.resize(circles_of_vision_y.size() + 3);
+}
+
+Ant AntsSoA::getAnt(std::size_t index) const
+{
+  // not checked again: it's called for every ant that looks around, at every
+  // step
+  return Ant{Vector2d{desired_direction_x[index], desired_direction_y[index]},
+             Vector2d{position_x[index], position_y[index]},
+             Vector2d{velocity_x[index], velocity_y[index]},
+             has_food[index] != 0,
+             pheromone_reserve[index],
+             time_since_last_pheromone_release[index],
+             time_since_last_pheromone_search[index],
+             current_frame[index]};
+}
+
+void AntsSoA::setAnt(std::size_t index, Ant const& ant)
+{
+  position_x[index]          = ant.position_.x;
+  position_y[index]          = ant.position_.y;
+  velocity_x[index]          = ant.velocity_.x;
+  velocity_y[index]          = ant.velocity_.y;
+  desired_direction_x[index] = ant.desired_direction_.x;
+  desired_direction_y[index] = ant.desired_direction_.y;
+  pheromone_reserve[index]   = ant.pheromone_reserve_;
+  time_since_last_pheromone_release[index] =
+      ant.time_since_last_pheromone_release_;
+  time_since_last_pheromone_search[index] =
+      ant.time_since_last_pheromone_search_;
+  current_frame[index] = ant.current_frame_;
+  has_food[index]      = ant.has_food_;
+}
+
+// same as Ant::timeToReleasePheromone() and Ant::timeToSearchPheromone(), but
+// without branches
+void AntsSoA::updateTimers(std::size_t first, std::size_t last, double delta_t)
+{
+  double const release_period{Ant::PERIOD_BETWEEN_PHEROMONE_RELEASE_};
+  double const search_period{Ant::PERIOD_BETWEEN_PHEROMONE_SEARCH_};
+
+  for (std::size_t i{first}; i < last; ++i) {
+    double const since_release{time_since_last_pheromone_release[i] + delta_t};
+    bool const release{since_release > release_period};
+    time_since_last_pheromone_release[i] =
+        release ? since_release - release_period : since_release;
+    time_to_release_pheromone[i] = release;
+
+    double const since_search{time_since_last_pheromone_search[i] + delta_t};
+    bool const search{since_search > search_period};
+    time_since_last_pheromone_search[i] =
+        search ? since_search - search_period : since_search;
+    time_to_search_pheromones[i] = search;
+  }
+}
+
+void AntsSoA::postponeTimers(std::size_t index)
+{
+  // the periods taken away by updateTimers() are given back
+  if (time_to_release_pheromone[index] != 0) {
+    time_since_last_pheromone_release[index] +=
+        Ant::PERIOD_BETWEEN_PHEROMONE_RELEASE_;
+    time_to_release_pheromone[index] = false;
+  }
+  if (time_to_search_pheromones[index] != 0) {
+    time_since_last_pheromone_search[index] +=
+        Ant::PERIOD_BETWEEN_PHEROMONE_SEARCH_;
+    time_to_search_pheromones[index] = false;
+  }
+}
+
+void AntsSoA::updatePositionsAndVelocities(std::size_t first, std::size_t last,
+                                           double delta_t)
+{
+  moveAnts(AntsKinematics{position_x.data(), position_y.data(),
+                          velocity_x.data(), velocity_y.data(),
+                          desired_direction_x.data(),
+                          desired_direction_y.data()},
+           first, last, delta_t);
+}
+
+void AntsSoA::updateCirclesOfVision(std::size_t first, std::size_t last)
+{
+  placeCirclesOfVision(
+      AntsVision{position_x.data(), position_y.data(), velocity_x.data(),
+                 velocity_y.data(), circles_of_vision_x.data(),
+                 circles_of_vision_y.data()},
+      first, last);
+}
+
+void AntsSoA::getCirclesOfVision(std::size_t index,
+                                 std::array<Circle, 3>& circles_of_vision) const
+{
+  for (std::size_t i{0}; i != circles_of_vision.size(); ++i) {
+    circles_of_vision[i].setCircleRadius(Ant::CIRCLE_OF_VISION_RADIUS);
+    circles_of_vision[i].setCircleCenter(
+        Vector2d{circles_of_vision_x[3 * index + i],
+                 circles_of_vision_y[3 * index + i]});
+  }
+}
+
 // Ants class implementation---------------------
+// function only used by Ants: every ant has its own stream of random numbers,
+// that depends only on the seed and on the ant's index. Therefore an ant's
+// behaviour doesn't depend on the order in which the ants are updated
+std::default_random_engine antRandomEngine(unsigned int seed,
+                                           std::size_t ant_index)
+{
+  std::seed_seq seed_sequence{seed, static_cast<unsigned int>(ant_index),
+                              static_cast<unsigned int>(
+                                  static_cast<std::uint64_t>(ant_index) >> 32)};
+  return std::default_random_engine{seed_sequence};
+}
+
 // may throw std::invalid_argument if direction is null
 void Ants::addAnt(Vector2d const& position, Vector2d const& direction,
                   int current_frame, bool has_food)
 {
-  ants_vec_.push_back(Ant{position, direction, current_frame, has_food});
+  addAnt(Ant{position, direction, current_frame, has_food});
 }
 void Ants::addAnt(Ant const& ant)
 {
-  ants_vec_.push_back(ant);
+  ants_.pushBack(ant);
+  ants_random_engines_.push_back(antRandomEngine(seed_, ants_.size() - 1));
+}
+
+void Ants::applyChanges(EnvironmentChanges const& changes, Food& food,
+                        Pheromones& to_anthill_ph, Pheromones& to_food_ph,
+                        Anthill& anthill)
+{
+  KAPE_PROFILE_SCOPE(timer, Phase::DEPOSITS);
+  for (auto const& deposit : changes.pheromone_deposits) {
+    Pheromones& pheromones{deposit.type == Pheromones::Type::TO_ANTHILL
+                               ? to_anthill_ph
+                               : to_food_ph};
+    pheromones.addPheromoneParticle(deposit.position, deposit.intensity);
+  }
+  // if more ants saw the same last food particle, the first one gets it
+  for (auto const& pickup : changes.food_pickups) {
+    if (food.removeOneFoodParticleInCircle(pickup.circle)) {
+      Ant ant{ants_.getAnt(pickup.ant_index)};
+      ant.pickUpFood();
+      ants_.setAnt(pickup.ant_index, ant);
+    }
+  }
+  for (int i{0}; i != changes.food_delivered_to_anthill; ++i) {
+    anthill.addFood();
+  }
 }
 
-Ants::Ants(unsigned int seed)
-    : ants_vec_{}
+// number_of_threads == 0 means one per hardware thread
+Ants::Ants(unsigned int seed, std::size_t number_of_threads)
+    : ants_{}
+    , ants_random_engines_{}
+    , seed_{seed}
     , random_engine_{seed}
     , time_since_last_frame_change_{0.}
-{}
+    , thread_pool_{nullptr}
+    , chunks_changes_{}
+    , sensing_grid_{}
+{
+  setNumberOfThreads(number_of_threads);
+}
 
 std::size_t Ants::getNumberOfAnts() const
 {
-  return ants_vec_.size();
+  return ants_.size();
+}
+
+// number_of_threads == 0 means one per hardware thread
+void Ants::setNumberOfThreads(std::size_t number_of_threads)
+{
+  if (number_of_threads == 0) {
+    // hardware_concurrency() may return 0 if it can't tell
+    number_of_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  if (number_of_threads == getNumberOfThreads()) {
+    return;
+  }
+  thread_pool_ = number_of_threads == 1
+                   ? nullptr
+                   : std::make_unique<ThreadPool>(number_of_threads);
+}
+
+std::size_t Ants::getNumberOfThreads() const
+{
+  return thread_pool_ == nullptr ? 1 : thread_pool_->getNumberOfThreads();
+}
+
+AntsSoA const& Ants::getAntsData() const
+{
+  return ants_;
 }
 
 void Ants::addAntsAroundCircle(Circle const& circle, std::size_t number_of_ants)
@@ -351,19 +863,17 @@ void Ants::addAntsAroundCircle(Circle const& circle, std::size_t number_of_ants)
     return;
   }
 
-  ants_vec_.reserve(number_of_ants);
+  ants_.reserve(ants_.size() + number_of_ants);
+  ants_random_engines_.reserve(ants_.size() + number_of_ants);
   std::uniform_real_distribution dist(0., 2 * PI);
   std::uniform_int_distribution starting_frame_generator{
       0, Ant::ANIMATION_TOTAL_NUMBER_OF_FRAMES - 1};
-  std::generate_n(
-      std::back_inserter(ants_vec_), number_of_ants,
-      [&circle, &starting_frame_generator, this, &dist]() {
-        Vector2d facing_direction{
-            rotate(Vector2d{0., 1.}, (dist(random_engine_)))};
-        return Ant{circle.getCircleCenter()
-                       + circle.getCircleRadius() * facing_direction,
-                   facing_direction, starting_frame_generator(random_engine_)};
-      });
+  for (std::size_t i{0}; i != number_of_ants; ++i) {
+    Vector2d facing_direction{rotate(Vector2d{0., 1.}, (dist(random_engine_)))};
+    addAnt(Ant{circle.getCircleCenter()
+                   + circle.getCircleRadius() * facing_direction,
+               facing_direction, starting_frame_generator(random_engine_)});
+  }
 }
 
 bool Ants::timeToChangeFrames(double delta_t)
@@ -379,19 +889,187 @@ bool Ants::timeToChangeFrames(double delta_t)
 // may throw std::invalid_argument if to_anthill_ph isn't of type
 // Pheromones::Type::TO_ANTHILL or if to_food_ph isn't of type
 // Pheromones::Type::TO_FOOD
-// may throw std::invalid_argument if delta_t < 0.
+// may throw std::invalid_argument if delta_t < 0. or if number_of_substeps is 0
 void Ants::update(Food& food, Pheromones& to_anthill_ph, Pheromones& to_food_ph,
-                  Anthill& anthill, Obstacles const& obstacles, double delta_t)
+                  Anthill& anthill, Obstacles const& obstacles, double delta_t,
+                  std::size_t number_of_substeps)
 {
-  bool change_frame{timeToChangeFrames(delta_t)};
+  // checked here so that the threads can't throw them
+  if (to_anthill_ph.getPheromonesType() != Pheromones::Type::TO_ANTHILL) {
+    throw std::invalid_argument{
+        "The parameter to_anthill_ph, passed to Ants::update(), isn't of type "
+        "Pheromones::Type::TO_ANTHILL"};
+  }
+  if (to_food_ph.getPheromonesType() != Pheromones::Type::TO_FOOD) {
+    throw std::invalid_argument{
+        "The parameter to_food_ph, passed to Ants::update(), isn't of type "
+        "Pheromones::Type::TO_FOOD"};
+  }
+  if (delta_t < 0.) {
+    throw std::invalid_argument{"delta_t can't be negative"};
+  }
+  if (number_of_substeps == 0) {
+    throw std::invalid_argument{"number_of_substeps can't be 0"};
+  }
 
-  for (auto& ant : ants_vec_) {
-    ant.update(food, to_anthill_ph, to_food_ph, anthill, obstacles,
-               random_engine_, delta_t);
-    if (change_frame) {
-      ant.goToNextFrame();
+  int number_of_frame_changes{0};
+  for (std::size_t substep{0}; substep != number_of_substeps; ++substep) {
+    if (timeToChangeFrames(delta_t)) {
+      ++number_of_frame_changes;
     }
   }
+
+  // the circles of vision are within this distance of where an ant is at the
+  // beginning of the step, whatever the substep, so the grid tells what they
+  // may reach for the whole step. It's rebuilt only if the food ran out in
+  // one of its circles since the last step
+  double const reach{Ant::ANT_SPEED * delta_t
+                         * static_cast<double>(number_of_substeps)
+                     + Ant::CIRCLE_OF_VISION_DISTANCE
+                     + 2. * Ant::CIRCLE_OF_VISION_RADIUS};
+  if (!sensing_grid_.isBuiltFrom(obstacles, food, anthill, reach)) {
+    sensing_grid_.build(obstacles, food, anthill, reach);
+  }
+
+  std::size_t const number_of_chunks{
+      (ants_.size() + ANTS_PER_CHUNK_ - 1) / ANTS_PER_CHUNK_};
+  if (chunks_changes_.size() < number_of_chunks) {
+    chunks_changes_.resize(number_of_chunks);
+  }
+
+  // first every ant moves, looking at the environment as it was at the
+  // beginning of the step...
+  auto update_chunk{[&](std::size_t chunk) {
+    EnvironmentChanges& changes{chunks_changes_[chunk]};
+    changes.clear();
+    std::size_t const first{chunk * ANTS_PER_CHUNK_};
+    std::size_t const last{std::min(first + ANTS_PER_CHUNK_, ants_.size())};
+
+    // for every ant of the chunk: what's near it, whether it's waiting for
+    // the food it found and whether it's time to search the pheromones since
+    // it last looked around. An ant with nothing near moves through all the
+    // substeps and looks around only after the last one. An ant waiting for
+    // its food only avoids the obstacles until the changes are applied
+    std::array<std::uint8_t, ANTS_PER_CHUNK_> nearby;
+    std::array<bool, ANTS_PER_CHUNK_> waiting_for_food{};
+    std::array<bool, ANTS_PER_CHUNK_> time_to_search_pheromones{};
+    for (std::size_t i{first}; i != last; ++i) {
+      nearby[i - first] = sensing_grid_.getNearby(
+          Vector2d{ants_.position_x[i], ants_.position_y[i]});
+    }
+
+    std::array<Circle, 3> circles_of_vision;
+    std::array<std::size_t, ANTS_PER_CHUNK_> followers;
+    for (std::size_t substep{0}; substep != number_of_substeps; ++substep) {
+      bool const last_substep{substep + 1 == number_of_substeps};
+
+      // the whole chunk moves and computes its circles of vision at once...
+      {
+        KAPE_PROFILE_SCOPE(timer, Phase::MOVEMENT);
+        ants_.updateTimers(first, last, delta_t);
+        ants_.updatePositionsAndVelocities(first, last, delta_t);
+        ants_.updateCirclesOfVision(first, last);
+      }
+
+      // ...then every ant looks around on its own. The few that have to
+      // follow the pheromones are set aside, grouped by the pheromones they
+      // follow: the ones going to the food from the front of followers, the
+      // others from the back
+      std::size_t number_of_to_food_followers{0};
+      std::size_t number_of_to_anthill_followers{0};
+      for (std::size_t i{first}; i != last; ++i) {
+        std::size_t const k{i - first};
+        if (waiting_for_food[k]) {
+          // its pheromones are released and searched at the next step, once
+          // it has the food
+          ants_.postponeTimers(i);
+          if ((nearby[k] & SensingGrid::OBSTACLES_) != 0) {
+            KAPE_PROFILE_SCOPE(timer, Phase::OBSTACLE_AVOIDANCE);
+            Ant ant{ants_.getAnt(i)};
+            ants_.getCirclesOfVision(i, circles_of_vision);
+            ant.avoidObstacles(circles_of_vision, obstacles,
+                               ants_random_engines_[i]);
+            ants_.setAnt(i, ant);
+          }
+          continue;
+        }
+        time_to_search_pheromones[k] = time_to_search_pheromones[k]
+                                    || ants_.time_to_search_pheromones[i] != 0;
+        if (nearby[k] == SensingGrid::NOTHING_ && !last_substep) {
+          // the pheromone is left where the ant is when its timer runs out
+          if (ants_.time_to_release_pheromone[i] != 0) {
+            KAPE_PROFILE_SCOPE(timer, Phase::DEPOSITS);
+            Ant ant{ants_.getAnt(i)};
+            ant.releasePheromone(std::as_const(to_anthill_ph),
+                                 std::as_const(to_food_ph), changes);
+            ants_.setAnt(i, ant);
+          }
+          continue;
+        }
+
+        Ant ant{ants_.getAnt(i)};
+        ants_.getCirclesOfVision(i, circles_of_vision);
+        std::size_t const number_of_food_pickups{changes.food_pickups.size()};
+        bool const follows_pheromones{ant.react(
+            std::as_const(food), std::as_const(to_anthill_ph),
+            std::as_const(to_food_ph), std::as_const(anthill), obstacles,
+            ants_random_engines_[i], circles_of_vision,
+            ants_.time_to_release_pheromone[i] != 0,
+            time_to_search_pheromones[k], nearby[k], i, changes)};
+        time_to_search_pheromones[k] = false;
+        waiting_for_food[k] =
+            changes.food_pickups.size() != number_of_food_pickups;
+        if (follows_pheromones && ant.hasFood()) {
+          followers[ANTS_PER_CHUNK_ - ++number_of_to_anthill_followers] = i;
+        } else if (follows_pheromones) {
+          followers[number_of_to_food_followers++] = i;
+        }
+        ants_.setAnt(i, ant);
+      }
+
+      // ...and then they sense the pheromones, one kind after the other. Each
+      // ant has its own random engine, so the order doesn't change the result
+      auto const follow{[&](std::size_t i) {
+        Ant ant{ants_.getAnt(i)};
+        ants_.getCirclesOfVision(i, circles_of_vision);
+        ant.followPheromones(circles_of_vision, std::as_const(to_anthill_ph),
+                             std::as_const(to_food_ph),
+                             ants_random_engines_[i]);
+        ants_.setAnt(i, ant);
+      }};
+      for (std::size_t f{0}; f != number_of_to_food_followers; ++f) {
+        follow(followers[f]);
+      }
+      for (std::size_t f{ANTS_PER_CHUNK_ - number_of_to_anthill_followers};
+           f != ANTS_PER_CHUNK_; ++f) {
+        follow(followers[f]);
+      }
+    }
+
+    if (number_of_frame_changes != 0) {
+      for (std::size_t i{first}; i != last; ++i) {
+        ants_.current_frame[i] =
+            (ants_.current_frame[i] + number_of_frame_changes)
+            % Ant::ANIMATION_TOTAL_NUMBER_OF_FRAMES;
+      }
+    }
+  }};
+
+  if (thread_pool_ == nullptr) {
+    for (std::size_t chunk{0}; chunk != number_of_chunks; ++chunk) {
+      update_chunk(chunk);
+    }
+  } else {
+    // by reference: the lambda is too big to be stored in the std::function
+    // without allocating
+    thread_pool_->run(number_of_chunks, std::cref(update_chunk));
+  }
+
+  // ...then the environment is changed, in the order of the ants
+  for (std::size_t chunk{0}; chunk != number_of_chunks; ++chunk) {
+    applyChanges(chunks_changes_[chunk], food, to_anthill_ph, to_food_ph,
+                 anthill);
+  }
 }
 
 bool Ants::loadFromFile(Anthill const& anthill, std::string const& filepath)
@@ -415,7 +1093,8 @@ bool Ants::loadFromFile(Anthill const& anthill, std::string const& filepath)
   file_in >> end_check;
   // reached the eof too early or too late->the read failed
   if (end_check != "END") {
-    ants_vec_.clear();
+    ants_.clear();
+    ants_random_engines_.clear();
     kape::log << "[ERROR]:\tfrom Ants::loadFromFile(std::string const& "
                  "filepath):\n\t\t\tTried to load from \""
               << filepath << "\" but it was badly formatted\n";
@@ -436,7 +1115,7 @@ bool Ants::saveToFile(std::string const& filepath) const
     return false;
   }
 
-  file_out << ants_vec_.size() << '\n';
+  file_out << ants_.size() << '\n';
 
   file_out << "END\n";
 
@@ -444,14 +1123,128 @@ bool Ants::saveToFile(std::string const& filepath) const
   return true;
 }
 
-std::vector<Ant>::const_iterator Ants::begin() const
+void Ants::saveToSnapshot(SnapshotWriter& snapshot) const
+{
+  snapshot.write(seed_);
+  snapshot.write(time_since_last_frame_change_);
+  snapshot.writeRandomEngine(random_engine_);
+
+  snapshot.writeArray(ants_.position_x);
+  snapshot.writeArray(ants_.position_y);
+  snapshot.writeArray(ants_.velocity_x);
+  snapshot.writeArray(ants_.velocity_y);
+  snapshot.writeArray(ants_.desired_direction_x);
+  snapshot.writeArray(ants_.desired_direction_y);
+  snapshot.writeArray(ants_.pheromone_reserve);
+  snapshot.writeArray(ants_.time_since_last_pheromone_release);
+  snapshot.writeArray(ants_.time_since_last_pheromone_search);
+  snapshot.writeArray(ants_.current_frame);
+  snapshot.writeArray(ants_.has_food);
+  // time_to_release_pheromone, time_to_search_pheromones and the circles of
+  // vision are computed again at the beginning of every update
+
+  for (auto const& ant_random_engine : ants_random_engines_) {
+    snapshot.writeRandomEngine(ant_random_engine);
+  }
+}
+
+// if it throws the ants are left as they were
+// may throw std::runtime_error if the snapshot is badly formatted
+void Ants::loadFromSnapshot(SnapshotReader& snapshot)
+{
+  unsigned int const seed{snapshot.read<unsigned int>()};
+  double const time_since_last_frame_change{snapshot.read<double>()};
+  std::default_random_engine random_engine;
+  snapshot.readRandomEngine(random_engine);
+
+  AntsSoA ants;
+  snapshot.readArray(ants.position_x);
+  snapshot.readArray(ants.position_y);
+  snapshot.readArray(ants.velocity_x);
+  snapshot.readArray(ants.velocity_y);
+  snapshot.readArray(ants.desired_direction_x);
+  snapshot.readArray(ants.desired_direction_y);
+  snapshot.readArray(ants.pheromone_reserve);
+  snapshot.readArray(ants.time_since_last_pheromone_release);
+  snapshot.readArray(ants.time_since_last_pheromone_search);
+  snapshot.readArray(ants.current_frame);
+  snapshot.readArray(ants.has_food);
+
+  std::size_t const number_of_ants{ants.position_x.size()};
+  checkSnapshot(
+      ants.position_y.size() == number_of_ants
+          && ants.velocity_x.size() == number_of_ants
+          && ants.velocity_y.size() == number_of_ants
+          && ants.desired_direction_x.size() == number_of_ants
+          && ants.desired_direction_y.size() == number_of_ants
+          && ants.pheromone_reserve.size() == number_of_ants
+          && ants.time_since_last_pheromone_release.size() == number_of_ants
+          && ants.time_since_last_pheromone_search.size() == number_of_ants
+          && ants.current_frame.size() == number_of_ants
+          && ants.has_food.size() == number_of_ants,
+      "the arrays of the ants have different sizes");
+  for (std::size_t i{0}; i != number_of_ants; ++i) {
+    // the velocity is normalized at every update
+    checkSnapshot(ants.velocity_x[i] != 0. || ants.velocity_y[i] != 0.,
+                  "ant with null velocity");
+    checkSnapshot(ants.current_frame[i] >= 0
+                      && ants.current_frame[i]
+                             < Ant::ANIMATION_TOTAL_NUMBER_OF_FRAMES,
+                  "ant with an invalid animation frame");
+  }
+  ants.time_to_release_pheromone.assign(number_of_ants, false);
+  ants.time_to_search_pheromones.assign(number_of_ants, false);
+  ants.circles_of_vision_x.assign(3 * number_of_ants, 0.);
+  ants.circles_of_vision_y.assign(3 * number_of_ants, 0.);
+
+  std::vector<std::default_random_engine> ants_random_engines(number_of_ants);
+  for (auto& ant_random_engine : ants_random_engines) {
+    snapshot.readRandomEngine(ant_random_engine);
+  }
+
+  // all valid
+  ants_                         = std::move(ants);
+  ants_random_engines_          = std::move(ants_random_engines);
+  seed_                         = seed;
+  random_engine_                = random_engine;
+  time_since_last_frame_change_ = time_since_last_frame_change;
+}
+
+// Ants::Iterator class implementation---------------------
+Ants::Iterator::Iterator(AntsSoA const& ants, std::size_t index)
+    : ants_{&ants}
+    , index_{index}
+{}
+
+Ants::Iterator& Ants::Iterator::operator++() // prefix ++
+{
+  ++index_;
+  return *this;
+}
+
+Ant Ants::Iterator::operator*() const
+{
+  return ants_->getAnt(index_);
+}
+
+bool operator==(Ants::Iterator const& lhs, Ants::Iterator const& rhs)
+{
+  return lhs.ants_ == rhs.ants_ && lhs.index_ == rhs.index_;
+}
+
+bool operator!=(Ants::Iterator const& lhs, Ants::Iterator const& rhs)
+{
+  return !(lhs == rhs);
+}
+
+Ants::Iterator Ants::begin() const
 {
-  return ants_vec_.cbegin();
+  return Iterator{ants_, 0};
 }
 
-std::vector<Ant>::const_iterator Ants::end() const
+Ants::Iterator Ants::end() const
 {
-  return ants_vec_.cend();
+  return Iterator{ants_, ants_.size()};
 }
 
 } // namespace kape
\ No newline at end of file
@@ -3,13 +3,53 @@
 
 #include "environment.hpp" //Pheromones, Food, Obstacles
 #include "geometry.hpp"    //Vector2d
+#include "thread_pool.hpp"
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <random>
+#include <vector>
 
 namespace kape {
 
+// changes to the environment requested by the ants while they're updated.
+// They're recorded instead of being applied immediately so that the ants can be
+// updated concurrently, and then applied in a fixed order
+struct EnvironmentChanges
+{
+  struct PheromoneDeposit
+  {
+    Pheromones::Type type;
+    Vector2d position;
+    double intensity;
+  };
+  // the ant wants to take one food particle in circle: it'll have it only if,
+  // when the changes are applied, there's still food there
+  struct FoodPickup
+  {
+    std::size_t ant_index;
+    Circle circle;
+  };
+
+  std::vector<PheromoneDeposit> pheromone_deposits;
+  std::vector<FoodPickup> food_pickups;
+  int food_delivered_to_anthill{0};
+
+  // keeps the capacity of the vectors
+  void clear();
+};
+
+struct AntsSoA;
+
 class Ant
 {
+  // it stores the ants member by member
+  friend struct AntsSoA;
+  friend class Ants;
+
  private:
   // every PERIOD_BETWEEN_PHEROMONE_RELEASE_ the ant releases a pheromone
   inline static double const PERIOD_BETWEEN_PHEROMONE_RELEASE_{.1};
@@ -24,6 +64,45 @@ class Ant
   double time_since_last_pheromone_search_;
   int current_frame_;
 
+  // every member as it's passed, without any check or normalization: for the
+  // ants rebuilt from AntsSoA, which were already checked when they were added
+  Ant(Vector2d const& desired_direction, Vector2d const& position,
+      Vector2d const& velocity, bool has_food, double pheromone_reserve,
+      double time_since_last_pheromone_release,
+      double time_since_last_pheromone_search, int current_frame);
+
+  // the part of update() that comes after the ant has moved: the ant looks
+  // around, through the circles of vision of its new position, and decides
+  // where it wants to go. Returns true if it's left to follow the pheromones,
+  // with followPheromones(): it didn't have to avoid an obstacle, take food or
+  // head to the anthill, and it was time to search them. nearby, from
+  // SensingGrid::getNearby(), tells what the circles of vision may reach: the
+  // ant doesn't look for the rest
+  bool react(Food const& food, Pheromones const& to_anthill_ph,
+             Pheromones const& to_food_ph, Anthill const& anthill,
+             Obstacles const& obstacles,
+             std::default_random_engine& random_engine,
+             std::array<Circle, 3> const& circles_of_vision,
+             bool time_to_release_pheromone, bool time_to_search_pheromones,
+             std::uint8_t nearby, std::size_t ant_index,
+             EnvironmentChanges& changes);
+  // the first part of react(): the ant leaves, where it is, a pheromone that
+  // leads where it comes from
+  void releasePheromone(Pheromones const& to_anthill_ph,
+                        Pheromones const& to_food_ph,
+                        EnvironmentChanges& changes);
+  // the part of react() that keeps the ant away from the obstacles: returns
+  // true if it had to turn
+  bool avoidObstacles(std::array<Circle, 3> const& circles_of_vision,
+                      Obstacles const& obstacles,
+                      std::default_random_engine& random_engine);
+  // the last part of react(): the ant follows the pheromones that lead where
+  // it's going, then turns a bit at random
+  void followPheromones(std::array<Circle, 3> const& circles_of_vision,
+                        Pheromones const& to_anthill_ph,
+                        Pheromones const& to_food_ph,
+                        std::default_random_engine& random_engine);
+
  public:
   inline static double const ANT_LENGTH{0.005};   // 0.5 cm
   inline static double const ANT_MASS{5.e-6};     // 5 milligrams
@@ -47,6 +126,10 @@ class Ant
 
   void applyPheromonesInfluence(std::array<Circle, 3> const& cov,
                                 Pheromones& ph_to_follow);
+  // the random draws come from random_engine instead of ph_to_follow's engine
+  void applyPheromonesInfluence(std::array<Circle, 3> const& cov,
+                                Pheromones const& ph_to_follow,
+                                std::default_random_engine& random_engine);
 
   void applyRandomTurning(std::default_random_engine& random_engine);
 
@@ -74,22 +157,145 @@ class Ant
   void update(Food& food, Pheromones& to_anthill_ph, Pheromones& to_food_ph,
               Anthill& anthill, Obstacles const& obstacles,
               std::default_random_engine& random_engine, double delta_t = 0.01);
+  // same as above, but the environment is only read: what the ant would change
+  // is recorded in changes (ant_index identifies the ant in
+  // changes.food_pickups). If the ant finds food it doesn't take it until
+  // pickUpFood() is called
+  // may throw std::invalid_argument if to_anthill_ph isn't of type
+  // Pheromones::Type::TO_ANTHILL or if to_food_ph isn't of type
+  // Pheromones::Type::TO_FOOD
+  // may throw std::invalid_argument if delta_t < 0.
+  void update(Food const& food, Pheromones const& to_anthill_ph,
+              Pheromones const& to_food_ph, Anthill const& anthill,
+              Obstacles const& obstacles,
+              std::default_random_engine& random_engine, std::size_t ant_index,
+              EnvironmentChanges& changes, double delta_t = 0.01);
+  // the ant takes the food it found and turns back
+  void pickUpFood();
 
   int getCurrentFrame() const;
   void goToNextFrame();
 };
 
+// allocates memory aligned to ALIGNMENT bytes
+template<class T, std::size_t ALIGNMENT = 64>
+struct AlignedAllocator
+{
+  using value_type = T;
+  template<class U>
+  struct rebind
+  {
+    using other = AlignedAllocator<U, ALIGNMENT>;
+  };
+
+  AlignedAllocator() = default;
+  template<class U>
+  AlignedAllocator(AlignedAllocator<U, ALIGNMENT> const&)
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t{ALIGNMENT}));
+  }
+  void deallocate(T* pointer, std::size_t)
+  {
+    ::operator delete(pointer, std::align_val_t{ALIGNMENT});
+  }
+
+  template<class U>
+  friend bool operator==(AlignedAllocator const&,
+                         AlignedAllocator<U, ALIGNMENT> const&)
+  {
+    return true;
+  }
+  template<class U>
+  friend bool operator!=(AlignedAllocator const&,
+                         AlignedAllocator<U, ALIGNMENT> const&)
+  {
+    return false;
+  }
+};
+
+template<class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// the state of many ants stored member by member (structure of arrays): the
+// i-th ant is made of the i-th element of every array. This way the movement
+// of all the ants is a loop over contiguous arrays that the compiler can
+// vectorise
+struct AntsSoA
+{
+  AlignedVector<double> position_x;
+  AlignedVector<double> position_y;
+  AlignedVector<double> velocity_x;
+  AlignedVector<double> velocity_y;
+  AlignedVector<double> desired_direction_x;
+  AlignedVector<double> desired_direction_y;
+  AlignedVector<double> pheromone_reserve;
+  AlignedVector<double> time_since_last_pheromone_release;
+  AlignedVector<double> time_since_last_pheromone_search;
+  AlignedVector<int> current_frame;
+  AlignedVector<unsigned char> has_food;
+  // set by the timers at the beginning of every update
+  AlignedVector<unsigned char> time_to_release_pheromone;
+  AlignedVector<unsigned char> time_to_search_pheromones;
+  // the centers of the circles of vision, three per ant: [3 * i] left,
+  // [3 * i + 1] center, [3 * i + 2] right. Set by updateCirclesOfVision()
+  AlignedVector<double> circles_of_vision_x;
+  AlignedVector<double> circles_of_vision_y;
+
+  std::size_t size() const;
+  void reserve(std::size_t number_of_ants);
+  void clear();
+  void pushBack(Ant const& ant);
+  Ant getAnt(std::size_t index) const;
+  void setAnt(std::size_t index, Ant const& ant);
+  // advances the timers of the ants in [first, last) by delta_t, setting
+  // time_to_release_pheromone and time_to_search_pheromones
+  void updateTimers(std::size_t first, std::size_t last, double delta_t);
+  // the timers of the ant that ran out at the last updateTimers() run out
+  // again at the next one, for an ant that can't act on them yet
+  void postponeTimers(std::size_t index);
+  // moves the ants in [first, last) like Ant::updatePositionAndVelocity()
+  void updatePositionsAndVelocities(std::size_t first, std::size_t last,
+                                    double delta_t);
+  // computes the circles of vision of the ants in [first, last) like
+  // Ant::calculateCirclesOfVision(), all at once
+  void updateCirclesOfVision(std::size_t first, std::size_t last);
+  // the circles computed by the last updateCirclesOfVision()
+  void getCirclesOfVision(std::size_t index,
+                          std::array<Circle, 3>& circles_of_vision) const;
+};
+
 class Ants
 {
  private:
-  std::vector<Ant> ants_vec_;
+  // the ants are updated in chunks of ANTS_PER_CHUNK_, each one with its own
+  // EnvironmentChanges. The chunks don't depend on the number of threads, so
+  // neither does the result of update()
+  inline static std::size_t const ANTS_PER_CHUNK_{64};
+
+  AntsSoA ants_;
+  // ants_random_engines_[i] is used only by the i-th ant
+  std::vector<std::default_random_engine> ants_random_engines_;
+  unsigned int seed_;
   std::default_random_engine random_engine_;
   double time_since_last_frame_change_;
+  // nullptr if the ants are updated on the calling thread only
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::vector<EnvironmentChanges> chunks_changes_;
+  // what's near the ants during update(), rebuilt only when the food runs out
+  // in one of its circles (or when the environment passed to update() changes)
+  SensingGrid sensing_grid_;
 
   // may throw std::invalid_argument if direction is null
   void addAnt(Vector2d const& position, Vector2d const& direction,
               int current_frame, bool has_food = false);
   void addAnt(Ant const& ant);
+  void applyChanges(EnvironmentChanges const& changes, Food& food,
+                    Pheromones& to_anthill_ph, Pheromones& to_food_ph,
+                    Anthill& anthill);
 
  public:
   inline static std::string const DEFAULT_FILEPATH_{
@@ -98,25 +304,68 @@ class Ants
   // NOTE: it's in "simulation" time, not real time
   inline static double const ANIMATION_TIME_BETWEEN_FRAMES_{0.03};
 
-  explicit Ants(unsigned int seed = 44444444u);
+  // number_of_threads == 0 means one per hardware thread
+  explicit Ants(unsigned int seed = 44444444u,
+                std::size_t number_of_threads = 1);
   size_t getNumberOfAnts() const;
+  // number_of_threads == 0 means one per hardware thread
+  void setNumberOfThreads(std::size_t number_of_threads);
+  std::size_t getNumberOfThreads() const;
   void addAntsAroundCircle(Circle const& circle, std::size_t number_of_ants);
+  // the ants member by member, e.g. to draw them without building an Ant for
+  // each one
+  AntsSoA const& getAntsData() const;
 
   bool timeToChangeFrames(double delta_t);
   // may throw std::invalid_argument if to_anthill_ph isn't of type
   // Pheromones::Type::TO_ANTHILL or if to_food_ph isn't of type
   // Pheromones::Type::TO_FOOD
-  // may throw std::invalid_argument if delta_t < 0.
+  // may throw std::invalid_argument if delta_t < 0. or if number_of_substeps
+  //     is 0
+  // the result is the same for any number of threads. The ants advance by
+  // number_of_substeps steps of delta_t: they all move at every substep, so
+  // none of them can pass through an obstacle, but the ones with nothing
+  // around them look around only after the last substep
   void update(Food& food, Pheromones& to_anthill_ph, Pheromones& to_food_ph,
               Anthill& anthill, Obstacles const& obstacles,
-              double delta_t = 0.01);
+              double delta_t = 0.01, std::size_t number_of_substeps = 1);
 
   bool loadFromFile(Anthill const& anthill,
                     std::string const& filepath = DEFAULT_FILEPATH_);
   bool saveToFile(std::string const& filepath = DEFAULT_FILEPATH_) const;
 
-  std::vector<Ant>::const_iterator begin() const;
-  std::vector<Ant>::const_iterator end() const;
+  // every ant with its own random engine, and the state of the animation. The
+  // number of threads isn't saved
+  void saveToSnapshot(SnapshotWriter& snapshot) const;
+  // if it throws the ants are left as they were
+  // may throw std::runtime_error if the snapshot is badly formatted
+  void loadFromSnapshot(SnapshotReader& snapshot);
+
+  // the ants aren't stored as Ant objects: dereferencing an iterator returns a
+  // copy of the ant
+  class Iterator
+  {
+   private:
+    AntsSoA const* ants_;
+    std::size_t index_;
+
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type        = Ant;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = Ant;
+
+    explicit Iterator(AntsSoA const& ants, std::size_t index);
+    Iterator& operator++(); // prefix ++
+    Ant operator*() const;
+
+    friend bool operator==(Iterator const& lhs, Iterator const& rhs);
+    friend bool operator!=(Iterator const& lhs, Iterator const& rhs);
+  };
+
+  Iterator begin() const;
+  Iterator end() const;
 };
 
 } // namespace kape
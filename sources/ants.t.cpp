@@ -1,8 +1,39 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "ants.hpp"
 #include "doctest.h"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
+#include <new>
 #include <numbers>
+#include <stdexcept>
+#include <vector>
+
+// every heap allocation of the tests goes through here, so that they can
+// check that some code doesn't allocate. Not inlined, or gcc would see
+// std::malloc() and std::free() paired with operator new and delete
+std::atomic<std::size_t> number_of_heap_allocations{0};
+
+[[gnu::noinline]] void* operator new(std::size_t size)
+{
+  ++number_of_heap_allocations;
+  if (void* pointer{std::malloc(size == 0 ? 1 : size)}) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
 
 TEST_CASE("Testing the Ants class")
 {
@@ -125,4 +156,448 @@ TEST_CASE("Testing the Ants class")
     ants.addAntsAroundCircle(c2, n2);
     CHECK(ants.getNumberOfAnts() == 111);
   }
-}
\ No newline at end of file
+}
+// runs a small simulation and returns the final positions of the ants
+std::vector<kape::Vector2d>
+runSmallSimulation(std::size_t number_of_threads, int& food_collected,
+                   std::size_t& number_of_pheromones)
+{
+  kape::Obstacles obstacles;
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{0.02, 0.03}, 0.01, 0.04});
+  kape::Anthill anthill{kape::Vector2d{0., 0.}, 0.01};
+  kape::Food food{7u};
+  food.generateFoodInCircle(kape::Circle{kape::Vector2d{0.04, 0.}, 0.01}, 50,
+                            obstacles);
+  kape::Pheromones to_anthill_ph{kape::Pheromones::Type::TO_ANTHILL,
+                                 kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.};
+  kape::Pheromones to_food_ph{kape::Pheromones::Type::TO_FOOD,
+                              kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.};
+
+  kape::Ants ants{3u, number_of_threads};
+  ants.addAntsAroundCircle(anthill.getCircle(), 300);
+  for (int step{0}; step != 500; ++step) {
+    ants.update(food, to_anthill_ph, to_food_ph, anthill, obstacles);
+  }
+
+  food_collected       = anthill.getFoodCounter();
+  number_of_pheromones = to_anthill_ph.getNumberOfPheromones()
+                       + to_food_ph.getNumberOfPheromones();
+  std::vector<kape::Vector2d> positions;
+  for (auto const& ant : ants) {
+    positions.push_back(ant.getPosition());
+  }
+  return positions;
+}
+
+// the movement of an ant as written with Vector2d and rotate()
+void referenceMovement(kape::Vector2d& position, kape::Vector2d& velocity,
+                       kape::Vector2d const& desired_direction, double delta_t)
+{
+  kape::Vector2d direction{velocity / kape::norm(velocity)};
+  double force_multiplier{
+      1. - std::max(0., direction * desired_direction)}; // dot product
+  double force_sign{
+      kape::cross_product(direction, desired_direction) > 0. ? 1. : -1.};
+  double force{force_sign * force_multiplier * kape::Ant::ANT_FORCE_MAX};
+  double delta_theta{6. * force / (kape::Ant::ANT_MASS * kape::Ant::ANT_LENGTH)
+                     * delta_t * delta_t};
+  velocity = kape::rotate(direction, delta_theta) * kape::Ant::ANT_SPEED;
+  position += delta_t * velocity;
+}
+
+TEST_CASE("Testing the movement of the ants")
+{
+  // both small time steps (polynomial sin and cos) and big ones (std::sin and
+  // std::cos)
+  for (double delta_t : {0.001, 0.01, 0.05, 0.2}) {
+    CAPTURE(delta_t);
+    for (double angle{-3.}; angle <= 3.; angle += 0.25) {
+      kape::Ant ant{kape::Vector2d{0.1, -0.2}, kape::Vector2d{1., 0.}, 0};
+      kape::Vector2d position{ant.getPosition()};
+      kape::Vector2d velocity{ant.getVelocity()};
+      // the desired direction is changed through the pheromones
+      kape::Vector2d const desired_direction{kape::rotate(
+          kape::Vector2d{1., 0.}, angle)};
+      kape::Pheromones to_food_ph{kape::Pheromones::Type::TO_FOOD, 1.};
+      std::array<kape::Circle, 3> cov;
+      to_food_ph.addPheromoneParticle(
+          ant.getPosition() + 0.01 * desired_direction, 10.);
+      cov.fill(kape::Circle{ant.getPosition(), 1.});
+      ant.applyPheromonesInfluence(cov, to_food_ph);
+      REQUIRE(ant.getDesiredDirection().x
+              == doctest::Approx(desired_direction.x));
+
+      for (int step{0}; step != 10; ++step) {
+        ant.updatePositionAndVelocity(delta_t);
+        referenceMovement(position, velocity, ant.getDesiredDirection(),
+                          delta_t);
+      }
+      CHECK(ant.getPosition().x == doctest::Approx(position.x).epsilon(1e-12));
+      CHECK(ant.getPosition().y == doctest::Approx(position.y).epsilon(1e-12));
+      CHECK(ant.getVelocity().x == doctest::Approx(velocity.x).epsilon(1e-12));
+      CHECK(ant.getVelocity().y == doctest::Approx(velocity.y).epsilon(1e-12));
+    }
+  }
+}
+
+TEST_CASE("Testing the circles of vision computed for all the ants at once")
+{
+  kape::AntsSoA ants;
+  std::vector<kape::Ant> ants_one_by_one;
+  for (double angle{-3.}; angle <= 3.; angle += 0.5) {
+    kape::Ant const ant{kape::Vector2d{0.1 * angle, -0.2},
+                        kape::rotate(kape::Vector2d{1., 0.}, angle), 0};
+    ants.pushBack(ant);
+    ants_one_by_one.push_back(ant);
+  }
+  ants.updateCirclesOfVision(0, ants.size());
+
+  for (std::size_t i{0}; i != ants.size(); ++i) {
+    std::array<kape::Circle, 3> cov;
+    std::array<kape::Circle, 3> cov_one_by_one;
+    ants.getCirclesOfVision(i, cov);
+    ants_one_by_one[i].calculateCirclesOfVision(cov_one_by_one);
+    for (std::size_t j{0}; j != cov.size(); ++j) {
+      CHECK(cov[j].getCircleCenter().x
+            == cov_one_by_one[j].getCircleCenter().x);
+      CHECK(cov[j].getCircleCenter().y
+            == cov_one_by_one[j].getCircleCenter().y);
+      CHECK(cov[j].getCircleRadius() == cov_one_by_one[j].getCircleRadius());
+    }
+  }
+}
+
+TEST_CASE("Testing the multithreaded update of the Ants class")
+{
+  SUBCASE("the number of threads")
+  {
+    kape::Ants ants{};
+    CHECK(ants.getNumberOfThreads() == 1);
+    CHECK(ants.begin() == ants.end());
+    ants.setNumberOfThreads(3);
+    CHECK(ants.getNumberOfThreads() == 3);
+    ants.setNumberOfThreads(0);
+    CHECK(ants.getNumberOfThreads() >= 1);
+  }
+
+  SUBCASE("the results don't depend on the number of threads")
+  {
+    int food_collected_1{};
+    std::size_t pheromones_1{};
+    auto const positions_1{
+        runSmallSimulation(1, food_collected_1, pheromones_1)};
+
+    int food_collected_4{};
+    std::size_t pheromones_4{};
+    auto const positions_4{
+        runSmallSimulation(4, food_collected_4, pheromones_4)};
+
+    CHECK(food_collected_1 == food_collected_4);
+    CHECK(pheromones_1 == pheromones_4);
+    CHECK(pheromones_1 > 0);
+    REQUIRE(positions_1.size() == positions_4.size());
+    bool all_equal{true};
+    for (std::size_t i{0}; i != positions_1.size(); ++i) {
+      all_equal = all_equal && positions_1[i].x == positions_4[i].x
+               && positions_1[i].y == positions_4[i].y;
+    }
+    CHECK(all_equal);
+  }
+}
+
+TEST_CASE("Testing a step of the ants doesn't allocate once the trails formed")
+{
+  // a box closed by walls, with the anthill and the food inside
+  kape::Obstacles obstacles;
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{-0.06, 0.06}, 0.12, 0.01});
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{-0.06, -0.05}, 0.12, 0.01});
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{-0.06, 0.05}, 0.01, 0.1});
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{0.05, 0.05}, 0.01, 0.1});
+  kape::Rectangle const bounds{kape::Vector2d{-0.06, 0.06}, 0.12, 0.12};
+  kape::Anthill anthill{kape::Vector2d{-0.02, 0.}, 0.01};
+  kape::Food food{7u};
+  food.generateFoodInCircle(kape::Circle{kape::Vector2d{0.03, 0.}, 0.01}, 500,
+                            obstacles);
+
+  for (std::size_t number_of_threads : {1u, 3u}) {
+    CAPTURE(number_of_threads);
+    kape::Pheromones to_anthill_ph{kape::Pheromones::Type::TO_ANTHILL,
+                                   kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.,
+                                   bounds};
+    kape::Pheromones to_food_ph{kape::Pheromones::Type::TO_FOOD,
+                                kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.,
+                                bounds};
+    // the trails form in a few updates
+    to_anthill_ph.setDecreasePercentageAmount(0.5);
+    to_food_ph.setDecreasePercentageAmount(0.5);
+    kape::Ants ants{3u, number_of_threads};
+    ants.addAntsAroundCircle(anthill.getCircle(), 300);
+    auto const step{[&] {
+      ants.update(food, to_anthill_ph, to_food_ph, anthill, obstacles);
+      to_anthill_ph.updateParticlesEvaporation(
+          kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+      to_food_ph.updateParticlesEvaporation(
+          kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    }};
+
+    for (int i{0}; i != 1000; ++i) {
+      step();
+    }
+    std::size_t const allocations_before{number_of_heap_allocations};
+    for (int i{0}; i != 200; ++i) {
+      step();
+    }
+    std::size_t const allocations{number_of_heap_allocations
+                                  - allocations_before};
+    CHECK(allocations == 0);
+    CHECK(to_anthill_ph.getNumberOfPheromones() > 0);
+  }
+}
+
+TEST_CASE("Testing the substeps of the ants")
+{
+  // a box closed by walls, with a thin wall between the anthill and the food
+  kape::Obstacles obstacles;
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{-0.06, 0.06}, 0.12, 0.01});
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{-0.06, -0.05}, 0.12, 0.01});
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{-0.06, 0.05}, 0.01, 0.1});
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{0.05, 0.05}, 0.01, 0.1});
+  obstacles.addObstacle(
+      kape::Rectangle{kape::Vector2d{0.005, 0.05}, 0.005, 0.07});
+  kape::Anthill anthill{kape::Vector2d{-0.02, 0.}, 0.01};
+  // the x of the middle of the thin wall, and the y of its ends
+  double const thin_wall_x{0.0075};
+  double const thin_wall_bottom{-0.02};
+  double const thin_wall_top{0.05};
+
+  // the positions of the ants after every update, the pheromones they left
+  // and the food they took
+  struct Run
+  {
+    std::vector<std::vector<kape::Vector2d>> positions;
+    std::size_t number_of_pheromones;
+    std::size_t food_taken;
+  };
+  auto const run{[&](std::size_t number_of_substeps, int number_of_updates,
+                     bool pass_number_of_substeps,
+                     kape::Circle const& food_circle) {
+    kape::Food food{7u};
+    food.generateFoodInCircle(food_circle, 500, obstacles);
+    kape::Pheromones to_anthill_ph{kape::Pheromones::Type::TO_ANTHILL,
+                                   kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.};
+    kape::Pheromones to_food_ph{kape::Pheromones::Type::TO_FOOD,
+                                kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.};
+    kape::Ants ants{3u};
+    ants.addAntsAroundCircle(anthill.getCircle(), 200);
+    Run result{{}, 0, 0};
+    for (int i{0}; i != number_of_updates; ++i) {
+      if (pass_number_of_substeps) {
+        ants.update(food, to_anthill_ph, to_food_ph, anthill, obstacles, 0.01,
+                    number_of_substeps);
+      } else {
+        ants.update(food, to_anthill_ph, to_food_ph, anthill, obstacles);
+      }
+      result.positions.emplace_back();
+      for (kape::Ant const& ant : ants) {
+        result.positions.back().push_back(ant.getPosition());
+      }
+    }
+    // the pheromones never evaporate: there's one for every deposit
+    result.number_of_pheromones = to_anthill_ph.getNumberOfPheromones()
+                                + to_food_ph.getNumberOfPheromones();
+    result.food_taken           = 500 - food.getNumberOfFoodParticles();
+    return result;
+  }};
+  kape::Circle const food_in_the_open{kape::Vector2d{0.03, 0.}, 0.01};
+  // right next to the thin wall, so that the ants waiting for the food they
+  // found are close to it
+  kape::Circle const food_next_to_the_wall{kape::Vector2d{0.019, 0.03}, 0.008};
+
+  SUBCASE("a single substep is the usual update")
+  {
+    auto const positions{run(1, 300, true, food_in_the_open).positions.back()};
+    auto const positions_default{
+        run(1, 300, false, food_in_the_open).positions.back()};
+    REQUIRE(positions.size() == positions_default.size());
+    bool all_equal{true};
+    for (std::size_t i{0}; i != positions.size(); ++i) {
+      all_equal = all_equal && positions[i].x == positions_default[i].x
+               && positions[i].y == positions_default[i].y;
+    }
+    CHECK(all_equal);
+  }
+
+  SUBCASE("the ants don't pass through the walls with longer steps")
+  {
+    kape::Rectangle const inside{kape::Vector2d{-0.05, 0.05}, 0.1, 0.1};
+    for (kape::Circle const& food_circle :
+         {food_in_the_open, food_next_to_the_wall}) {
+      for (std::size_t number_of_substeps : {2u, 10u}) {
+        CAPTURE(food_circle.getCircleCenter().y);
+        CAPTURE(number_of_substeps);
+        Run const result{run(number_of_substeps, 600, true, food_circle)};
+        CHECK(result.food_taken > 0);
+        bool all_outside_the_walls{true};
+        bool none_through_the_thin_wall{true};
+        for (std::size_t update{0}; update != result.positions.size();
+             ++update) {
+          for (std::size_t i{0}; i != result.positions[update].size(); ++i) {
+            kape::Vector2d const& position{result.positions[update][i]};
+            all_outside_the_walls =
+                all_outside_the_walls
+                && kape::doShapesIntersect(inside, position)
+                && !obstacles.anyObstaclesInCircle(
+                    kape::Circle{position, 1e-9});
+            if (update == 0) {
+              continue;
+            }
+            // an ant going from one side of the thin wall to the other must
+            // pass below it
+            kape::Vector2d const& previous{result.positions[update - 1][i]};
+            if ((previous.x < thin_wall_x) != (position.x < thin_wall_x)) {
+              double const crossing_y{
+                  previous.y
+                  + (position.y - previous.y) * (thin_wall_x - previous.x)
+                        / (position.x - previous.x)};
+              none_through_the_thin_wall =
+                  none_through_the_thin_wall
+                  && !(crossing_y >= thin_wall_bottom
+                       && crossing_y <= thin_wall_top);
+            }
+          }
+        }
+        CHECK(all_outside_the_walls);
+        CHECK(none_through_the_thin_wall);
+      }
+    }
+  }
+
+  SUBCASE("the ants leave as many pheromones with longer steps")
+  {
+    // less time than the ants take to run out of pheromones, so that every
+    // release is a deposit. At the end the ants still waiting for their food
+    // may have one release left for the next step
+    std::size_t const expected{
+        run(1, 1000, true, food_next_to_the_wall).number_of_pheromones};
+    REQUIRE(expected > 0);
+    for (std::size_t number_of_substeps : {2u, 10u}) {
+      CAPTURE(number_of_substeps);
+      std::size_t const number_of_pheromones{
+          run(number_of_substeps,
+              1000 / static_cast<int>(number_of_substeps), true,
+              food_next_to_the_wall)
+              .number_of_pheromones};
+      CHECK(number_of_pheromones <= expected);
+      CHECK(number_of_pheromones + 200 >= expected);
+    }
+  }
+
+  SUBCASE("there's at least one substep")
+  {
+    kape::Food food{};
+    kape::Pheromones to_anthill_ph{kape::Pheromones::Type::TO_ANTHILL, 1.};
+    kape::Pheromones to_food_ph{kape::Pheromones::Type::TO_FOOD, 1.};
+    kape::Ants ants{};
+    CHECK_THROWS_AS(ants.update(food, to_anthill_ph, to_food_ph, anthill,
+                                obstacles, 0.01, 0),
+                    std::invalid_argument);
+  }
+}
+
+TEST_CASE("Testing the snapshots of the Ants class")
+{
+  kape::Obstacles obstacles;
+  kape::Anthill anthill{kape::Vector2d{0., 0.}, 0.01};
+  kape::Food food{7u};
+  food.generateFoodInCircle(kape::Circle{kape::Vector2d{0.04, 0.}, 0.01}, 50,
+                            obstacles);
+  kape::Pheromones to_anthill_ph{kape::Pheromones::Type::TO_ANTHILL,
+                                 kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.};
+  kape::Pheromones to_food_ph{kape::Pheromones::Type::TO_FOOD,
+                              kape::Ant::CIRCLE_OF_VISION_RADIUS * 2.};
+  kape::Ants ants{3u};
+  ants.addAntsAroundCircle(anthill.getCircle(), 100);
+  for (int step{0}; step != 200; ++step) {
+    ants.update(food, to_anthill_ph, to_food_ph, anthill, obstacles);
+  }
+
+  // the whole environment is saved too, so that both copies see the same one
+  kape::SnapshotWriter writer;
+  anthill.saveToSnapshot(writer);
+  food.saveToSnapshot(writer);
+  ants.saveToSnapshot(writer);
+  to_anthill_ph.saveToSnapshot(writer);
+  to_food_ph.saveToSnapshot(writer);
+  std::vector<char> const bytes{writer.releaseBuffer()};
+  kape::SnapshotReader reader{bytes};
+  kape::Anthill loaded_anthill{};
+  kape::Food loaded_food{};
+  kape::Ants loaded_ants{};
+  kape::Pheromones loaded_to_anthill_ph{kape::Pheromones::Type::TO_ANTHILL, 1.};
+  kape::Pheromones loaded_to_food_ph{kape::Pheromones::Type::TO_FOOD, 1.};
+  loaded_anthill.loadFromSnapshot(reader);
+  loaded_food.loadFromSnapshot(reader);
+  loaded_ants.loadFromSnapshot(reader);
+  loaded_to_anthill_ph.loadFromSnapshot(reader);
+  loaded_to_food_ph.loadFromSnapshot(reader);
+  CHECK(reader.isAtEnd());
+  REQUIRE(loaded_ants.getNumberOfAnts() == ants.getNumberOfAnts());
+
+  for (int step{0}; step != 300; ++step) {
+    ants.update(food, to_anthill_ph, to_food_ph, anthill, obstacles);
+    loaded_ants.update(loaded_food, loaded_to_anthill_ph, loaded_to_food_ph,
+                       loaded_anthill, obstacles);
+  }
+
+  CHECK(loaded_anthill.getFoodCounter() == anthill.getFoodCounter());
+  CHECK(loaded_to_food_ph.getNumberOfPheromones()
+        == to_food_ph.getNumberOfPheromones());
+  CHECK(std::equal(ants.begin(), ants.end(), loaded_ants.begin(),
+                   [](kape::Ant const& lhs, kape::Ant const& rhs) {
+                     return lhs.getPosition().x == rhs.getPosition().x
+                         && lhs.getPosition().y == rhs.getPosition().y
+                         && lhs.hasFood() == rhs.hasFood();
+                   }));
+}
+
+TEST_CASE("Testing the ThreadPool class")
+{
+  CHECK_THROWS_AS(kape::ThreadPool{0}, std::invalid_argument);
+
+  kape::ThreadPool pool{4};
+  CHECK(pool.getNumberOfThreads() == 4);
+
+  SUBCASE("every task is run exactly once")
+  {
+    std::vector<int> runs(1000, 0);
+    for (int repetition{0}; repetition != 3; ++repetition) {
+      pool.run(runs.size(), [&runs](std::size_t i) { ++runs[i]; });
+    }
+    CHECK(std::all_of(runs.begin(), runs.end(),
+                      [](int number_of_runs) { return number_of_runs == 3; }));
+  }
+
+  SUBCASE("exceptions are passed to the caller")
+  {
+    CHECK_THROWS_AS(pool.run(100,
+                             [](std::size_t i) {
+                               if (i == 42) {
+                                 throw std::runtime_error{"task 42 failed"};
+                               }
+                             }),
+                    std::runtime_error);
+    // the pool is still usable
+    int runs{0};
+    pool.run(1, [&runs](std::size_t) { ++runs; });
+    CHECK(runs == 1);
+  }
+}
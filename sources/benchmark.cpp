@@ -0,0 +1,723 @@
+#include "ants.hpp"
+#include "environment.hpp"
+#include "geometry.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// microbenchmarks of the hot paths of the simulation. The results are printed
+// as JSON, so that the outputs of two builds can be diffed. Run it from the
+// directory "Project-KAPE", like project-kape, so that it finds the maps in
+// ./assets/simulations
+
+using Clock = std::chrono::steady_clock;
+
+// options that can be passed from the command line
+struct BenchmarkOptions
+{
+  bool show_help{false};
+  // only the benchmarks whose name contains filter are run
+  std::string filter{};
+  // if empty the results are printed on std::cout
+  std::string output_filepath{};
+  // every benchmark is repeated number_of_repetitions times...
+  std::size_t number_of_repetitions{5};
+  // ...and each repetition lasts at least min_time seconds, unless the
+  // benchmark has a fixed number of iterations
+  double min_time{0.2};
+  // used by the Ants::update benchmarks
+  std::size_t number_of_threads{1};
+};
+
+// sums the time spent between start() and stop(), so that a benchmark can
+// leave its setup out of the measurement
+class Stopwatch
+{
+ private:
+  Clock::time_point start_;
+  double elapsed_; // in seconds
+
+ public:
+  Stopwatch()
+      : start_{}
+      , elapsed_{0.}
+  {}
+  void start()
+  {
+    start_ = Clock::now();
+  }
+  void stop()
+  {
+    elapsed_ += std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+  double getElapsed() const
+  {
+    return elapsed_;
+  }
+};
+
+// run(iterations) performs the measured operation iterations times and returns
+// the seconds it took
+struct Benchmark
+{
+  std::string name;
+  std::function<double(std::size_t)> run;
+  // 0: the number of iterations is chosen so that a repetition lasts at least
+  // min_time
+  std::size_t fixed_iterations{0};
+};
+
+struct BenchmarkResult
+{
+  std::string name;
+  std::size_t iterations;       // per repetition
+  std::vector<double> times_ns; // time per iteration, one per repetition
+  std::string error;            // empty if the benchmark ran
+};
+
+// every benchmark writes here the results of the work it measured, so that the
+// compiler can't optimize the work away
+volatile double benchmark_sink{0.};
+
+// the inputs of the benchmarks come from fixed seeds, so that every run (and
+// every build) measures exactly the same work
+unsigned int const BENCHMARK_SEED{20240101u};
+
+// the area where the random shapes, particles and queries are generated
+kape::Rectangle const BENCHMARK_AREA{kape::Vector2d{-0.5, 0.5}, 1., 1.};
+
+// number of different inputs a benchmark cycles through
+std::size_t const NUMBER_OF_INPUTS{1024};
+
+kape::Vector2d randomPoint(kape::Rectangle const& area,
+                           std::default_random_engine& engine)
+{
+  kape::Vector2d const top_left{area.getRectangleTopLeftCorner()};
+  std::uniform_real_distribution<double> x{top_left.x,
+                                           top_left.x + area.getRectangleWidth()};
+  std::uniform_real_distribution<double> y{
+      top_left.y - area.getRectangleHeight(), top_left.y};
+  double const random_x{x(engine)};
+  return kape::Vector2d{random_x, y(engine)};
+}
+
+std::vector<kape::Vector2d> randomPoints(std::size_t number_of_points,
+                                         kape::Rectangle const& area,
+                                         unsigned int seed)
+{
+  std::default_random_engine engine{seed};
+  std::vector<kape::Vector2d> points;
+  points.reserve(number_of_points);
+  for (std::size_t i{0}; i != number_of_points; ++i) {
+    points.push_back(randomPoint(area, engine));
+  }
+  return points;
+}
+
+std::vector<kape::Circle> randomCircles(std::size_t number_of_circles,
+                                        kape::Rectangle const& area,
+                                        double radius, unsigned int seed)
+{
+  std::vector<kape::Circle> circles;
+  circles.reserve(number_of_circles);
+  for (auto const& center : randomPoints(number_of_circles, area, seed)) {
+    circles.emplace_back(center, radius);
+  }
+  return circles;
+}
+
+// the rectangles have sides in [min_side, max_side]
+std::vector<kape::Rectangle> randomRectangles(std::size_t number_of_rectangles,
+                                              kape::Rectangle const& area,
+                                              double min_side, double max_side,
+                                              unsigned int seed)
+{
+  std::default_random_engine engine{seed};
+  std::uniform_real_distribution<double> side{min_side, max_side};
+  std::vector<kape::Rectangle> rectangles;
+  rectangles.reserve(number_of_rectangles);
+  for (std::size_t i{0}; i != number_of_rectangles; ++i) {
+    kape::Vector2d const top_left{randomPoint(area, engine)};
+    double const width{side(engine)};
+    rectangles.emplace_back(top_left, width, side(engine));
+  }
+  return rectangles;
+}
+
+// the circles used by the ants to look around
+std::vector<kape::Circle> circlesOfVision(kape::Rectangle const& area,
+                                          unsigned int seed)
+{
+  return randomCircles(NUMBER_OF_INPUTS, area,
+                       kape::Ant::CIRCLE_OF_VISION_RADIUS, seed);
+}
+
+// doShapesIntersect------------------------------
+template<class Shape1, class Shape2>
+Benchmark intersectionBenchmark(std::string const& name,
+                                std::vector<Shape1> const& shapes1,
+                                std::vector<Shape2> const& shapes2)
+{
+  return Benchmark{
+      name, [shapes1, shapes2](std::size_t iterations) {
+        std::size_t intersections{0};
+        Stopwatch stopwatch;
+        stopwatch.start();
+        for (std::size_t i{0}; i != iterations; ++i) {
+          intersections += kape::doShapesIntersect(
+              shapes1[i % NUMBER_OF_INPUTS],
+              shapes2[(i / NUMBER_OF_INPUTS + i) % NUMBER_OF_INPUTS]);
+        }
+        stopwatch.stop();
+        benchmark_sink = static_cast<double>(intersections);
+        return stopwatch.getElapsed();
+      }};
+}
+
+void addGeometryBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+  // the sizes are those of the circles of vision and of the obstacles, so that
+  // about as many pairs intersect as in the simulation
+  auto const circles{randomCircles(NUMBER_OF_INPUTS, BENCHMARK_AREA, 0.05,
+                                   BENCHMARK_SEED)};
+  auto const points{
+      randomPoints(NUMBER_OF_INPUTS, BENCHMARK_AREA, BENCHMARK_SEED + 1u)};
+  auto const rectangles{randomRectangles(NUMBER_OF_INPUTS, BENCHMARK_AREA,
+                                         0.02, 0.2, BENCHMARK_SEED + 2u)};
+  auto const other_circles{randomCircles(NUMBER_OF_INPUTS, BENCHMARK_AREA,
+                                         0.05, BENCHMARK_SEED + 3u)};
+
+  benchmarks.push_back(intersectionBenchmark(
+      "doShapesIntersect/circle_point", circles, points));
+  benchmarks.push_back(intersectionBenchmark(
+      "doShapesIntersect/rectangle_point", rectangles, points));
+  benchmarks.push_back(intersectionBenchmark(
+      "doShapesIntersect/circle_rectangle", circles, rectangles));
+  benchmarks.push_back(intersectionBenchmark(
+      "doShapesIntersect/circle_circle", circles, other_circles));
+}
+
+// Obstacles------------------------------
+Benchmark obstaclesBenchmark(std::string const& name,
+                             kape::Obstacles const& obstacles,
+                             std::vector<kape::Circle> const& circles)
+{
+  return Benchmark{name, [obstacles, circles](std::size_t iterations) {
+                     std::size_t hits{0};
+                     Stopwatch stopwatch;
+                     stopwatch.start();
+                     for (std::size_t i{0}; i != iterations; ++i) {
+                       hits += obstacles.anyObstaclesInCircle(
+                           circles[i % NUMBER_OF_INPUTS]);
+                     }
+                     stopwatch.stop();
+                     benchmark_sink = static_cast<double>(hits);
+                     return stopwatch.getElapsed();
+                   }};
+}
+
+void addObstaclesBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+  for (std::size_t number_of_obstacles : {100u, 1000u, 10000u}) {
+    kape::Obstacles obstacles;
+    // the smaller they are, the more they are
+    double const max_side{2. / std::sqrt(static_cast<double>(number_of_obstacles))};
+    for (auto const& rectangle :
+         randomRectangles(number_of_obstacles, BENCHMARK_AREA, max_side / 10.,
+                          max_side, BENCHMARK_SEED)) {
+      obstacles.addObstacle(rectangle);
+    }
+    benchmarks.push_back(obstaclesBenchmark(
+        "Obstacles::anyObstaclesInCircle/random_"
+            + std::to_string(number_of_obstacles),
+        obstacles, circlesOfVision(BENCHMARK_AREA, BENCHMARK_SEED + 1u)));
+  }
+}
+
+// Pheromones------------------------------
+// number_of_particles particles with random intensities in [1, 100], spread
+// uniformly over BENCHMARK_AREA
+kape::Pheromones randomPheromones(std::size_t number_of_particles)
+{
+  kape::Pheromones pheromones{kape::Pheromones::Type::TO_FOOD,
+                              2. * kape::Ant::CIRCLE_OF_VISION_RADIUS,
+                              BENCHMARK_AREA, BENCHMARK_SEED};
+  std::default_random_engine engine{BENCHMARK_SEED + 1u};
+  std::uniform_real_distribution<double> intensity{1., 100.};
+  for (std::size_t i{0}; i != number_of_particles; ++i) {
+    kape::Vector2d const position{randomPoint(BENCHMARK_AREA, engine)};
+    pheromones.addPheromoneParticle(position, intensity(engine));
+  }
+  return pheromones;
+}
+
+void addPheromonesBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+  for (std::size_t number_of_particles : {1000u, 10000u, 100000u}) {
+    std::string const suffix{"/" + std::to_string(number_of_particles)};
+    kape::Pheromones const pheromones{randomPheromones(number_of_particles)};
+    auto const circles{circlesOfVision(BENCHMARK_AREA, BENCHMARK_SEED + 2u)};
+
+    benchmarks.push_back(Benchmark{
+        "Pheromones::getRandomMaxPheromoneParticleInCircle" + suffix,
+        [pheromones, circles](std::size_t iterations) {
+          std::default_random_engine engine{BENCHMARK_SEED};
+          std::size_t found{0};
+          Stopwatch stopwatch;
+          stopwatch.start();
+          for (std::size_t i{0}; i != iterations; ++i) {
+            found += pheromones.getRandomMaxPheromoneParticleInCircle(
+                         circles[i % NUMBER_OF_INPUTS], engine)
+                  != pheromones.end();
+          }
+          stopwatch.stop();
+          benchmark_sink = static_cast<double>(found);
+          return stopwatch.getElapsed();
+        }});
+
+    // the three circles of vision of an ant, looked at in a single pass
+    std::vector<std::array<kape::Circle, 3>> ants_circles_of_vision;
+    for (auto const& circle : circles) {
+      kape::Ant const ant{circle.getCircleCenter(), kape::Vector2d{1., 0.}, 0};
+      ants_circles_of_vision.emplace_back();
+      ant.calculateCirclesOfVision(ants_circles_of_vision.back());
+    }
+    benchmarks.push_back(Benchmark{
+        "Pheromones::sense" + suffix,
+        [pheromones, ants_circles_of_vision](std::size_t iterations) {
+          std::default_random_engine engine{BENCHMARK_SEED};
+          std::size_t found{0};
+          Stopwatch stopwatch;
+          stopwatch.start();
+          for (std::size_t i{0}; i != iterations; ++i) {
+            // as the ants do
+            auto const sensed{pheromones.sense(
+                ants_circles_of_vision[i % ants_circles_of_vision.size()],
+                engine, false)};
+            for (auto const& circle_sensed : sensed) {
+              found += circle_sensed.number_of_pheromones;
+            }
+          }
+          stopwatch.stop();
+          benchmark_sink = static_cast<double>(found);
+          return stopwatch.getElapsed();
+        }});
+
+    benchmarks.push_back(Benchmark{
+        "Pheromones::getPheromonesIntensityInCircle" + suffix,
+        [pheromones, circles](std::size_t iterations) {
+          double total_intensity{0.};
+          Stopwatch stopwatch;
+          stopwatch.start();
+          for (std::size_t i{0}; i != iterations; ++i) {
+            total_intensity += pheromones.getPheromonesIntensityInCircle(
+                circles[i % NUMBER_OF_INPUTS]);
+          }
+          stopwatch.stop();
+          benchmark_sink = total_intensity;
+          return stopwatch.getElapsed();
+        }});
+
+    // every call evaporates all the particles. Evaporating the same pheromones
+    // too many times would leave fewer and fewer particles: they are restored
+    // every EVAPORATIONS_PER_COPY calls, outside of the measured time
+    benchmarks.push_back(Benchmark{
+        "Pheromones::updateParticlesEvaporation" + suffix,
+        [pheromones](std::size_t iterations) {
+          std::size_t const EVAPORATIONS_PER_COPY{10};
+          Stopwatch stopwatch;
+          for (std::size_t done{0}; done < iterations;) {
+            kape::Pheromones copy{pheromones};
+            std::size_t const batch{
+                std::min(EVAPORATIONS_PER_COPY, iterations - done)};
+            stopwatch.start();
+            for (std::size_t i{0}; i != batch; ++i) {
+              copy.updateParticlesEvaporation(
+                  kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+            }
+            stopwatch.stop();
+            benchmark_sink = static_cast<double>(copy.getNumberOfPheromones());
+            done += batch;
+          }
+          return stopwatch.getElapsed();
+        }});
+  }
+}
+
+// Food------------------------------
+void addFoodBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+  for (std::size_t number_of_particles : {1000u, 10000u, 100000u}) {
+    kape::Circle const cluster{kape::Vector2d{0., 0.}, 0.1};
+    kape::Obstacles const no_obstacles;
+    kape::Food food{BENCHMARK_SEED};
+    food.generateFoodInCircle(cluster, number_of_particles, no_obstacles);
+    // the queries are around the cluster, so that some of them find food
+    auto const circles{circlesOfVision(
+        kape::Rectangle{kape::Vector2d{-0.12, 0.12}, 0.24, 0.24},
+        BENCHMARK_SEED + 1u)};
+
+    // the particles are restored when half of them have been removed, outside
+    // of the measured time, so that the density stays about the same
+    benchmarks.push_back(Benchmark{
+        "Food::removeOneFoodParticleInCircle/"
+            + std::to_string(number_of_particles),
+        [food, circles, number_of_particles](std::size_t iterations) {
+          std::size_t const removals_per_copy{number_of_particles / 2};
+          std::size_t removed{0};
+          Stopwatch stopwatch;
+          for (std::size_t done{0}; done < iterations;) {
+            kape::Food copy{food};
+            std::size_t const batch{
+                std::min(removals_per_copy, iterations - done)};
+            stopwatch.start();
+            for (std::size_t i{0}; i != batch; ++i) {
+              removed += copy.removeOneFoodParticleInCircle(
+                  circles[(done + i) % NUMBER_OF_INPUTS]);
+            }
+            stopwatch.stop();
+            done += batch;
+          }
+          benchmark_sink = static_cast<double>(removed);
+          return stopwatch.getElapsed();
+        }});
+  }
+}
+
+// Ants------------------------------
+// a whole simulation, loaded like Simulation::loadSimulation() does
+struct BenchmarkMap
+{
+  kape::Obstacles obstacles;
+  kape::Anthill anthill;
+  kape::Food food;
+  kape::Ants ants;
+  kape::Pheromones to_anthill_ph;
+  kape::Pheromones to_food_ph;
+
+  explicit BenchmarkMap(std::size_t number_of_threads)
+      : obstacles{}
+      , anthill{}
+      , food{BENCHMARK_SEED}
+      , ants{BENCHMARK_SEED, number_of_threads}
+      , to_anthill_ph{kape::Pheromones::Type::TO_ANTHILL,
+                      2. * kape::Ant::CIRCLE_OF_VISION_RADIUS, BENCHMARK_SEED}
+      , to_food_ph{kape::Pheromones::Type::TO_FOOD,
+                   2. * kape::Ant::CIRCLE_OF_VISION_RADIUS, BENCHMARK_SEED}
+  {}
+
+  // throws std::runtime_error if it fails
+  void load(std::string const& map_name)
+  {
+    std::string const path{"./assets/simulations/" + map_name + '/'};
+    if (!(obstacles.loadFromFile(path + "obstacles/obstacles.dat")
+          && anthill.loadFromFile(obstacles, path + "anthill/anthill.dat")
+          && food.loadFromFile(obstacles, path + "food/food.dat")
+          && ants.loadFromFile(anthill, path + "ants/ants.dat"))) {
+      throw std::runtime_error{"couldn't load the map \"" + path + "\""};
+    }
+    if (obstacles.getNumberOfObstacles() != 0) {
+      kape::Rectangle const bounds{obstacles.getBoundingBox()};
+      to_anthill_ph = kape::Pheromones{kape::Pheromones::Type::TO_ANTHILL,
+                                       2. * kape::Ant::CIRCLE_OF_VISION_RADIUS,
+                                       bounds, BENCHMARK_SEED};
+      to_food_ph    = kape::Pheromones{kape::Pheromones::Type::TO_FOOD,
+                                    2. * kape::Ant::CIRCLE_OF_VISION_RADIUS,
+                                    bounds, BENCHMARK_SEED};
+    }
+  }
+
+  // like Simulation::update()
+  void step(double delta_t)
+  {
+    ants.update(food, to_anthill_ph, to_food_ph, anthill, obstacles, delta_t);
+    to_anthill_ph.updateParticlesEvaporation(delta_t);
+    to_food_ph.updateParticlesEvaporation(delta_t);
+  }
+};
+
+// the ants are measured after WARM_UP_STEPS, when they have left the anthill
+// and the map is full of pheromones. Every repetition starts again from the
+// map's files, so that all of them measure the same steps
+std::size_t const WARM_UP_STEPS{1000};
+std::size_t const MEASURED_STEPS{200};
+double const DELTA_T{0.01}; // the same as the simulation's
+
+void addAntsBenchmarks(std::vector<Benchmark>& benchmarks,
+                       std::size_t number_of_threads)
+{
+  for (std::string const map_name : {"map_1", "map_2", "spiral_map"}) {
+    benchmarks.push_back(Benchmark{
+        "Ants::update/" + map_name,
+        [map_name, number_of_threads](std::size_t iterations) {
+          BenchmarkMap map{number_of_threads};
+          map.load(map_name);
+          for (std::size_t i{0}; i != WARM_UP_STEPS; ++i) {
+            map.step(DELTA_T);
+          }
+
+          Stopwatch stopwatch;
+          for (std::size_t i{0}; i != iterations; ++i) {
+            stopwatch.start();
+            map.ants.update(map.food, map.to_anthill_ph, map.to_food_ph,
+                            map.anthill, map.obstacles, DELTA_T);
+            stopwatch.stop();
+            map.to_anthill_ph.updateParticlesEvaporation(DELTA_T);
+            map.to_food_ph.updateParticlesEvaporation(DELTA_T);
+          }
+          benchmark_sink = map.anthill.getFoodCounter();
+          return stopwatch.getElapsed();
+        },
+        MEASURED_STEPS});
+  }
+}
+
+// running and reporting------------------------------
+BenchmarkResult runBenchmark(Benchmark const& benchmark,
+                             BenchmarkOptions const& options)
+{
+  BenchmarkResult result{benchmark.name, benchmark.fixed_iterations, {}, {}};
+
+  try {
+    // the number of iterations grows until a run lasts at least min_time
+    if (result.iterations == 0) {
+      result.iterations = 1;
+      double elapsed{benchmark.run(result.iterations)};
+      while (elapsed < options.min_time) {
+        double const growth{elapsed > 0. ? 1.4 * options.min_time / elapsed
+                                         : 10.};
+        result.iterations = static_cast<std::size_t>(
+            static_cast<double>(result.iterations)
+            * std::clamp(growth, 2., 10.));
+        elapsed = benchmark.run(result.iterations);
+      }
+    }
+
+    for (std::size_t i{0}; i != options.number_of_repetitions; ++i) {
+      double const elapsed{benchmark.run(result.iterations)};
+      result.times_ns.push_back(elapsed * 1.e9
+                                / static_cast<double>(result.iterations));
+    }
+  } catch (std::exception const& error) {
+    result.times_ns.clear();
+    result.error = error.what();
+  }
+
+  return result;
+}
+
+// only the characters that can appear in the benchmarks' names and errors
+std::string escapeJson(std::string const& text)
+{
+  std::string escaped;
+  for (char character : text) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+    }
+    escaped += character;
+  }
+  return escaped;
+}
+
+void printResults(std::ostream& out, std::vector<BenchmarkResult> const& results,
+                  BenchmarkOptions const& options)
+{
+  std::time_t const now{std::time(nullptr)};
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+  out << std::setprecision(6) << std::fixed;
+  out << "{\n"
+      << "  \"context\": {\n"
+      << "    \"date\": \"" << date << "\",\n"
+      << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+      << "    \"assertions\": false,\n"
+#else
+      << "    \"assertions\": true,\n"
+#endif
+      << "    \"repetitions\": " << options.number_of_repetitions << ",\n"
+      << "    \"min_time\": " << options.min_time << ",\n"
+      << "    \"threads\": " << options.number_of_threads << ",\n"
+      << "    \"seed\": " << BENCHMARK_SEED << "\n"
+      << "  },\n"
+      << "  \"benchmarks\": [";
+
+  for (std::size_t i{0}; i != results.size(); ++i) {
+    BenchmarkResult const& result{results[i]};
+    out << (i == 0 ? "\n" : ",\n") << "    {\n"
+        << "      \"name\": \"" << escapeJson(result.name) << "\",\n";
+    if (!result.error.empty()) {
+      out << "      \"error\": \"" << escapeJson(result.error) << "\"\n"
+          << "    }";
+      continue;
+    }
+
+    std::vector<double> times{result.times_ns};
+    std::sort(times.begin(), times.end());
+    double const median{times.size() % 2 == 1
+                            ? times[times.size() / 2]
+                            : (times[times.size() / 2 - 1]
+                               + times[times.size() / 2])
+                                  / 2.};
+    double const mean{std::accumulate(times.begin(), times.end(), 0.)
+                      / static_cast<double>(times.size())};
+
+    out << "      \"iterations\": " << result.iterations << ",\n"
+        << "      \"time_unit\": \"ns\",\n"
+        << "      \"median\": " << median << ",\n"
+        << "      \"mean\": " << mean << ",\n"
+        << "      \"min\": " << times.front() << ",\n"
+        << "      \"max\": " << times.back() << "\n"
+        << "    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+void printUsage(std::string const& program_name)
+{
+  std::cout
+      << "Usage: " << program_name << " [options]\n"
+      << "Options:\n"
+         "  --filter <text>     run only the benchmarks whose name contains "
+         "<text>\n"
+         "  --out <file>        write the JSON results to <file> instead of "
+         "the\n"
+         "                      standard output\n"
+         "  --repetitions <n>   times every benchmark is repeated (default: "
+         "5)\n"
+         "  --min-time <s>      minimum duration of a repetition (default: "
+         "0.2)\n"
+         "  --threads <n>       threads used by Ants::update (default: 1, 0 "
+         "means\n"
+         "                      one per hardware thread)\n"
+         "  --list              print the names of the benchmarks and exit\n"
+         "  --help              show this message\n";
+}
+
+// throws std::invalid_argument if the arguments are badly formatted
+BenchmarkOptions parseCommandLine(int argc, char* argv[], bool& list_only)
+{
+  BenchmarkOptions options;
+  list_only = false;
+
+  for (int index{1}; index < argc; ++index) {
+    std::string const argument{argv[index]};
+
+    if (argument == "--help" || argument == "-h") {
+      options.show_help = true;
+      continue;
+    }
+    if (argument == "--list") {
+      list_only = true;
+      continue;
+    }
+
+    if (argument != "--filter" && argument != "--out"
+        && argument != "--repetitions" && argument != "--min-time"
+        && argument != "--threads") {
+      throw std::invalid_argument{"unknown option \"" + argument + "\""};
+    }
+
+    // all the other options need a value
+    if (index + 1 >= argc) {
+      throw std::invalid_argument{"missing value after \"" + argument + "\""};
+    }
+    std::string const value{argv[++index]};
+
+    try {
+      if (argument == "--filter") {
+        options.filter = value;
+      } else if (argument == "--out") {
+        options.output_filepath = value;
+      } else if (argument == "--repetitions") {
+        options.number_of_repetitions = std::stoul(value);
+      } else if (argument == "--min-time") {
+        options.min_time = std::stod(value);
+      } else {
+        options.number_of_threads = std::stoul(value);
+      }
+    } catch (std::logic_error const&) { // not a number or out of range
+      throw std::invalid_argument{"invalid value \"" + value + "\" for \""
+                                  + argument + "\""};
+    }
+  }
+
+  if (options.number_of_repetitions == 0) {
+    throw std::invalid_argument{"--repetitions must be at least 1"};
+  }
+  if (options.min_time <= 0.) {
+    throw std::invalid_argument{"--min-time must be positive"};
+  }
+
+  return options;
+}
+
+int main(int argc, char* argv[])
+{
+  BenchmarkOptions options;
+  bool list_only;
+  try {
+    options = parseCommandLine(argc, argv, list_only);
+  } catch (std::invalid_argument const& error) {
+    std::cout << "[ERROR]: " << error.what() << "\n\n";
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  if (options.show_help) {
+    printUsage(argv[0]);
+    return 0;
+  }
+
+  std::vector<Benchmark> benchmarks;
+  addGeometryBenchmarks(benchmarks);
+  addObstaclesBenchmarks(benchmarks);
+  addPheromonesBenchmarks(benchmarks);
+  addFoodBenchmarks(benchmarks);
+  addAntsBenchmarks(benchmarks, options.number_of_threads);
+
+  std::vector<BenchmarkResult> results;
+  for (auto const& benchmark : benchmarks) {
+    if (benchmark.name.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    if (list_only) {
+      std::cout << benchmark.name << '\n';
+      continue;
+    }
+    std::cerr << "[INFO]: running " << benchmark.name << '\n';
+    results.push_back(runBenchmark(benchmark, options));
+  }
+
+  if (list_only) {
+    return 0;
+  }
+
+  if (options.output_filepath.empty()) {
+    printResults(std::cout, results, options);
+    return 0;
+  }
+
+  std::ofstream file_out{options.output_filepath, std::ios::out};
+  if (!file_out.is_open()) {
+    std::cout << "[ERROR]: couldn't open \"" << options.output_filepath
+              << "\"\n";
+    return 1;
+  }
+  printResults(file_out, results, options);
+  return 0;
+}
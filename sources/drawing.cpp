@@ -2,7 +2,7 @@
 #include "ants.hpp"
 #include "geometry.hpp"
 #include "logger.hpp"
-#include <algorithm> //for transform
+#include <algorithm> //for max and max_element
 #include <cassert>
 #include <cmath> //for std::round
 #include <iostream>
@@ -71,44 +71,105 @@ float CoordinateConverter::worldToScreenRotation(double angle) const
   return static_cast<float>(90 - angle * 180. / PI);
 }
 
-// Window implementation---------------------------------------
-void Window::loadForDrawing(Food const& food, sf::Color const& food_color)
-{
-  unsigned int window_width{window_.getSize().x};
-  unsigned int window_height{window_.getSize().y};
+sf::Transform
+CoordinateConverter::worldToScreenTransform(unsigned int window_width,
+                                            unsigned int window_height) const
+{
+  // the last transformation is the first one to be applied
+  sf::Transform transform;
+  transform.translate(static_cast<float>(window_width) / 2.f,
+                      static_cast<float>(window_height) / 2.f);
+  transform.scale(meter_to_pixels_, -meter_to_pixels_);
+  return transform;
+}
+
+// RenderFrame implementation----------------------------------
+void loadRenderFrame(RenderFrame& frame, Ants const& ants, Food const& food,
+                     Pheromones const& to_anthill_pheromones,
+                     Pheromones const& to_food_pheromones,
+                     Anthill const& anthill, sf::Color const& food_color,
+                     sf::Color const& to_anthill_pheromones_color,
+                     sf::Color const& to_food_pheromones_color)
+{
+  frame.ants    = ants.getAntsData();
+  frame.anthill = anthill;
+
+  if (frame.food.version != food.getVersion()) {
+    frame.food.points.clear();
+    for (auto const& food_particle : food) {
+      frame.food.points.emplace_back(
+          sf::Vector2f{static_cast<float>(food_particle.getPosition().x),
+                       static_cast<float>(food_particle.getPosition().y)},
+          food_color);
+    }
+    frame.food.version = food.getVersion();
+  }
 
-  std::transform(food.begin(), food.end(), std::back_inserter(points_vector_),
-                 [window_width, window_height, &food_color,
-                  this](FoodParticle const& food_particle) {
-                   sf::Vertex food_drawing{
-                       coord_conv_.worldToScreen(food_particle.getPosition(),
-                                                 window_width, window_height)};
-                   food_drawing.color = food_color;
-                   return food_drawing;
-                 });
+  auto const load_pheromones = [](RenderFrame::PointsLayer& layer,
+                                  Pheromones const& pheromones,
+                                  sf::Color const& color) {
+    if (layer.version == pheromones.getVersion()) {
+      return;
+    }
+    layer.points.clear();
+    renderInto(
+        layer.points, pheromones,
+        [](Vector2d const& pheromone_position, sf::Vector2f& position) {
+          position = sf::Vector2f{static_cast<float>(pheromone_position.x),
+                                  static_cast<float>(pheromone_position.y)};
+        },
+        color);
+    layer.version = pheromones.getVersion();
+  };
+  load_pheromones(frame.to_anthill_pheromones, to_anthill_pheromones,
+                  to_anthill_pheromones_color);
+  load_pheromones(frame.to_food_pheromones, to_food_pheromones,
+                  to_food_pheromones_color);
 }
 
-void Window::loadForDrawing(Pheromones const& pheromones,
-                            sf::Color const& pheromones_color)
+// PointsLayerBuffer implementation----------------------------
+PointsLayerBuffer::PointsLayerBuffer()
+    : buffer_{sf::Points, sf::VertexBuffer::Stream}
+    , number_of_points_{0}
+    , version_{}
+{}
+
+bool PointsLayerBuffer::update(RenderFrame::PointsLayer const& layer)
 {
-  unsigned int window_width{window_.getSize().x};
-  unsigned int window_height{window_.getSize().y};
+  if (!sf::VertexBuffer::isAvailable()) {
+    return false;
+  }
+  if (version_.has_value() && version_ == layer.version) {
+    return true;
+  }
+
+  // the buffer only grows, so that it's rarely allocated again
+  if (layer.points.size() > buffer_.getVertexCount()
+      && !buffer_.create(layer.points.size())) {
+    version_.reset();
+    return false;
+  }
+  if (!layer.points.empty()
+      && !buffer_.update(layer.points.data(), layer.points.size(), 0)) {
+    version_.reset();
+    return false;
+  }
+  number_of_points_ = layer.points.size();
+  version_          = layer.version;
+  return true;
+}
 
-  renderInto(
-      points_vector_, pheromones,
-      [window_width, window_height, this](
-          PheromoneParticle const& pheromone_particle, sf::Vector2f& position) {
-        position = coord_conv_.worldToScreen(pheromone_particle.getPosition(),
-                                             window_width, window_height);
-      },
-      pheromones_color);
+sf::VertexBuffer const& PointsLayerBuffer::getBuffer() const
+{
+  return buffer_;
 }
 
-void Window::drawLoaded()
+std::size_t PointsLayerBuffer::getNumberOfPoints() const
 {
-  draw(points_vector_);
+  return number_of_points_;
 }
 
+// Window implementation---------------------------------------
 void Window::createWindow()
 {
   if (isOpen()) {
@@ -176,10 +237,12 @@ Window::kapeRectangleToScreenSfRectangleShape(Rectangle const& rectangle) const
 Window::Window(float meter_to_pixel)
     : window_{}
     , coord_conv_{meter_to_pixel}
-    , ants_animation_frames_{}
+    , ants_texture_atlas_{}
+    , ants_frames_rects_{}
+    , ants_vertices_{}
     , font_{}
     , is_fullscreen_{true}
-    , points_vector_{}
+    , show_profiler_overlay_{false}
     , input_string_{}
 {
   createWindow();
@@ -199,10 +262,12 @@ Window::Window(unsigned int window_width, unsigned int window_height,
                float meter_to_pixel)
     : window_{}
     , coord_conv_{meter_to_pixel}
-    , ants_animation_frames_{}
+    , ants_texture_atlas_{}
+    , ants_frames_rects_{}
+    , ants_vertices_{}
     , font_{}
     , is_fullscreen_{false}
-    , points_vector_{}
+    , show_profiler_overlay_{false}
     , input_string_{}
 {
   createWindow(window_width, window_height);
@@ -306,6 +371,9 @@ void Window::inputHandling()
           createWindow();
         }
         break;
+      case sf::Keyboard::F3:
+        show_profiler_overlay_ = !show_profiler_overlay_;
+        break;
 
       default:
         break;
@@ -341,26 +409,53 @@ bool Window::loadAntAnimationFrames(
   std::string frame_name_suffix = frames_naming_convention.substr(
       subtitute_position + string_to_be_substituted.size());
 
-  ants_animation_frames_.reserve(number_of_animation_frames);
-
+  std::vector<sf::Image> frames(number_of_animation_frames);
   try {
     for (std::size_t current_frame{0};
          current_frame < number_of_animation_frames; ++current_frame) {
-      ants_animation_frames_.push_back(sf::Texture{});
-      if (!ants_animation_frames_.back().loadFromFile(
+      if (!frames[current_frame].loadFromFile(
               animation_frames_filepath + frame_name_prefix
               + std::to_string(current_frame) + frame_name_suffix)) {
         throw std::runtime_error{"failed to load Ant's frame number "
                                  + std::to_string(current_frame)};
       }
     }
+
+    // the frames are placed side by side, from left to right
+    unsigned int atlas_width{0};
+    unsigned int atlas_height{0};
+    for (auto const& frame : frames) {
+      atlas_width += frame.getSize().x;
+      atlas_height = std::max(atlas_height, frame.getSize().y);
+    }
+    if (atlas_width > sf::Texture::getMaximumSize()
+        || atlas_height > sf::Texture::getMaximumSize()) {
+      throw std::runtime_error{"the frames don't fit in a single texture"};
+    }
+
+    sf::Image atlas;
+    atlas.create(atlas_width, atlas_height, sf::Color::Transparent);
+    std::vector<sf::IntRect> frames_rects;
+    frames_rects.reserve(number_of_animation_frames);
+    unsigned int left{0};
+    for (auto const& frame : frames) {
+      atlas.copy(frame, left, 0);
+      frames_rects.emplace_back(static_cast<int>(left), 0,
+                                static_cast<int>(frame.getSize().x),
+                                static_cast<int>(frame.getSize().y));
+      left += frame.getSize().x;
+    }
+    if (!ants_texture_atlas_.loadFromImage(atlas)) {
+      throw std::runtime_error{"failed to create the texture of the frames"};
+    }
+    ants_frames_rects_ = std::move(frames_rects);
   } catch (std::runtime_error const& error) {
     log << "[ERROR]: \tFrom Window::loadAntAnimationFrames(...): failed to "
            "load the ants textures."
         << "\n\t\t\tfilepath: " << animation_frames_filepath
         << "\n\t\t\tnaming convention used: " << frames_naming_convention
         << "\n\t\t\terror reported: " << error.what() << '\n';
-    ants_animation_frames_.clear();
+    ants_frames_rects_.clear();
     return false;
   }
 
@@ -371,7 +466,6 @@ void Window::clear(sf::Color const& color)
 {
   if (isOpen()) {
     window_.clear(color);
-    points_vector_.clear();
   }
 }
 
@@ -406,6 +500,38 @@ void Window::draw(Rectangle const& rectangle, sf::Text const& text,
   draw(kapeRectangleToScreenSfRectangleShape(rectangle), text, rectangle_color);
 }
 
+void Window::drawDebugInfo(Ant const& ant)
+{
+  // render the circles of vision
+  std::array<kape::Circle, 3> circles_of_vision;
+  ant.calculateCirclesOfVision(circles_of_vision);
+  draw(circles_of_vision[0], sf::Color::Blue);
+  draw(circles_of_vision[1], sf::Color::Blue);
+  draw(circles_of_vision[2], sf::Color::Blue);
+
+  // render in green the desired direction, in red the current direction
+  sf::Vector2f const ant_position{coord_conv_.worldToScreen(
+      ant.getPosition(), window_.getSize().x, window_.getSize().y)};
+  std::array<sf::Vertex, 4> direction_lines;
+  direction_lines[0] = sf::Vertex(ant_position, sf::Color::Green);
+  direction_lines[1] =
+      sf::Vertex(coord_conv_.worldToScreen(
+                     ant.getPosition()
+                         + 4. * Ant::ANT_LENGTH * ant.getDesiredDirection(),
+                     window_.getSize().x, window_.getSize().y),
+                 sf::Color::Green);
+
+  direction_lines[2] = sf::Vertex(ant_position, sf::Color::Red);
+  direction_lines[3] = sf::Vertex(
+      coord_conv_.worldToScreen(ant.getPosition()
+                                    + 4. * Ant::ANT_LENGTH * ant.getVelocity()
+                                          / norm(ant.getVelocity()),
+                                window_.getSize().x, window_.getSize().y),
+      sf::Color::Red);
+
+  window_.draw(direction_lines.data(), direction_lines.size(), sf::LinesStrip);
+}
+
 void Window::draw(Ant const& ant, bool debug_mode)
 {
   if (!isOpen()) {
@@ -413,18 +539,16 @@ void Window::draw(Ant const& ant, bool debug_mode)
   }
 
   std::size_t current_frame{static_cast<std::size_t>(ant.getCurrentFrame())};
-  if (current_frame >= ants_animation_frames_.size()) {
+  if (current_frame >= ants_frames_rects_.size()) {
     throw std::runtime_error{"tried to draw a frame [frame "
                              + std::to_string(current_frame)
                              + "] that hasn't been loaded"};
   }
 
-  sf::Sprite ant_drawing;
-  ant_drawing.setTexture(ants_animation_frames_.at(current_frame));
-  float texture_width{
-      static_cast<float>(ant_drawing.getTexture()->getSize().x)};
-  float texture_height{
-      static_cast<float>(ant_drawing.getTexture()->getSize().y)};
+  sf::IntRect const& frame_rect{ants_frames_rects_[current_frame]};
+  sf::Sprite ant_drawing{ants_texture_atlas_, frame_rect};
+  float texture_width{static_cast<float>(frame_rect.width)};
+  float texture_height{static_cast<float>(frame_rect.height)};
   ant_drawing.setOrigin(
       sf::Vector2f{texture_width / 2.f, texture_height / 2.f});
 
@@ -444,41 +568,88 @@ void Window::draw(Ant const& ant, bool debug_mode)
   window_.draw(ant_drawing);
 
   if (debug_mode) {
-    // render the circles of vision
-    std::array<kape::Circle, 3> circles_of_vision;
-    ant.calculateCirclesOfVision(circles_of_vision);
-    draw(circles_of_vision[0], sf::Color::Blue);
-    draw(circles_of_vision[1], sf::Color::Blue);
-    draw(circles_of_vision[2], sf::Color::Blue);
-
-    // render in green the desired direction, in red the current direction
-    std::array<sf::Vertex, 4> direction_lines;
-    direction_lines[0] =
-        sf::Vertex(ant_drawing.getPosition(), sf::Color::Green);
-    direction_lines[1] =
-        sf::Vertex(coord_conv_.worldToScreen(
-                       ant.getPosition()
-                           + 4. * Ant::ANT_LENGTH * ant.getDesiredDirection(),
-                       window_.getSize().x, window_.getSize().y),
-                   sf::Color::Green);
-
-    direction_lines[2] = sf::Vertex(ant_drawing.getPosition(), sf::Color::Red);
-    direction_lines[3] = sf::Vertex(
-        coord_conv_.worldToScreen(ant.getPosition()
-                                      + 4. * Ant::ANT_LENGTH * ant.getVelocity()
-                                            / norm(ant.getVelocity()),
-                                  window_.getSize().x, window_.getSize().y),
-        sf::Color::Red);
-
-    window_.draw(direction_lines.data(), direction_lines.size(),
-                 sf::LinesStrip);
+    drawDebugInfo(ant);
   }
 }
 
 void Window::draw(Ants const& ants, bool debug_mode)
 {
-  for (auto const& ant : ants) {
-    draw(ant, debug_mode);
+  draw(ants.getAntsData(), debug_mode);
+}
+
+void Window::draw(AntsSoA const& data, bool debug_mode)
+{
+  if (!isOpen()) {
+    return;
+  }
+
+  std::size_t const number_of_ants{data.size()};
+  for (std::size_t i{0}; i != number_of_ants; ++i) {
+    if (static_cast<std::size_t>(data.current_frame[i])
+        >= ants_frames_rects_.size()) {
+      throw std::runtime_error{"tried to draw a frame [frame "
+                               + std::to_string(data.current_frame[i])
+                               + "] that hasn't been loaded"};
+    }
+  }
+
+  // the same transformation of draw(Ant const&), done by hand: the quad of
+  // every ant is centered on its position, with its length along the velocity
+  float const half_length{coord_conv_.metersToPixels(Ant::ANT_LENGTH) / 2.f};
+  float const half_width{half_length / 2.f};
+  float const meter_to_pixels{coord_conv_.getMeterToPixels()};
+  sf::Vector2f const screen_center{
+      static_cast<float>(window_.getSize().x) / 2.f,
+      static_cast<float>(window_.getSize().y) / 2.f};
+
+  ants_vertices_.resize(4 * number_of_ants);
+  for (std::size_t i{0}; i != number_of_ants; ++i) {
+    float const center_x{static_cast<float>(data.position_x[i])
+                             * meter_to_pixels
+                         + screen_center.x};
+    float const center_y{-static_cast<float>(data.position_y[i])
+                             * meter_to_pixels
+                         + screen_center.y};
+    // direction of the velocity on the screen, where +y = down
+    double const speed{std::hypot(data.velocity_x[i], data.velocity_y[i])};
+    float const direction_x{static_cast<float>(data.velocity_x[i] / speed)};
+    float const direction_y{static_cast<float>(-data.velocity_y[i] / speed)};
+
+    sf::Vector2f const along{direction_x * half_length,
+                             direction_y * half_length};
+    sf::Vector2f const across{-direction_y * half_width,
+                              direction_x * half_width};
+
+    // the top of the frame is the ant's head
+    sf::IntRect const& frame_rect{
+        ants_frames_rects_[static_cast<std::size_t>(data.current_frame[i])]};
+    float const left{static_cast<float>(frame_rect.left)};
+    float const top{static_cast<float>(frame_rect.top)};
+    float const right{left + static_cast<float>(frame_rect.width)};
+    float const bottom{top + static_cast<float>(frame_rect.height)};
+
+    sf::Vertex* quad{&ants_vertices_[4 * i]};
+    quad[0] = sf::Vertex{
+        {center_x + along.x - across.x, center_y + along.y - across.y},
+        {left, top}};
+    quad[1] = sf::Vertex{
+        {center_x + along.x + across.x, center_y + along.y + across.y},
+        {right, top}};
+    quad[2] = sf::Vertex{
+        {center_x - along.x + across.x, center_y - along.y + across.y},
+        {right, bottom}};
+    quad[3] = sf::Vertex{
+        {center_x - along.x - across.x, center_y - along.y - across.y},
+        {left, bottom}};
+  }
+
+  window_.draw(ants_vertices_.data(), ants_vertices_.size(), sf::Quads,
+               sf::RenderStates{&ants_texture_atlas_});
+
+  if (debug_mode) {
+    for (std::size_t i{0}; i != number_of_ants; ++i) {
+      drawDebugInfo(data.getAnt(i));
+    }
   }
 }
 
@@ -505,24 +676,47 @@ void Window::draw(Obstacles const& obstacles, sf::Color const& color)
   }
 }
 
-void Window::draw(Food const& food, Pheromones const& to_anthill_pheromones,
-                  Pheromones const& to_food_pheromones,
-                  sf::Color const& food_color,
-                  sf::Color const& to_anthill_pheromones_color,
-                  sf::Color const& to_food_pheromones_color)
+void Window::draw(RenderFrame::PointsLayer const& layer,
+                  PointsLayerBuffer& layer_buffer)
 {
-  loadForDrawing(food, food_color);
-  loadForDrawing(to_anthill_pheromones, to_anthill_pheromones_color);
-  loadForDrawing(to_food_pheromones, to_food_pheromones_color);
+  if (!isOpen()) {
+    return;
+  }
 
-  drawLoaded();
+  sf::RenderStates const states{coord_conv_.worldToScreenTransform(
+      window_.getSize().x, window_.getSize().y)};
+  if (layer_buffer.update(layer)) {
+    window_.draw(layer_buffer.getBuffer(), 0, layer_buffer.getNumberOfPoints(),
+                 states);
+  } else if (!layer.points.empty()) {
+    window_.draw(layer.points.data(), layer.points.size(), sf::Points, states);
+  }
 }
 
-void Window::draw(std::vector<sf::Vertex> const& points)
+void Window::drawProfilerOverlay(Profiler const& phases_profiler)
 {
-  if (!points.empty()) {
-    window_.draw(points.data(), points.size(), sf::Points);
+  if (!show_profiler_overlay_) {
+    return;
   }
+
+  float const MARGIN{10.f};
+  sf::Text text;
+  text.setCharacterSize(16);
+  text.setFillColor(sf::Color::White);
+  text.setFont(font_);
+  text.setString(phases_profiler.toText());
+  text.setPosition(2.f * MARGIN, 2.f * MARGIN);
+
+  // translucent, so that the simulation can still be seen behind it
+  sf::FloatRect const text_bounds{text.getGlobalBounds()};
+  sf::RectangleShape background{
+      sf::Vector2f{text_bounds.width + 2.f * MARGIN,
+                   text_bounds.height + 2.f * MARGIN}};
+  background.setPosition(text_bounds.left - MARGIN, text_bounds.top - MARGIN);
+  background.setFillColor(sf::Color{0, 0, 0, 160});
+
+  window_.draw(background);
+  window_.draw(text);
 }
 
 void Window::display()
@@ -3,7 +3,10 @@
 #include "ants.hpp"
 #include "environment.hpp"
 #include "geometry.hpp"
+#include "profiler.hpp"
 #include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -31,6 +34,59 @@ class CoordinateConverter
 
   // note: angle is in radians, the returned angle is in degrees
   float worldToScreenRotation(double angle) const;
+
+  // the same transformation of worldToScreen(), to be applied by SFML to
+  // vertices whose positions are in meters
+  sf::Transform worldToScreenTransform(unsigned int window_width,
+                                       unsigned int window_height) const;
+};
+
+// what changes in a simulation and is drawn, copied at one instant, so that it
+// can be drawn by a thread while the simulation goes on in another one. The
+// positions of the points are in meters: they're converted to the screen only
+// when drawn, with the zoom of that moment
+struct RenderFrame
+{
+  // points drawn together, with their positions in meters
+  struct PointsLayer
+  {
+    std::vector<sf::Vertex> points;
+    // version of the Food or Pheromones the points come from, empty if none
+    std::optional<std::uint64_t> version;
+  };
+
+  AntsSoA ants;
+  PointsLayer food;
+  PointsLayer to_anthill_pheromones;
+  PointsLayer to_food_pheromones;
+  Anthill anthill;
+};
+
+// overwrites frame, reusing the memory it already holds. The layers of the
+// points are rebuilt only if the Food or Pheromones they come from changed
+void loadRenderFrame(RenderFrame& frame, Ants const& ants, Food const& food,
+                     Pheromones const& to_anthill_pheromones,
+                     Pheromones const& to_food_pheromones,
+                     Anthill const& anthill, sf::Color const& food_color,
+                     sf::Color const& to_anthill_pheromones_color,
+                     sf::Color const& to_food_pheromones_color);
+
+// a RenderFrame::PointsLayer kept by the graphics card: it's uploaded again
+// only when the version of the layer changes
+class PointsLayerBuffer
+{
+ private:
+  sf::VertexBuffer buffer_;
+  std::size_t number_of_points_;
+  std::optional<std::uint64_t> version_;
+
+ public:
+  explicit PointsLayerBuffer();
+  // returns false if the graphics card doesn't support vertex buffers, or the
+  // upload failed
+  bool update(RenderFrame::PointsLayer const& layer);
+  sf::VertexBuffer const& getBuffer() const;
+  std::size_t getNumberOfPoints() const;
 };
 
 class Window
@@ -38,20 +94,23 @@ class Window
  private:
   sf::RenderWindow window_;
   CoordinateConverter coord_conv_;
-  std::vector<sf::Texture> ants_animation_frames_;
+  // the animation frames of the ants, side by side in a single texture, so
+  // that all the ants can be drawn with a single call
+  sf::Texture ants_texture_atlas_;
+  // ants_frames_rects_[i] is the part of ants_texture_atlas_ holding frame i
+  std::vector<sf::IntRect> ants_frames_rects_;
+  // four vertices per ant, rebuilt by draw(Ants const&) at every frame
+  std::vector<sf::Vertex> ants_vertices_;
   sf::Font font_;
 
   bool is_fullscreen_;
+  // toggled with F3
+  bool show_profiler_overlay_;
 
-  // holds the points of Food and Pheromones to be drawn on the next
-  // display() call gets cleared with clear()
-  std::vector<sf::Vertex> points_vector_;
   sf::String input_string_;
 
-  void loadForDrawing(Food const& food, sf::Color const& food_color);
-  void loadForDrawing(Pheromones const& pheromones,
-                      sf::Color const& pheromones_color);
-  void drawLoaded();
+  // draws the circles of vision and the directions of the ant
+  void drawDebugInfo(Ant const& ant);
   // creates/recreates the window, making it fullscreen
   void createWindow();
   // creates/recreates the window with the specified dimensions
@@ -79,7 +138,7 @@ class Window
   bool isOpen() const;
   void inputHandling();
   // Note: the first frame, if frames_naming_convention is left as is, would be
-  // Ant_frame_0.png.
+  // Ant_frame_0.png. The frames are packed side by side into a single texture
   // The function won't do anything if it fails to load from the path
   // may throw std::invalid argument if "[X]" isn't in frames_naming_convention
   bool loadAntAnimationFrames(
@@ -92,15 +151,21 @@ class Window
   void draw(Rectangle const& rectangle, sf::Color const& color);
   void draw(Rectangle const& rectangle, sf::Text const& text,
             sf::Color const& rectangle_color);
+  // may throw std::runtime_error if the ant's frame hasn't been loaded
   void draw(Ant const& ant, bool debug_mode = false);
+  // all the ants are drawn with a single draw call
+  // may throw std::runtime_error if one of the frames hasn't been loaded
   void draw(Ants const& ants, bool debug_mode = false);
+  void draw(AntsSoA const& ants, bool debug_mode = false);
   void draw(Anthill const& anthill, sf::Color const& color);
   void draw(Obstacles const& obstacles, sf::Color const& color);
-  void draw(Food const& food, Pheromones const& to_anthill_pheromones,
-            Pheromones const& to_food_pheromones, sf::Color const& food_color,
-            sf::Color const& to_anthill_pheromones_color,
-            sf::Color const& to_food_pheromones_color);
-  void draw(std::vector<sf::Vertex> const& points);
+  // layer_buffer keeps the layer on the graphics card between the calls. If
+  // the vertex buffers aren't supported the points are sent at every call
+  void draw(RenderFrame::PointsLayer const& layer,
+            PointsLayerBuffer& layer_buffer);
+  // the times of the phases of the steps, in the top left corner, if the
+  // overlay has been turned on with F3
+  void drawProfilerOverlay(Profiler const& phases_profiler);
   void display();
   void close();
 
@@ -2,12 +2,14 @@
 #include "drawing.hpp"
 #include "geometry.hpp"
 #include "logger.hpp"
+#include "profiler.hpp"
+#include "snapshot.hpp"
 #include <algorithm> //for find_if and remove_if any_of
 #include <cassert>
 #include <cmath> //for std::ceil and something else
 #include <cstring>
-#include <deque>
 #include <fstream>
+#include <limits>
 #include <numeric> //for accumulate
 #include <random>
 #include <stdexcept> //invalid_argument
@@ -16,29 +18,227 @@
 namespace kape {
 
 // implementation of class Obstacles-----------------------------------
+void Obstacles::buildGrid()
+{
+  version_ = ++last_version_;
+  grid_cell_offsets_.clear();
+  grid_obstacle_indices_.clear();
+  if (obstacles_vec_.empty()) {
+    grid_width_  = 0;
+    grid_height_ = 0;
+    return;
+  }
+
+  Rectangle const bounding_box{getBoundingBox()};
+  double const width{bounding_box.getRectangleWidth()};
+  double const height{bounding_box.getRectangleHeight()};
+  grid_origin_ =
+      bounding_box.getRectangleTopLeftCorner() - Vector2d{0., height};
+
+  std::size_t const number_of_cells{
+      std::clamp(obstacles_vec_.size() * GRID_CELLS_PER_OBSTACLE_,
+                 std::size_t{1}, MAX_GRID_CELLS_)};
+  // square cells; the second bound keeps a very elongated grid from having too
+  // many columns (or rows)
+  grid_cell_size_ =
+      std::max(std::sqrt(width * height / static_cast<double>(number_of_cells)),
+               std::max(width, height) / static_cast<double>(MAX_GRID_CELLS_));
+  grid_width_ = std::max(
+      std::size_t{1},
+      static_cast<std::size_t>(std::ceil(width / grid_cell_size_)));
+  grid_height_ = std::max(
+      std::size_t{1},
+      static_cast<std::size_t>(std::ceil(height / grid_cell_size_)));
+
+  // the obstacles are inserted in two passes: first counting how many there
+  // are in each cell, then writing their indices
+  auto const for_each_cell_of{[this](Rectangle const& obstacle, auto function) {
+    Vector2d const& top_left{obstacle.getRectangleTopLeftCorner()};
+    // an obstacle is always inside the grid
+    GridRange const range{*getGridRange(
+        top_left - Vector2d{0., obstacle.getRectangleHeight()},
+        top_left + Vector2d{obstacle.getRectangleWidth(), 0.})};
+    for (std::size_t row{range.first_row}; row <= range.last_row; ++row) {
+      for (std::size_t column{range.first_column}; column <= range.last_column;
+           ++column) {
+        function(row * grid_width_ + column);
+      }
+    }
+  }};
+
+  grid_cell_offsets_.assign(grid_width_ * grid_height_ + 1, 0);
+  for (auto const& obstacle : obstacles_vec_) {
+    for_each_cell_of(obstacle, [this](std::size_t cell) {
+      ++grid_cell_offsets_[cell + 1];
+    });
+  }
+  std::partial_sum(grid_cell_offsets_.begin(), grid_cell_offsets_.end(),
+                   grid_cell_offsets_.begin());
+
+  grid_obstacle_indices_.resize(grid_cell_offsets_.back());
+  std::vector<std::size_t> next_free{grid_cell_offsets_.begin(),
+                                     grid_cell_offsets_.end() - 1};
+  for (std::size_t index{0}; index != obstacles_vec_.size(); ++index) {
+    for_each_cell_of(obstacles_vec_[index], [&](std::size_t cell) {
+      grid_obstacle_indices_[next_free[cell]++] = index;
+    });
+  }
+}
+
+// returns an empty optional if the box doesn't overlap the grid
+std::optional<Obstacles::GridRange>
+Obstacles::getGridRange(Vector2d const& bottom_left,
+                        Vector2d const& top_right) const
+{
+  if (grid_width_ == 0) {
+    return std::nullopt;
+  }
+
+  double const grid_right{grid_origin_.x
+                          + grid_cell_size_ * static_cast<double>(grid_width_)};
+  double const grid_top{grid_origin_.y
+                        + grid_cell_size_ * static_cast<double>(grid_height_)};
+  if (top_right.x < grid_origin_.x || bottom_left.x > grid_right
+      || top_right.y < grid_origin_.y || bottom_left.y > grid_top) {
+    return std::nullopt;
+  }
+
+  // clamped before the conversion, so that it's always representable
+  auto const to_cell{[this](double coordinate, double origin,
+                            std::size_t number_of_cells) {
+    double const cell{std::floor((coordinate - origin) / grid_cell_size_)};
+    return static_cast<std::size_t>(std::clamp(
+        cell, 0., static_cast<double>(number_of_cells - 1)));
+  }};
+
+  return GridRange{to_cell(bottom_left.x, grid_origin_.x, grid_width_),
+                   to_cell(top_right.x, grid_origin_.x, grid_width_),
+                   to_cell(bottom_left.y, grid_origin_.y, grid_height_),
+                   to_cell(top_right.y, grid_origin_.y, grid_height_)};
+}
+
 Obstacles::Obstacles()
+    : obstacles_vec_{}
+    , grid_origin_{0., 0.}
+    , grid_cell_size_{1.}
+    , grid_width_{0}
+    , grid_height_{0}
+    , grid_cell_offsets_{}
+    , grid_obstacle_indices_{}
+    , version_{++last_version_}
 {}
 
 std::size_t Obstacles::getNumberOfObstacles() const
 {
   return obstacles_vec_.size();
 }
+
+std::uint64_t Obstacles::getVersion() const
+{
+  return version_;
+}
 void Obstacles::addObstacle(Vector2d const& top_left_corner, double width,
                             double height)
 {
-  obstacles_vec_.push_back(Rectangle{top_left_corner, width, height});
+  addObstacle(Rectangle{top_left_corner, width, height});
 }
 void Obstacles::addObstacle(Rectangle const& obstacle)
 {
   obstacles_vec_.push_back(obstacle);
+  buildGrid();
 }
 
 bool Obstacles::anyObstaclesInCircle(Circle const& circle) const
 {
-  return std::any_of(obstacles_vec_.begin(), obstacles_vec_.end(),
-                     [&circle](Rectangle const& obstacle) {
-                       return doShapesIntersect(circle, obstacle);
-                     });
+  Vector2d const& center{circle.getCircleCenter()};
+  double const radius{circle.getCircleRadius()};
+  auto const range{getGridRange(center - Vector2d{radius, radius},
+                                center + Vector2d{radius, radius})};
+  if (!range.has_value()) {
+    return false;
+  }
+
+  for (std::size_t row{range->first_row}; row <= range->last_row; ++row) {
+    for (std::size_t column{range->first_column}; column <= range->last_column;
+         ++column) {
+      std::size_t const cell{row * grid_width_ + column};
+      for (std::size_t i{grid_cell_offsets_[cell]};
+           i != grid_cell_offsets_[cell + 1]; ++i) {
+        if (doShapesIntersect(circle,
+                              obstacles_vec_[grid_obstacle_indices_[i]])) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+std::array<bool, 3>
+Obstacles::anyObstaclesInCircles(std::array<Circle, 3> const& circles) const
+{
+  std::array<bool, 3> any_obstacles{false, false, false};
+
+  // box containing all the circles
+  Vector2d bottom_left{circles[0].getCircleCenter()};
+  Vector2d top_right{circles[0].getCircleCenter()};
+  for (auto const& circle : circles) {
+    Vector2d const& center{circle.getCircleCenter()};
+    double const radius{circle.getCircleRadius()};
+    bottom_left.x = std::min(bottom_left.x, center.x - radius);
+    bottom_left.y = std::min(bottom_left.y, center.y - radius);
+    top_right.x   = std::max(top_right.x, center.x + radius);
+    top_right.y   = std::max(top_right.y, center.y + radius);
+  }
+
+  auto const range{getGridRange(bottom_left, top_right)};
+  if (!range.has_value()) {
+    return any_obstacles;
+  }
+
+  for (std::size_t row{range->first_row}; row <= range->last_row; ++row) {
+    for (std::size_t column{range->first_column}; column <= range->last_column;
+         ++column) {
+      std::size_t const cell{row * grid_width_ + column};
+      for (std::size_t i{grid_cell_offsets_[cell]};
+           i != grid_cell_offsets_[cell + 1]; ++i) {
+        Rectangle const& obstacle{obstacles_vec_[grid_obstacle_indices_[i]]};
+        for (std::size_t c{0}; c != circles.size(); ++c) {
+          any_obstacles[c] =
+              any_obstacles[c] || doShapesIntersect(circles[c], obstacle);
+        }
+        if (any_obstacles[0] && any_obstacles[1] && any_obstacles[2]) {
+          return any_obstacles;
+        }
+      }
+    }
+  }
+  return any_obstacles;
+}
+
+// may throw std::runtime_error if there are no obstacles
+Rectangle Obstacles::getBoundingBox() const
+{
+  if (obstacles_vec_.empty()) {
+    throw std::runtime_error{
+        "can't compute the bounding box of Obstacles without obstacles"};
+  }
+
+  Vector2d const& first_corner{
+      obstacles_vec_.front().getRectangleTopLeftCorner()};
+  double left{first_corner.x};
+  double right{first_corner.x};
+  double top{first_corner.y};
+  double bottom{first_corner.y};
+  for (auto const& obstacle : obstacles_vec_) {
+    Vector2d const& tlc{obstacle.getRectangleTopLeftCorner()};
+    left   = std::min(left, tlc.x);
+    right  = std::max(right, tlc.x + obstacle.getRectangleWidth());
+    top    = std::max(top, tlc.y);
+    bottom = std::min(bottom, tlc.y - obstacle.getRectangleHeight());
+  }
+
+  return Rectangle{Vector2d{left, top}, right - left, top - bottom};
 }
 
 std::vector<Rectangle>::const_iterator Obstacles::begin() const
@@ -102,9 +302,11 @@ bool Obstacles::loadFromFile(std::string const& filepath)
                  "filepath):\n\t\t\tTried to load from \""
               << filepath << "\" but it was badly formatted\n";
     obstacles_vec_.clear();
+    buildGrid();
     return false;
   }
 
+  buildGrid();
   return true;
 }
 
@@ -190,6 +392,42 @@ bool PheromoneParticle::hasEvaporated(double min_pheromone_intensity) const
 // Food Class implementation -----------------------------------
 
 // Food::CircleWithFood class implementation--------------------
+std::size_t Food::CircleWithFood::getCellIndex(Vector2d const& position) const
+{
+  Vector2d const bottom_left{circle_.getCircleCenter()
+                             - Vector2d{circle_.getCircleRadius(),
+                                        circle_.getCircleRadius()}};
+  // clamped before the conversion, so that it's always representable
+  auto const to_cell{[this](double coordinate) {
+    return static_cast<std::size_t>(std::clamp(
+        std::floor(coordinate / cell_size_), 0.,
+        static_cast<double>(grid_side_ - 1)));
+  }};
+  return to_cell(position.y - bottom_left.y) * grid_side_
+       + to_cell(position.x - bottom_left.x);
+}
+
+template<class Function>
+bool Food::CircleWithFood::anyCellAroundCircle(Circle const& circle,
+                                               Function function) const
+{
+  Vector2d const offset{circle.getCircleRadius(), circle.getCircleRadius()};
+  std::size_t const bottom_left{
+      getCellIndex(circle.getCircleCenter() - offset)};
+  std::size_t const top_right{getCellIndex(circle.getCircleCenter() + offset)};
+
+  for (std::size_t row{bottom_left / grid_side_}; row <= top_right / grid_side_;
+       ++row) {
+    for (std::size_t column{bottom_left % grid_side_};
+         column <= top_right % grid_side_; ++column) {
+      if (function(row * grid_side_ + column)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 // may throw std::invalid_argument if the circle intersects with any of the
 // obstacles
 Food::CircleWithFood::CircleWithFood(Circle const& circle,
@@ -197,7 +435,15 @@ Food::CircleWithFood::CircleWithFood(Circle const& circle,
                                      Obstacles const& obstacles,
                                      std::default_random_engine& engine)
     : circle_{circle}
-    , food_vec_{}
+    , grid_side_{std::clamp(
+          static_cast<std::size_t>(std::ceil(
+              std::sqrt(static_cast<double>(number_of_food_particles)
+                        / static_cast<double>(FOOD_PARTICLES_PER_CELL_)))),
+          std::size_t{1}, MAX_GRID_SIDE_)}
+    , cell_size_{2. * circle.getCircleRadius()
+                 / static_cast<double>(grid_side_)}
+    , cells_(grid_side_ * grid_side_)
+    , number_of_food_particles_{number_of_food_particles}
 {
   // if the circle intersects any obstacles
   if (std::any_of(obstacles.begin(), obstacles.end(),
@@ -214,22 +460,29 @@ Food::CircleWithFood::CircleWithFood(Circle const& circle,
   std::normal_distribution center_distance_distribution{
       0., circle.getCircleRadius() / 3.};
 
-  std::generate_n(
-      std::back_inserter(food_vec_), number_of_food_particles,
-      [&circle, &center_distance_distribution, &angle_distribution, &engine]() {
-        double angle{angle_distribution(engine)};
-        double center_distance{std::abs(center_distance_distribution(engine))};
-        if (center_distance > circle.getCircleRadius()) {
-          center_distance = circle.getCircleRadius();
-        }
+  for (std::size_t i{0}; i != number_of_food_particles; ++i) {
+    double angle{angle_distribution(engine)};
+    double center_distance{std::abs(center_distance_distribution(engine))};
+    if (center_distance > circle.getCircleRadius()) {
+      center_distance = circle.getCircleRadius();
+    }
 
-        Vector2d position{rotate(Vector2d{0., 1.}, angle)};
-        position *= center_distance;
-        position += circle.getCircleCenter();
-        return FoodParticle{position};
-      });
+    Vector2d position{rotate(Vector2d{0., 1.}, angle)};
+    position *= center_distance;
+    position += circle.getCircleCenter();
+    cells_[getCellIndex(position)].push_back(FoodParticle{position});
+  }
 }
 
+Food::CircleWithFood::CircleWithFood(Circle const& circle,
+                                     std::size_t grid_side)
+    : circle_{circle}
+    , grid_side_{grid_side}
+    , cell_size_{2. * circle.getCircleRadius() / static_cast<double>(grid_side)}
+    , cells_(grid_side * grid_side)
+    , number_of_food_particles_{0}
+{}
+
 Circle const& Food::CircleWithFood::getCircle() const
 {
   return circle_;
@@ -237,52 +490,142 @@ Circle const& Food::CircleWithFood::getCircle() const
 
 std::size_t Food::CircleWithFood::getNumberOfFoodParticles() const
 {
-  return food_vec_.size();
+  return number_of_food_particles_;
 }
 
 bool Food::CircleWithFood::removeOneFoodParticleInCircle(Circle const& circle)
 {
-  auto food_particle_it{
-      std::find_if(food_vec_.begin(), food_vec_.end(),
-                   [&circle](FoodParticle const& food_particle) {
-                     return circle.isInside(food_particle.getPosition());
-                   })};
+  return anyCellAroundCircle(circle, [&](std::size_t cell_index) {
+    std::vector<FoodParticle>& cell{cells_[cell_index]};
+    auto food_particle_it{
+        std::find_if(cell.begin(), cell.end(),
+                     [&circle](FoodParticle const& food_particle) {
+                       return circle.isInside(food_particle.getPosition());
+                     })};
+    if (food_particle_it == cell.end()) {
+      return false;
+    }
 
-  if (food_particle_it == food_vec_.end()) {
-    return false;
-  }
+    // swap and pop: the order inside the cell doesn't matter
+    *food_particle_it = cell.back();
+    cell.pop_back();
+    --number_of_food_particles_;
+    return true;
+  });
+}
 
-  food_vec_.erase(food_particle_it);
-  return true;
+bool Food::CircleWithFood::isThereFoodInCircle(Circle const& circle) const
+{
+  return anyCellAroundCircle(circle, [&](std::size_t cell_index) {
+    std::vector<FoodParticle> const& cell{cells_[cell_index]};
+    return std::any_of(cell.begin(), cell.end(),
+                       [&circle](FoodParticle const& food_particle) {
+                         return circle.isInside(food_particle.getPosition());
+                       });
+  });
 }
 
 bool Food::CircleWithFood::isThereFoodLeft() const
 {
-  return !food_vec_.empty();
+  return number_of_food_particles_ != 0;
 }
 
-std::vector<FoodParticle>::const_iterator Food::CircleWithFood::begin() const
+std::vector<std::vector<FoodParticle>> const&
+Food::CircleWithFood::getCells() const
 {
-  return food_vec_.cbegin();
+  return cells_;
 }
-std::vector<FoodParticle>::const_iterator Food::CircleWithFood::end() const
+
+// the particles of all the cells are written in two arrays, one for x and one
+// for y, preceded by the number of particles of each cell
+void Food::CircleWithFood::saveToSnapshot(SnapshotWriter& snapshot) const
 {
-  return food_vec_.cend();
+  snapshot.write(circle_.getCircleCenter().x);
+  snapshot.write(circle_.getCircleCenter().y);
+  snapshot.write(circle_.getCircleRadius());
+  snapshot.write<std::uint64_t>(grid_side_);
+
+  std::vector<std::uint64_t> cell_sizes;
+  std::vector<double> x;
+  std::vector<double> y;
+  cell_sizes.reserve(cells_.size());
+  x.reserve(number_of_food_particles_);
+  y.reserve(number_of_food_particles_);
+  for (auto const& cell : cells_) {
+    cell_sizes.push_back(cell.size());
+    for (auto const& food_particle : cell) {
+      x.push_back(food_particle.getPosition().x);
+      y.push_back(food_particle.getPosition().y);
+    }
+  }
+  snapshot.writeArray(cell_sizes);
+  snapshot.writeArray(x);
+  snapshot.writeArray(y);
+}
+
+// may throw std::runtime_error if the snapshot is badly formatted
+Food::CircleWithFood
+Food::CircleWithFood::loadFromSnapshot(SnapshotReader& snapshot)
+{
+  double const center_x{snapshot.read<double>()};
+  double const center_y{snapshot.read<double>()};
+  double const radius{snapshot.read<double>()};
+  std::uint64_t const grid_side{snapshot.read<std::uint64_t>()};
+  checkSnapshot(radius > 0., "food circle with radius <= 0");
+  checkSnapshot(grid_side >= 1 && grid_side <= MAX_GRID_SIDE_,
+                "food circle with an invalid grid");
+
+  CircleWithFood circle_with_food{Circle{Vector2d{center_x, center_y}, radius},
+                                  static_cast<std::size_t>(grid_side)};
+  std::vector<std::uint64_t> cell_sizes;
+  std::vector<double> x;
+  std::vector<double> y;
+  snapshot.readArray(cell_sizes);
+  snapshot.readArray(x);
+  snapshot.readArray(y);
+  checkSnapshot(cell_sizes.size() == circle_with_food.cells_.size()
+                    && x.size() == y.size()
+                    && std::accumulate(cell_sizes.begin(), cell_sizes.end(),
+                                       std::uint64_t{0})
+                           == x.size(),
+                "the food particles don't match the cells");
+
+  std::size_t particle_index{0};
+  for (std::size_t cell_index{0}; cell_index != cell_sizes.size();
+       ++cell_index) {
+    std::vector<FoodParticle>& cell{circle_with_food.cells_[cell_index]};
+    cell.reserve(static_cast<std::size_t>(cell_sizes[cell_index]));
+    for (std::uint64_t i{0}; i != cell_sizes[cell_index]; ++i) {
+      cell.emplace_back(Vector2d{x[particle_index], y[particle_index]});
+      ++particle_index;
+    }
+  }
+  circle_with_food.number_of_food_particles_ = x.size();
+  return circle_with_food;
 }
 
 // actual Food class implementation-------------------------------------------
 Food::Food(unsigned int seed)
     : circles_with_food_vec_{}
     , engine_{seed}
+    , number_of_food_particles_{0}
+    , version_{0}
+    , circles_version_{0}
 {}
 
 std::size_t Food::getNumberOfFoodParticles() const
 {
-  return std::accumulate(
-      circles_with_food_vec_.begin(), circles_with_food_vec_.end(), 0ul,
-      [](std::size_t sum, CircleWithFood const& circle_with_food) {
-        return sum + circle_with_food.getNumberOfFoodParticles();
-      });
+  return number_of_food_particles_;
+}
+
+std::uint64_t Food::getVersion() const
+{
+  return version_;
+}
+
+std::uint64_t Food::getCirclesVersion() const
+{
+  return circles_version_;
 }
 
 // returns:
@@ -314,6 +657,9 @@ bool Food::generateFoodInCircle(Circle const& circle,
   // is > 0 and that the circle doesn't intersect any obstacle
   circles_with_food_vec_.emplace_back(circle, number_of_food_particles,
                                       obstacles, engine_);
+  number_of_food_particles_ += number_of_food_particles;
+  ++version_;
+  ++circles_version_;
   return true;
 }
 
@@ -333,8 +679,11 @@ bool Food::removeOneFoodParticleInCircle(Circle const& circle)
     }
 
     if (circles_with_food_it->removeOneFoodParticleInCircle(circle)) {
+      --number_of_food_particles_;
+      ++version_;
       if (!circles_with_food_it->isThereFoodLeft()) {
         circles_with_food_vec_.erase(circles_with_food_it);
+        ++circles_version_;
       }
       return true;
     }
@@ -343,6 +692,27 @@ bool Food::removeOneFoodParticleInCircle(Circle const& circle)
   return false;
 }
 
+bool Food::isThereFoodInCircle(Circle const& circle) const
+{
+  return std::any_of(circles_with_food_vec_.begin(),
+                     circles_with_food_vec_.end(),
+                     [&circle](CircleWithFood const& circle_with_food) {
+                       return doShapesIntersect(circle,
+                                                circle_with_food.getCircle())
+                           && circle_with_food.isThereFoodInCircle(circle);
+                     });
+}
+
+bool Food::isNearFood(Circle const& circle) const
+{
+  return std::any_of(circles_with_food_vec_.begin(),
+                     circles_with_food_vec_.end(),
+                     [&circle](CircleWithFood const& circle_with_food) {
+                       return doShapesIntersect(circle,
+                                                circle_with_food.getCircle());
+                     });
+}
+
 bool Food::loadFromFile(Obstacles const& obstacles, std::string const& filepath)
 {
   std::ifstream file_in{filepath, std::ios::in};
@@ -389,6 +759,14 @@ bool Food::loadFromFile(Obstacles const& obstacles, std::string const& filepath)
               << error.what() << '\n';
     circles_with_food_vec_.clear();
   }
+  ++version_;
+  ++circles_version_;
+  number_of_food_particles_ = std::accumulate(
+      circles_with_food_vec_.begin(), circles_with_food_vec_.end(),
+      std::size_t{0},
+      [](std::size_t sum, CircleWithFood const& circle_with_food) {
+        return sum + circle_with_food.getNumberOfFoodParticles();
+      });
 
   std::string end_check;
   file_in >> end_check;
@@ -398,6 +776,7 @@ bool Food::loadFromFile(Obstacles const& obstacles, std::string const& filepath)
                  "filepath):\n\t\t\tTried to load from \""
               << filepath << "\" but it was badly formatted\n";
     circles_with_food_vec_.clear();
+    number_of_food_particles_ = 0;
     return false;
   }
 
@@ -430,69 +809,102 @@ bool Food::saveToFile(std::string const& filepath) const
   return true;
 }
 
-// class Food::iterator implementation-------------------------------------
-Food::Iterator::Iterator(
-    std::vector<FoodParticle>::const_iterator const& food_particle_it,
-    std::vector<CircleWithFood>::const_iterator const& circle_with_food_it,
-    std::vector<CircleWithFood>::const_iterator const& circle_with_food_back_it)
-    : food_particle_it_{food_particle_it}
-    , circle_with_food_it_{circle_with_food_it}
-    , circle_with_food_back_it_{circle_with_food_back_it}
-{}
+void Food::saveToSnapshot(SnapshotWriter& snapshot) const
+{
+  snapshot.writeRandomEngine(engine_);
+  snapshot.write<std::uint64_t>(circles_with_food_vec_.size());
+  for (auto const& circle_with_food : circles_with_food_vec_) {
+    circle_with_food.saveToSnapshot(snapshot);
+  }
+}
 
-Food::Iterator& Food::Iterator::operator++() // prefix ++
+// if it throws the food is left as it was
+// may throw std::runtime_error if the snapshot is badly formatted
+void Food::loadFromSnapshot(SnapshotReader& snapshot)
 {
-  ++food_particle_it_;
+  std::default_random_engine engine;
+  snapshot.readRandomEngine(engine);
+
+  std::uint64_t const number_of_circles{snapshot.read<std::uint64_t>()};
+  std::vector<CircleWithFood> circles_with_food;
+  std::size_t number_of_food_particles{0};
+  for (std::uint64_t i{0}; i != number_of_circles; ++i) {
+    circles_with_food.push_back(CircleWithFood::loadFromSnapshot(snapshot));
+    number_of_food_particles +=
+        circles_with_food.back().getNumberOfFoodParticles();
+  }
+
+  // all valid
+  circles_with_food_vec_    = std::move(circles_with_food);
+  engine_                   = engine;
+  number_of_food_particles_ = number_of_food_particles;
+  ++version_;
+  ++circles_version_;
+}
 
-  // if we're at the end of the current circle with food
-  if (food_particle_it_ == circle_with_food_it_->end()) {
-    // if we're NOT the end of the last circle with food
-    if (circle_with_food_it_ != circle_with_food_back_it_) {
-      food_particle_it_ = (++circle_with_food_it_)->begin();
+// class Food::iterator implementation-------------------------------------
+void Food::Iterator::skipEmptyCells()
+{
+  while (circle_index_ != circles_with_food_->size()) {
+    auto const& cells{(*circles_with_food_)[circle_index_].getCells()};
+    while (cell_index_ != cells.size()) {
+      if (particle_index_ < cells[cell_index_].size()) {
+        return;
+      }
+      ++cell_index_;
+      particle_index_ = 0;
     }
+    ++circle_index_;
+    cell_index_ = 0;
   }
+}
+
+Food::Iterator::Iterator(std::vector<CircleWithFood> const& circles_with_food,
+                         std::size_t circle_index, std::size_t cell_index,
+                         std::size_t particle_index)
+    : circles_with_food_{&circles_with_food}
+    , circle_index_{circle_index}
+    , cell_index_{cell_index}
+    , particle_index_{particle_index}
+{
+  skipEmptyCells();
+}
+
+Food::Iterator& Food::Iterator::operator++() // prefix ++
+{
+  ++particle_index_;
+  skipEmptyCells();
   return *this;
 }
 
 FoodParticle const& Food::Iterator::operator*() const
 {
-  return *food_particle_it_;
+  return (*circles_with_food_)[circle_index_]
+      .getCells()[cell_index_][particle_index_];
 }
 
 bool operator==(Food::Iterator const& lhs, Food::Iterator const& rhs)
 {
-  return lhs.food_particle_it_ == rhs.food_particle_it_;
+  return lhs.circles_with_food_ == rhs.circles_with_food_
+      && lhs.circle_index_ == rhs.circle_index_
+      && lhs.cell_index_ == rhs.cell_index_
+      && lhs.particle_index_ == rhs.particle_index_;
 }
 
 bool operator!=(Food::Iterator const& lhs, Food::Iterator const& rhs)
 {
-  return lhs.food_particle_it_ != rhs.food_particle_it_;
+  return !(lhs == rhs);
 }
 
 Food::Iterator Food::begin() const
 {
-  if (circles_with_food_vec_.empty()) {
-    return Food::Iterator{std::vector<FoodParticle>::const_iterator{},
-                          circles_with_food_vec_.end(),
-                          circles_with_food_vec_.end()};
-  }
-
-  return Food::Iterator{circles_with_food_vec_.begin()->begin(),
-                        circles_with_food_vec_.begin(),
-                        circles_with_food_vec_.end() - 1};
+  return Food::Iterator{circles_with_food_vec_, 0, 0, 0};
 }
 
 Food::Iterator Food::end() const
 {
-  if (circles_with_food_vec_.empty()) {
-    return Food::Iterator{std::vector<FoodParticle>::iterator{},
-                          circles_with_food_vec_.end(),
-                          circles_with_food_vec_.end()};
-  }
-
-  return Food::Iterator{circles_with_food_vec_.back().end(),
-                        circles_with_food_vec_.end() - 1,
-                        circles_with_food_vec_.end() - 1};
+  return Food::Iterator{circles_with_food_vec_, circles_with_food_vec_.size(),
+                        0, 0};
 }
 
 // PheromoneSquareCoordinate struct implementation ---------------------------
@@ -504,6 +916,23 @@ bool operator==(PheromonesSquareCoordinate const& lhs,
 
 // Pheromones class implementation ------------------------------
 
+// first_evaporation_tick of a square without particles
+std::size_t const NO_EVAPORATION_TICK{std::numeric_limits<std::size_t>::max()};
+
+// returns the ring of evaporations (see Pheromones::evaporations_) with
+// new_size elements, >= ring.size(), counting the same evaporations as ring
+// for the updates after tick
+std::vector<std::size_t>
+resizeEvaporationsRing(std::vector<std::size_t> const& ring, std::size_t tick,
+                       std::size_t new_size)
+{
+  std::vector<std::size_t> resized(new_size, 0);
+  for (std::size_t k{1}; k <= ring.size(); ++k) {
+    resized[(tick + k) % new_size] = ring[(tick + k) % ring.size()];
+  }
+  return resized;
+}
+
 PheromonesSquareCoordinate
 Pheromones::positionToPheromonesSquareCoordinate(Vector2d const& position) const
 {
@@ -522,35 +951,377 @@ Vector2d Pheromones::pheromonesSquareCoordinateToPosition(
   return SQUARE_LENGTH_ * top_left_corner;
 }
 
-void Pheromones::fillWithNeighbouringPheromonesSquares(
-    std::vector<map_const_it>& neighbouring_squares,
-    PheromonesSquareCoordinate const& center_square_coordinate) const
+std::size_t Pheromones::getSquareIndexForInsertion(Vector2d const& position)
 {
-  int center_x = center_square_coordinate.x;
-  int center_y = center_square_coordinate.y;
+  PheromonesSquareCoordinate coord{
+      positionToPheromonesSquareCoordinate(position)};
+
+  if (is_bounded_) {
+    int const column{std::clamp(coord.x - grid_origin_.x, 0, grid_width_ - 1)};
+    int const row{std::clamp(coord.y - grid_origin_.y, 0, grid_height_ - 1)};
+    return static_cast<std::size_t>(row) * static_cast<std::size_t>(grid_width_)
+         + static_cast<std::size_t>(column);
+  }
+
+  std::size_t const bucket_count{square_indices_.bucket_count()};
+  auto [square_index_it, inserted] =
+      square_indices_.try_emplace(coord, squares_.size());
+  if (inserted) {
+    // the node, the buckets if they were rehashed, and the array of squares_
+    // if it was full
+    ++number_of_allocations_;
+    if (square_indices_.bucket_count() != bucket_count) {
+      ++number_of_allocations_;
+    }
+    if (squares_.size() == squares_.capacity()) {
+      ++number_of_allocations_;
+    }
+    squares_.push_back(Square{coord, {}, {}, {}, {}, {}, NO_EVAPORATION_TICK});
+  }
+  return square_index_it->second;
+}
+
+std::size_t Pheromones::getLifetime(double intensity)
+{
+  double const multiplier{1. - DECREASE_PERCENTAGE_AMOUNT_};
+  while (intensity * decay_.back() > MIN_PHEROMONE_INTENSITY_MAP_) {
+    if (decay_.size() == decay_.capacity()) {
+      ++number_of_allocations_;
+    }
+    decay_.push_back(decay_.back() * multiplier);
+  }
+  // decay_ is decreasing: the first update after which it has evaporated
+  auto const first_evaporated{
+      std::partition_point(decay_.begin() + 1, decay_.end(), [=](double decay) {
+        return intensity * decay > MIN_PHEROMONE_INTENSITY_MAP_;
+      })};
+  return static_cast<std::size_t>(first_evaporated - decay_.begin());
+}
+
+bool Pheromones::hasEvaporated(Square const& square,
+                               std::size_t particle_index) const
+{
+  return square.evaporation_tick[particle_index] <= current_tick_;
+}
+
+// only for particles that haven't evaporated
+double Pheromones::getIntensity(Square const& square,
+                                std::size_t particle_index) const
+{
+  return square.intensity[particle_index]
+       * decay_[current_tick_ - square.deposit_tick[particle_index]];
+}
+
+// the order of the remaining particles is kept
+void Pheromones::removeEvaporatedParticles(Square& square)
+{
+  std::size_t const size{square.intensity.size()};
+  std::size_t kept{0};
+  square.first_evaporation_tick = NO_EVAPORATION_TICK;
+  for (std::size_t i{0}; i != size; ++i) {
+    if (hasEvaporated(square, i)) {
+      continue;
+    }
+    square.x[kept]                = square.x[i];
+    square.y[kept]                = square.y[i];
+    square.intensity[kept]        = square.intensity[i];
+    square.deposit_tick[kept]     = square.deposit_tick[i];
+    square.evaporation_tick[kept] = square.evaporation_tick[i];
+    square.first_evaporation_tick =
+        std::min(square.first_evaporation_tick, square.evaporation_tick[i]);
+    ++kept;
+  }
+  square.x.resize(kept);
+  square.y.resize(kept);
+  square.intensity.resize(kept);
+  square.deposit_tick.resize(kept);
+  square.evaporation_tick.resize(kept);
+
+  if (kept == 0 && square.x.capacity() != 0) {
+    // the moved from vectors are left empty, without memory
+    addFreeParticlesArrays(Square{
+        square.coordinate, std::move(square.x), std::move(square.y),
+        std::move(square.intensity), std::move(square.deposit_tick),
+        std::move(square.evaporation_tick), NO_EVAPORATION_TICK});
+  }
+}
+
+std::size_t Pheromones::getCapacityClass(std::size_t capacity)
+{
+  std::size_t capacity_class{0};
+  while (capacity / PARTICLES_CHUNK_ >= (std::size_t{2} << capacity_class)) {
+    ++capacity_class;
+  }
+  return capacity_class;
+}
+
+void Pheromones::addFreeParticlesArrays(Square&& arrays)
+{
+  std::size_t const capacity_class{getCapacityClass(arrays.x.capacity())};
+  if (capacity_class >= free_particles_arrays_.size()) {
+    ++number_of_allocations_;
+    free_particles_arrays_.resize(capacity_class + 1);
+  }
+  std::vector<Square>& free_arrays{free_particles_arrays_[capacity_class]};
+  if (free_arrays.size() == free_arrays.capacity()) {
+    ++number_of_allocations_;
+  }
+  free_arrays.push_back(std::move(arrays));
+}
+
+void Pheromones::growParticlesArrays(Square& square)
+{
+  std::size_t const size{square.x.size()};
+  // the arrays in the bucket of size + 1 may be too small, the ones in the
+  // larger buckets never are. Only the last ones freed of each bucket are
+  // looked at: they are the most likely to still be in the cache
+  std::vector<Square>* spares{nullptr};
+  std::size_t capacity_class{getCapacityClass(size + 1)};
+  if (capacity_class < free_particles_arrays_.size()
+      && !free_particles_arrays_[capacity_class].empty()
+      && free_particles_arrays_[capacity_class].back().x.capacity() > size) {
+    spares = &free_particles_arrays_[capacity_class];
+  }
+  for (++capacity_class;
+       spares == nullptr && capacity_class < free_particles_arrays_.size();
+       ++capacity_class) {
+    if (!free_particles_arrays_[capacity_class].empty()) {
+      spares = &free_particles_arrays_[capacity_class];
+    }
+  }
+
+  if (spares == nullptr) {
+    std::size_t const capacity{std::max(PARTICLES_CHUNK_, 2 * size)};
+    square.x.reserve(capacity);
+    square.y.reserve(capacity);
+    square.intensity.reserve(capacity);
+    square.deposit_tick.reserve(capacity);
+    square.evaporation_tick.reserve(capacity);
+    number_of_allocations_ += 5;
+    return;
+  }
+
+  Square spare{std::move(spares->back())};
+  spares->pop_back();
+  spare.x.assign(square.x.begin(), square.x.end());
+  spare.y.assign(square.y.begin(), square.y.end());
+  spare.intensity.assign(square.intensity.begin(), square.intensity.end());
+  spare.deposit_tick.assign(square.deposit_tick.begin(),
+                            square.deposit_tick.end());
+  spare.evaporation_tick.assign(square.evaporation_tick.begin(),
+                                square.evaporation_tick.end());
+  square.x.swap(spare.x);
+  square.y.swap(spare.y);
+  square.intensity.swap(spare.intensity);
+  square.deposit_tick.swap(spare.deposit_tick);
+  square.evaporation_tick.swap(spare.evaporation_tick);
+
+  // the smaller arrays of the square are freed in their turn
+  if (spare.x.capacity() != 0) {
+    spare.x.clear();
+    spare.y.clear();
+    spare.intensity.clear();
+    spare.deposit_tick.clear();
+    spare.evaporation_tick.clear();
+    addFreeParticlesArrays(std::move(spare));
+  }
+}
+
+Vector2d Pheromones::getFieldSquareCenter(std::size_t square_index) const
+{
+  std::size_t const width{static_cast<std::size_t>(grid_width_)};
+  PheromonesSquareCoordinate const coordinate{
+      grid_origin_.x + static_cast<int>(square_index % width),
+      grid_origin_.y + static_cast<int>(square_index / width)};
+  return pheromonesSquareCoordinateToPosition(coordinate)
+       + Vector2d{SQUARE_LENGTH_ / 2., -SQUARE_LENGTH_ / 2.};
+}
+
+void Pheromones::diffuseField()
+{
+  std::size_t const width{static_cast<std::size_t>(grid_width_)};
+  std::size_t const height{static_cast<std::size_t>(grid_height_)};
+  double const kept{1. - diffusion_rate_};
+  double const given{diffusion_rate_ / 4.};
+
+  // the missing neighbours of the squares on the border are replaced by the
+  // squares themselves, so that the total intensity doesn't change
+  for (std::size_t row{0}; row != height; ++row) {
+    std::size_t const row_start{row * width};
+    std::size_t const previous_row_start{row != 0 ? row_start - width
+                                                  : row_start};
+    std::size_t const next_row_start{row + 1 != height ? row_start + width
+                                                       : row_start};
+    for (std::size_t column{0}; column != width; ++column) {
+      std::size_t const left{column != 0 ? column - 1 : column};
+      std::size_t const right{column + 1 != width ? column + 1 : column};
+      diffused_field_[row_start + column] =
+          kept * field_[row_start + column]
+          + given
+                * (field_[row_start + left] + field_[row_start + right]
+                   + field_[previous_row_start + column]
+                   + field_[next_row_start + column]);
+    }
+  }
+  field_.swap(diffused_field_);
+}
+
+void Pheromones::evaporateField()
+{
+  double const multiplier{1. - DECREASE_PERCENTAGE_AMOUNT_};
+  // the same threshold as the particles'
+  double const min_intensity{MIN_PHEROMONE_INTENSITY_MAP_};
+  std::size_t number_of_pheromones{0};
+  // a single pass without branches over a contiguous array, which the
+  // compiler can vectorize
+  for (double& intensity : field_) {
+    intensity *= multiplier;
+    intensity = intensity > min_intensity ? intensity : 0.;
+    number_of_pheromones += intensity != 0. ? 1 : 0;
+  }
+  number_of_pheromones_ = number_of_pheromones;
+}
+
+void Pheromones::addEvaporation(std::size_t lifetime)
+{
+  if (evaporations_.size() < lifetime) {
+    std::size_t size{std::max(PARTICLES_CHUNK_, evaporations_.size())};
+    while (size < lifetime) {
+      size *= 2;
+    }
+    evaporations_ = resizeEvaporationsRing(evaporations_, current_tick_, size);
+    ++number_of_allocations_;
+  }
+  ++evaporations_[(current_tick_ + lifetime) % evaporations_.size()];
+}
+
+template<std::size_t N, class Function>
+void Pheromones::forEachSquareAroundCircles(
+    std::array<Circle, N> const& circles, Function function) const
+{
+  static_assert(N >= 1 && N <= 8, "the circles must fit in the mask");
+
+  // the mapping from positions to coordinates is monotonic, so the corners of
+  // the bounding box of a circle give the range of squares to check
+  std::array<PheromonesSquareCoordinate, N> min_coords;
+  std::array<PheromonesSquareCoordinate, N> max_coords;
+  for (std::size_t c{0}; c != N; ++c) {
+    Vector2d const& center{circles[c].getCircleCenter()};
+    double const radius{circles[c].getCircleRadius()};
+    min_coords[c] = positionToPheromonesSquareCoordinate(
+        Vector2d{center.x - radius, center.y - radius});
+    max_coords[c] = positionToPheromonesSquareCoordinate(
+        Vector2d{center.x + radius, center.y + radius});
+    if (is_bounded_) {
+      // the squares on the border also hold the particles outside of the
+      // bounds
+      min_coords[c].x =
+          std::clamp(min_coords[c].x - grid_origin_.x, 0, grid_width_ - 1);
+      max_coords[c].x =
+          std::clamp(max_coords[c].x - grid_origin_.x, 0, grid_width_ - 1);
+      min_coords[c].y =
+          std::clamp(min_coords[c].y - grid_origin_.y, 0, grid_height_ - 1);
+      max_coords[c].y =
+          std::clamp(max_coords[c].y - grid_origin_.y, 0, grid_height_ - 1);
+    }
+  }
+  PheromonesSquareCoordinate min_coord{min_coords[0]};
+  PheromonesSquareCoordinate max_coord{max_coords[0]};
+  for (std::size_t c{1}; c != N; ++c) {
+    min_coord.x = std::min(min_coord.x, min_coords[c].x);
+    min_coord.y = std::min(min_coord.y, min_coords[c].y);
+    max_coord.x = std::max(max_coord.x, max_coords[c].x);
+    max_coord.y = std::max(max_coord.y, max_coords[c].y);
+  }
 
-  for (int delta_x = -1; delta_x <= 1; ++delta_x) {
-    for (int delta_y = -1; delta_y <= 1; ++delta_y) {
-      map_const_it square_it{pheromones_squares_.find(
-          PheromonesSquareCoordinate{center_x + delta_x, center_y + delta_y})};
+  // the squares of the box around all the circles that none of them
+  // overlaps aren't even looked at
+  auto const circlesMask{[&min_coords, &max_coords](int x, int y) {
+    unsigned int mask{0};
+    for (std::size_t c{0}; c != N; ++c) {
+      bool const overlaps{x >= min_coords[c].x && x <= max_coords[c].x
+                          && y >= min_coords[c].y && y <= max_coords[c].y};
+      mask |= static_cast<unsigned int>(overlaps) << c;
+    }
+    return mask;
+  }};
+
+  if (is_bounded_) {
+    for (int row{min_coord.y}; row <= max_coord.y; ++row) {
+      std::size_t const row_start{static_cast<std::size_t>(row)
+                                  * static_cast<std::size_t>(grid_width_)};
+      for (int column{min_coord.x}; column <= max_coord.x; ++column) {
+        unsigned int const mask{circlesMask(column, row)};
+        if (mask == 0) {
+          continue;
+        }
+        std::size_t const square_index{row_start
+                                       + static_cast<std::size_t>(column)};
+        bool const has_pheromones{
+            model_ == Model::FIELD
+                ? field_[square_index] != 0.
+                : !squares_[square_index].intensity.empty()};
+        if (has_pheromones) {
+          function(square_index, mask);
+        }
+      }
+    }
+    return;
+  }
 
-      if (square_it != pheromones_squares_.end()) {
-        assert(!square_it->second.empty());
-        neighbouring_squares.push_back(square_it);
+  for (int y{min_coord.y}; y <= max_coord.y; ++y) {
+    for (int x{min_coord.x}; x <= max_coord.x; ++x) {
+      unsigned int const mask{circlesMask(x, y)};
+      if (mask == 0) {
+        continue;
+      }
+      auto square_index_it{
+          square_indices_.find(PheromonesSquareCoordinate{x, y})};
+      if (square_index_it != square_indices_.end()
+          && !squares_[square_index_it->second].intensity.empty()) {
+        function(square_index_it->second, mask);
       }
     }
   }
 }
 
+template<class Function>
+void Pheromones::forEachSquareAroundCircle(Circle const& circle,
+                                           Function function) const
+{
+  forEachSquareAroundCircles(
+      std::array<Circle, 1>{circle},
+      [&function](std::size_t square_index, unsigned int) {
+        function(square_index);
+      });
+}
+
 Pheromones::Pheromones(Type type, double ant_circle_of_vision_diameter,
                        unsigned int seed)
     : SQUARE_LENGTH_{2. * ant_circle_of_vision_diameter}
-    , pheromones_squares_{}
+    , model_{Model::PARTICLES}
+    , squares_{}
+    , square_indices_{}
+    , is_bounded_{false}
+    , grid_origin_{0, 0}
+    , grid_width_{0}
+    , grid_height_{0}
+    , number_of_pheromones_{0}
+    , current_tick_{0}
+    , decay_{1.}
+    , evaporations_{}
+    , free_particles_arrays_{}
+    , number_of_allocations_{0}
+    , field_{}
+    , diffused_field_{}
+    , diffusion_rate_{0.}
+    , sweep_position_{0}
     , type_{type}
     , random_engine_{seed}
     , time_since_last_evaporation_{0.}
     , MIN_PHEROMONE_INTENSITY_{MIN_PHEROMONE_INTENSITY_MAP_}
     , DECREASE_PERCENTAGE_AMOUNT_{DECREASE_PERCENTAGE_AMOUNT_MAP_}
+    , version_{0}
 
 {
   if (SQUARE_LENGTH_ <= 0.) {
@@ -559,123 +1330,314 @@ Pheromones::Pheromones(Type type, double ant_circle_of_vision_diameter,
   }
 }
 
-double Pheromones::getPheromonesIntensityInCircle(Circle const& circle) const
+Pheromones::Pheromones(Type type, double ant_circle_of_vision_diameter,
+                       Rectangle const& bounds, unsigned int seed)
+    : Pheromones{type, ant_circle_of_vision_diameter, bounds, Model::PARTICLES,
+                 seed}
+{}
+
+Pheromones::Pheromones(Type type, double ant_circle_of_vision_diameter,
+                       Rectangle const& bounds, Model model, unsigned int seed)
+    : Pheromones{type, ant_circle_of_vision_diameter, seed}
 {
-  PheromonesSquareCoordinate center_square_coordinate{
-      positionToPheromonesSquareCoordinate(circle.getCircleCenter())};
+  model_ = model;
+  if (model_ == Model::FIELD) {
+    SQUARE_LENGTH_ =
+        ant_circle_of_vision_diameter / FIELD_SQUARES_PER_DIAMETER_;
+  }
 
-  // get all existing neighbouring squares (the center is also inside
-  // neighbouring squares)
-  std::vector<map_const_it> neighbouring_squares;
-  fillWithNeighbouringPheromonesSquares(neighbouring_squares,
-                                        center_square_coordinate);
+  Vector2d const& tlc{bounds.getRectangleTopLeftCorner()};
+  PheromonesSquareCoordinate const min_coord{
+      positionToPheromonesSquareCoordinate(
+          Vector2d{tlc.x, tlc.y - bounds.getRectangleHeight()})};
+  PheromonesSquareCoordinate const max_coord{
+      positionToPheromonesSquareCoordinate(
+          Vector2d{tlc.x + bounds.getRectangleWidth(), tlc.y})};
+
+  is_bounded_  = true;
+  grid_origin_ = min_coord;
+  grid_width_  = max_coord.x - min_coord.x + 1;
+  grid_height_ = max_coord.y - min_coord.y + 1;
+
+  if (model_ == Model::FIELD) {
+    field_.assign(static_cast<std::size_t>(grid_width_)
+                      * static_cast<std::size_t>(grid_height_),
+                  0.);
+    ++number_of_allocations_;
+    return;
+  }
 
-  if (neighbouring_squares.empty()) {
-    return 0.;
+  squares_.reserve(static_cast<std::size_t>(grid_width_)
+                   * static_cast<std::size_t>(grid_height_));
+  for (int row{0}; row != grid_height_; ++row) {
+    for (int column{0}; column != grid_width_; ++column) {
+      squares_.push_back(Square{PheromonesSquareCoordinate{
+                                    grid_origin_.x + column,
+                                    grid_origin_.y + row},
+                                {},
+                                {},
+                                {},
+                                {},
+                                {},
+                                NO_EVAPORATION_TICK});
+    }
   }
+}
+
+bool Pheromones::isBounded() const
+{
+  return is_bounded_;
+}
 
-  // remove all squares that don't intersect the circle
-  neighbouring_squares.erase(
-      std::remove_if(neighbouring_squares.begin(), neighbouring_squares.end(),
-                     [&circle, this](map_const_it square) {
-                       Rectangle square_rect{
-                           pheromonesSquareCoordinateToPosition(square->first),
-                           SQUARE_LENGTH_, SQUARE_LENGTH_};
-                       return !doShapesIntersect(circle, square_rect);
-                     }),
-      neighbouring_squares.end());
+Pheromones::Model Pheromones::getModel() const
+{
+  return model_;
+}
 
-  if (neighbouring_squares.empty()) {
-    return 0.;
+// may throw std::invalid_argument if the model isn't FIELD or diffusion_rate
+// isn't in [0., 1.)
+void Pheromones::setDiffusionRate(double diffusion_rate)
+{
+  if (model_ != Model::FIELD) {
+    throw std::invalid_argument{
+        "only the pheromones of the FIELD model can diffuse"};
+  }
+  if (!(diffusion_rate >= 0. && diffusion_rate < 1.)) {
+    throw std::invalid_argument{
+        "the diffusion rate of the pheromones must be in [0., 1.)"};
+  }
+  if (diffusion_rate != 0. && diffused_field_.size() != field_.size()) {
+    diffused_field_.assign(field_.size(), 0.);
+    ++number_of_allocations_;
   }
+  diffusion_rate_ = diffusion_rate;
+}
+
+double Pheromones::getDiffusionRate() const
+{
+  return diffusion_rate_;
+}
+
+double Pheromones::getPheromonesIntensityInCircle(Circle const& circle) const
+{
+  Vector2d const& center{circle.getCircleCenter()};
+  double const radius2{circle.getCircleRadius() * circle.getCircleRadius()};
 
   // sum of the sums of the particles inside the squares
-  return std::accumulate(
-      neighbouring_squares.begin(), neighbouring_squares.end(), 0.,
-      [&circle](double total_sum, map_const_it square_it) {
-        return total_sum
-             + std::accumulate(
-                   square_it->second.begin(), square_it->second.end(), 0.,
-                   [&circle](double square_sum,
-                             PheromoneParticle const& pheromone) {
-                     return square_sum
-                          + (circle.isInside(pheromone.getPosition())
-                                 ? pheromone.getIntensity()
-                                 : 0.);
-                   });
-      });
+  double total_sum{0.};
+  if (model_ == Model::FIELD) {
+    // the squares are small enough to be taken whole if their center is in
+    // the circle
+    forEachSquareAroundCircle(circle, [&](std::size_t square_index) {
+      if (norm2(getFieldSquareCenter(square_index) - center) <= radius2) {
+        total_sum += field_[square_index];
+      }
+    });
+    return total_sum;
+  }
+  forEachSquareAroundCircle(circle, [&](std::size_t square_index) {
+    Square const& square{squares_[square_index]};
+    for (std::size_t i{0}; i != square.intensity.size(); ++i) {
+      double const dx{square.x[i] - center.x};
+      double const dy{square.y[i] - center.y};
+      if (dx * dx + dy * dy <= radius2 && !hasEvaporated(square, i)) {
+        total_sum += getIntensity(square, i);
+      }
+    }
+  });
+
+  return total_sum;
 }
 
 // returns end() if there were no pheromones in the circle
 Pheromones::Iterator
 Pheromones::getRandomMaxPheromoneParticleInCircle(Circle const& circle)
 {
-  PheromonesSquareCoordinate center_square_coordinate{
-      positionToPheromonesSquareCoordinate(circle.getCircleCenter())};
-
-  // get all existing neighbouring squares (the center is also inside
-  // neighbouring squares)
-  std::vector<map_const_it> neighbouring_squares;
-  fillWithNeighbouringPheromonesSquares(neighbouring_squares,
-                                        center_square_coordinate);
-
-  if (neighbouring_squares.empty()) {
-    return end();
-  }
-
-  // remove all squares that don't intersect the circle
-  neighbouring_squares.erase(
-      std::remove_if(neighbouring_squares.begin(), neighbouring_squares.end(),
-                     [&circle, this](map_const_it square) {
-                       Rectangle square_rect{
-                           pheromonesSquareCoordinateToPosition(square->first),
-                           SQUARE_LENGTH_, SQUARE_LENGTH_};
-                       return !doShapesIntersect(circle, square_rect);
-                     }),
-      neighbouring_squares.end());
+  return getRandomMaxPheromoneParticleInCircle(circle, random_engine_);
+}
 
-  if (neighbouring_squares.empty()) {
-    return end();
-  }
+// returns end() if there were no pheromones in the circle
+Pheromones::Iterator Pheromones::getRandomMaxPheromoneParticleInCircle(
+    Circle const& circle, std::default_random_engine& random_engine) const
+{
+  Vector2d const& center{circle.getCircleCenter()};
+  double const radius2{circle.getCircleRadius() * circle.getCircleRadius()};
 
   // for each pheromone we have a 0.1% chance of returning the max of previous
   // intensities (up to that point)
   double probability_of_returning_early{0.001};
   std::uniform_real_distribution<double> distr(0., 1.);
 
-  // we are extremely sorry for this monstruosity
   // basically we search the pheromone with the highest intensity, but, each
   // time we find a pheromone inside the circle, there's a
   // probability_of_returning_early and returning the max found so far
-  Pheromones::Iterator max_intensity_particle{end()};
-  for (auto pheromone_square_it{neighbouring_squares.begin()};
-       pheromone_square_it != neighbouring_squares.end();
-       ++pheromone_square_it) {
-    // neighbouring squares should never be empty for class invariant
-    assert(!(*pheromone_square_it)->second.empty());
-    for (auto pheromone_particle_it{(*pheromone_square_it)->second.begin()};
-         pheromone_particle_it != (*pheromone_square_it)->second.end();
-         ++pheromone_particle_it) {
-      if (circle.isInside(pheromone_particle_it->getPosition())) {
-        if (max_intensity_particle == end()) {
-          max_intensity_particle =
-              Iterator{pheromone_particle_it, *pheromone_square_it,
-                       pheromones_squares_.end()};
-        } else if (pheromone_particle_it->getIntensity()
-                   > (*max_intensity_particle).getIntensity()) {
-          max_intensity_particle =
-              Iterator{pheromone_particle_it, *pheromone_square_it,
-                       pheromones_squares_.end()};
+  bool found{false};
+  bool returned_early{false};
+  std::size_t max_square_index{0};
+  std::size_t max_particle_index{0};
+  double max_intensity{0.};
+  if (model_ == Model::FIELD) {
+    forEachSquareAroundCircle(circle, [&](std::size_t square_index) {
+      if (returned_early
+          || norm2(getFieldSquareCenter(square_index) - center) > radius2) {
+        return;
+      }
+
+      if (!found || field_[square_index] > max_intensity) {
+        found            = true;
+        max_square_index = square_index;
+        max_intensity    = field_[square_index];
+      }
+
+      if (distr(random_engine) < probability_of_returning_early) {
+        returned_early = true;
+      }
+    });
+  } else {
+    forEachSquareAroundCircle(circle, [&](std::size_t square_index) {
+      if (returned_early) {
+        return;
+      }
+
+      Square const& square{squares_[square_index]};
+      for (std::size_t i{0}; i != square.intensity.size(); ++i) {
+        double const dx{square.x[i] - center.x};
+        double const dy{square.y[i] - center.y};
+        if (dx * dx + dy * dy > radius2 || hasEvaporated(square, i)) {
+          continue;
+        }
+
+        double const intensity{getIntensity(square, i)};
+        if (!found || intensity > max_intensity) {
+          found              = true;
+          max_square_index   = square_index;
+          max_particle_index = i;
+          max_intensity      = intensity;
         }
 
-        if (distr(random_engine_) < probability_of_returning_early) {
-          return max_intensity_particle;
+        if (distr(random_engine) < probability_of_returning_early) {
+          returned_early = true;
+          return;
         }
       }
+    });
+  }
+
+  if (!found) {
+    return end();
+  }
+  return Iterator{*this, max_square_index, max_particle_index};
+}
+
+std::array<Pheromones::SensedPheromones, 3>
+Pheromones::sense(std::array<Circle, 3> const& circles, bool count_all)
+{
+  return sense(circles, random_engine_, count_all);
+}
+
+std::array<Pheromones::SensedPheromones, 3>
+Pheromones::sense(std::array<Circle, 3> const& circles,
+                  std::default_random_engine& random_engine,
+                  bool count_all) const
+{
+  std::array<Vector2d, 3> const centers{circles[0].getCircleCenter(),
+                                        circles[1].getCircleCenter(),
+                                        circles[2].getCircleCenter()};
+  std::array<double, 3> radii2;
+  for (std::size_t c{0}; c != 3; ++c) {
+    radii2[c] = circles[c].getCircleRadius() * circles[c].getCircleRadius();
+  }
+
+  // as in getRandomMaxPheromoneParticleInCircle() each pheromone found has a
+  // 0.1% chance of making its circle return the max found so far. Instead of
+  // a draw for every pheromone, the number of pheromones each circle looks at
+  // before returning early is drawn once, when the first one is found: it
+  // follows the geometric distribution
+  std::geometric_distribution<std::size_t> number_of_failed_draws{0.001};
+  std::array<std::size_t, 3> pheromones_left{0, 0, 0};
+  // bit c is cleared when the c-th circle returns early
+  unsigned int searching_mask{0b111};
+
+  std::array<SensedPheromones, 3> sensed{};
+  std::array<double, 3> max_intensities{0., 0., 0.};
+  std::array<Vector2d, 3> max_positions{centers};
+  // the circles of circles_mask position is in
+  auto const insideMask{[&centers, &radii2](Vector2d const& position,
+                                            unsigned int circles_mask) {
+    unsigned int inside_mask{0};
+    for (std::size_t c{0}; c != 3; ++c) {
+      bool const is_inside{norm2(position - centers[c]) <= radii2[c]};
+      inside_mask |= static_cast<unsigned int>(is_inside) << c;
+    }
+    return inside_mask & circles_mask;
+  }};
+  // a pheromone that hasn't evaporated, in the circles of inside_mask
+  auto const add{[&](Vector2d const& position, double intensity,
+                     unsigned int inside_mask) {
+    for (std::size_t c{0}; c != 3; ++c) {
+      if ((inside_mask >> c & 1u) == 0) {
+        continue;
+      }
+      SensedPheromones& circle_sensed{sensed[c]};
+      circle_sensed.total_intensity += intensity;
+      ++circle_sensed.number_of_pheromones;
+      if ((searching_mask >> c & 1u) == 0) {
+        continue;
+      }
+      if (circle_sensed.number_of_pheromones == 1) {
+        pheromones_left[c] = number_of_failed_draws(random_engine) + 1;
+      }
+      if (circle_sensed.number_of_pheromones == 1
+          || intensity > max_intensities[c]) {
+        max_intensities[c] = intensity;
+        max_positions[c]   = position;
+      }
+      if (--pheromones_left[c] == 0) {
+        searching_mask &= ~(1u << c);
+      }
+    }
+  }};
+  // the circles whose pheromones still have to be looked at
+  auto const activeMask{[&searching_mask, count_all] {
+    return count_all ? 0b111u : searching_mask;
+  }};
+
+  if (model_ == Model::FIELD) {
+    forEachSquareAroundCircles(
+        circles, [&](std::size_t square_index, unsigned int circles_mask) {
+          Vector2d const position{getFieldSquareCenter(square_index)};
+          add(position, field_[square_index],
+              insideMask(position, circles_mask & activeMask()));
+        });
+  } else {
+    // testing every particle against the three circles costs as much as
+    // testing the particles of each circle's squares against it, which are
+    // still in the cache: each circle gets its own loop, with one test
+    for (std::size_t c{0}; c != 3; ++c) {
+      unsigned int const bit{1u << c};
+      Vector2d const& center{centers[c]};
+      forEachSquareAroundCircle(circles[c], [&](std::size_t square_index) {
+        Square const& square{squares_[square_index]};
+        for (std::size_t i{0};
+             i != square.intensity.size() && (activeMask() & bit) != 0; ++i) {
+          double const dx{square.x[i] - center.x};
+          double const dy{square.y[i] - center.y};
+          if (dx * dx + dy * dy > radii2[c] || hasEvaporated(square, i)) {
+            continue;
+          }
+          add(Vector2d{square.x[i], square.y[i]}, getIntensity(square, i),
+              bit);
+        }
+      });
     }
   }
 
-  return max_intensity_particle;
+  for (std::size_t c{0}; c != 3; ++c) {
+    if (sensed[c].number_of_pheromones != 0) {
+      sensed[c].max_particle.emplace(max_positions[c], max_intensities[c]);
+    }
+  }
+  return sensed;
 }
 
 Pheromones::Type Pheromones::getPheromonesType() const
@@ -684,11 +1646,17 @@ Pheromones::Type Pheromones::getPheromonesType() const
 }
 std::size_t Pheromones::getNumberOfPheromones() const
 {
-  return std::accumulate(pheromones_squares_.begin(), pheromones_squares_.end(),
-                         0UL,
-                         [](std::size_t sum, auto const& pheromones_square) {
-                           return sum + pheromones_square.second.size();
-                         });
+  return number_of_pheromones_;
+}
+
+std::uint64_t Pheromones::getVersion() const
+{
+  return version_;
+}
+
+std::size_t Pheromones::getNumberOfAllocations() const
+{
+  return number_of_allocations_;
 }
 
 double Pheromones::getMinPheromoneIntensity() const
@@ -702,20 +1670,51 @@ double Pheromones::getMaxPheromoneIntensity() const
        * Ant::PERCENTAGE_DECREASE_PHEROMONE_RELEASE;
 }
 
+// may throw std::invalid_argument if intensity is <= 0.
 void Pheromones::addPheromoneParticle(Vector2d const& position,
                                       double intensity)
 {
-  PheromonesSquareCoordinate square_coord{
-      positionToPheromonesSquareCoordinate(position)};
-  // pheromones_squares_[square_coord].reserve(400);
-  pheromones_squares_[square_coord].emplace_back(position, intensity);
+  if (intensity <= 0.) {
+    throw std::invalid_argument{
+        "The pheromone's intensity can't be negative or null "};
+  }
+
+  if (model_ == Model::FIELD) {
+    double& square_intensity{field_[getSquareIndexForInsertion(position)]};
+    if (square_intensity == 0.) {
+      ++number_of_pheromones_;
+    }
+    square_intensity += intensity;
+    ++version_;
+    return;
+  }
+
+  Square& square{squares_[getSquareIndexForInsertion(position)]};
+  // the square is being touched anyway: a good time to free it
+  if (square.first_evaporation_tick <= current_tick_) {
+    removeEvaporatedParticles(square);
+  }
+
+  std::size_t const lifetime{getLifetime(intensity)};
+  if (square.x.size() == square.x.capacity()) {
+    growParticlesArrays(square);
+  }
+  square.x.push_back(position.x);
+  square.y.push_back(position.y);
+  square.intensity.push_back(intensity);
+  square.deposit_tick.push_back(current_tick_);
+  square.evaporation_tick.push_back(current_tick_ + lifetime);
+  square.first_evaporation_tick =
+      std::min(square.first_evaporation_tick, current_tick_ + lifetime);
+
+  addEvaporation(lifetime);
+  ++number_of_pheromones_;
+  ++version_;
 }
 
 void Pheromones::addPheromoneParticle(PheromoneParticle const& particle)
 {
-  PheromonesSquareCoordinate square_coord{
-      positionToPheromonesSquareCoordinate(particle.getPosition())};
-  pheromones_squares_[square_coord].push_back(particle);
+  addPheromoneParticle(particle.getPosition(), particle.getIntensity());
 }
 
 bool Pheromones::timeToEvaporate(double delta_t)
@@ -737,92 +1736,371 @@ void Pheromones::updateParticlesEvaporation(double delta_t)
   if (!timeToEvaporate(delta_t)) {
     return;
   }
-  for (auto& pheromone_square : pheromones_squares_) {
-    for (auto& pheromone_particle : pheromone_square.second) {
-      pheromone_particle.decreaseIntensity(DECREASE_PERCENTAGE_AMOUNT_,
-                                           MIN_PHEROMONE_INTENSITY_);
+  KAPE_PROFILE_SCOPE(timer, Phase::EVAPORATION);
+
+  // the intensities follow current_tick_ on their own: only the number of
+  // particles has to be updated
+  ++current_tick_;
+  ++version_;
+  if (model_ == Model::FIELD) {
+    if (diffusion_rate_ != 0.) {
+      diffuseField();
     }
+    evaporateField();
+    return;
+  }
+  if (!evaporations_.empty()) {
+    std::size_t& evaporations{
+        evaporations_[current_tick_ % evaporations_.size()]};
+    number_of_pheromones_ -= evaporations;
+    evaporations = 0;
   }
 
-  // remove phermones that have evaporated from the pheromones squares
-  for (auto& pheromone_square : pheromones_squares_) {
-    pheromone_square.second.erase(
-        std::remove_if(
-            pheromone_square.second.begin(), pheromone_square.second.end(),
-            [](PheromoneParticle const& particle) {
-              return particle.hasEvaporated(MIN_PHEROMONE_INTENSITY_MAP_);
-            }),
-        pheromone_square.second.end());
+  if (squares_.empty()) {
+    return;
   }
+  std::size_t const squares_to_visit{(squares_.size() + SWEEP_PERIOD_ - 1)
+                                     / SWEEP_PERIOD_};
+  for (std::size_t i{0}; i != squares_to_visit; ++i) {
+    sweep_position_ = sweep_position_ % squares_.size();
+    Square& square{squares_[sweep_position_]};
+    if (square.first_evaporation_tick <= current_tick_) {
+      removeEvaporatedParticles(square);
+    }
+    ++sweep_position_;
+  }
+}
 
-  // remove empty pheromones squares (it's a erase_if)
-  for (auto pheromone_square{pheromones_squares_.begin()};
-       pheromone_square != pheromones_squares_.end();) {
-    if (pheromone_square->second.empty()) {
-      pheromone_square = pheromones_squares_.erase(pheromone_square);
-    } else {
-      ++pheromone_square;
+void Pheromones::setEvaporation(double min_pheromone_intensity,
+                                double decrease_percentage_amount)
+{
+  // the particles already present start again from their current intensity,
+  // since the new decay_ would give them the wrong one
+  for (auto& square : squares_) {
+    removeEvaporatedParticles(square);
+    for (std::size_t i{0}; i != square.intensity.size(); ++i) {
+      square.intensity[i]    = getIntensity(square, i);
+      square.deposit_tick[i] = current_tick_;
+    }
+  }
+
+  MIN_PHEROMONE_INTENSITY_    = min_pheromone_intensity;
+  DECREASE_PERCENTAGE_AMOUNT_ = decrease_percentage_amount;
+
+  decay_.assign(1, 1.);
+  std::fill(evaporations_.begin(), evaporations_.end(), 0);
+  for (auto& square : squares_) {
+    square.first_evaporation_tick = NO_EVAPORATION_TICK;
+    for (std::size_t i{0}; i != square.intensity.size(); ++i) {
+      std::size_t const lifetime{getLifetime(square.intensity[i])};
+      square.evaporation_tick[i] = current_tick_ + lifetime;
+      square.first_evaporation_tick =
+          std::min(square.first_evaporation_tick, current_tick_ + lifetime);
+      addEvaporation(lifetime);
     }
   }
 }
 
 void Pheromones::optimizePath(bool optimize_path)
 {
-  MIN_PHEROMONE_INTENSITY_    = optimize_path
-                                  ? MIN_PHEROMONE_INTENSITY_OPTIMIZATION_
-                                  : MIN_PHEROMONE_INTENSITY_MAP_;
-  DECREASE_PERCENTAGE_AMOUNT_ = optimize_path
-                                  ? DECREASE_PERCENTAGE_AMOUNT_OPTIMIZATION_
-                                  : DECREASE_PERCENTAGE_AMOUNT_MAP_;
+  setEvaporation(optimize_path ? MIN_PHEROMONE_INTENSITY_OPTIMIZATION_
+                               : MIN_PHEROMONE_INTENSITY_MAP_,
+                 optimize_path ? DECREASE_PERCENTAGE_AMOUNT_OPTIMIZATION_
+                               : DECREASE_PERCENTAGE_AMOUNT_MAP_);
 }
 
-Pheromones::Iterator::Iterator(square_const_it const& pheromone_particle_it,
-                               map_const_it const& pheromones_square_it,
-                               map_const_it const& pheromones_square_end_it)
-    : pheromone_particle_it_{pheromone_particle_it}
-    , pheromones_square_it_{pheromones_square_it}
-    , pheromones_square_end_it_{pheromones_square_end_it}
-{}
+void Pheromones::setDecreasePercentageAmount(double decrease_percentage_amount)
+{
+  if (!(decrease_percentage_amount > 0. && decrease_percentage_amount < 1.)) {
+    throw std::invalid_argument{
+        "the decrease percentage amount of the pheromones must be in (0., 1.)"};
+  }
+  setEvaporation(MIN_PHEROMONE_INTENSITY_, decrease_percentage_amount);
+}
+
+double Pheromones::getDecreasePercentageAmount() const
+{
+  return DECREASE_PERCENTAGE_AMOUNT_;
+}
+
+void Pheromones::saveToSnapshot(SnapshotWriter& snapshot) const
+{
+  snapshot.write(type_);
+  snapshot.write(SQUARE_LENGTH_);
+  snapshot.write<std::uint8_t>(is_bounded_);
+  snapshot.write(model_);
+  snapshot.write(grid_origin_.x);
+  snapshot.write(grid_origin_.y);
+  snapshot.write(grid_width_);
+  snapshot.write(grid_height_);
+  snapshot.write(MIN_PHEROMONE_INTENSITY_);
+  snapshot.write(DECREASE_PERCENTAGE_AMOUNT_);
+  snapshot.write(time_since_last_evaporation_);
+  snapshot.write<std::uint64_t>(number_of_pheromones_);
+  snapshot.write<std::uint64_t>(current_tick_);
+  snapshot.write<std::uint64_t>(sweep_position_);
+  snapshot.writeRandomEngine(random_engine_);
+  snapshot.writeArray(decay_);
+  // in the order of the updates, starting from the next one
+  std::vector<std::uint64_t> evaporations(evaporations_.size());
+  for (std::size_t k{0}; k != evaporations.size(); ++k) {
+    evaporations[k] =
+        evaporations_[(current_tick_ + k + 1) % evaporations_.size()];
+  }
+  snapshot.writeArray(evaporations);
+
+  snapshot.write<std::uint64_t>(squares_.size());
+  for (auto const& square : squares_) {
+    snapshot.write(square.coordinate.x);
+    snapshot.write(square.coordinate.y);
+    snapshot.writeArray(square.x);
+    snapshot.writeArray(square.y);
+    snapshot.writeArray(square.intensity);
+    snapshot.writeArray(square.deposit_tick);
+    snapshot.writeArray(square.evaporation_tick);
+  }
+  snapshot.write(diffusion_rate_);
+  snapshot.writeArray(field_);
+}
+
+// if it throws the pheromones are left as they were
+// may throw std::runtime_error if the snapshot is badly formatted
+void Pheromones::loadFromSnapshot(SnapshotReader& snapshot)
+{
+  Type const type{snapshot.read<Type>()};
+  checkSnapshot(type == type_, "the pheromones are of the wrong type");
+  double const square_length{snapshot.read<double>()};
+  bool const is_bounded{snapshot.read<std::uint8_t>() != 0};
+  Model const model{snapshot.read<Model>()};
+  PheromonesSquareCoordinate grid_origin{0, 0};
+  grid_origin.x          = snapshot.read<int>();
+  grid_origin.y          = snapshot.read<int>();
+  int const grid_width{snapshot.read<int>()};
+  int const grid_height{snapshot.read<int>()};
+  double const min_pheromone_intensity{snapshot.read<double>()};
+  double const decrease_percentage_amount{snapshot.read<double>()};
+  double const time_since_last_evaporation{snapshot.read<double>()};
+  std::uint64_t const number_of_pheromones{snapshot.read<std::uint64_t>()};
+  std::uint64_t const current_tick{snapshot.read<std::uint64_t>()};
+  std::uint64_t const sweep_position{snapshot.read<std::uint64_t>()};
+  std::default_random_engine random_engine;
+  snapshot.readRandomEngine(random_engine);
+  std::vector<double> decay;
+  snapshot.readArray(decay);
+  std::vector<std::uint64_t> evaporations;
+  snapshot.readArray(evaporations);
+
+  checkSnapshot(square_length > 0., "pheromones' square length <= 0");
+  checkSnapshot(model == Model::PARTICLES
+                    || (model == Model::FIELD && is_bounded),
+                "pheromones' model");
+  checkSnapshot(decrease_percentage_amount >= 0.
+                    && decrease_percentage_amount < 1.,
+                "pheromones' decrease percentage amount outside [0, 1)");
+  checkSnapshot(!decay.empty() && decay.front() == 1.,
+                "pheromones' decay table");
+  // the squares of the FIELD model don't evaporate one particle at a time
+  checkSnapshot(model == Model::FIELD
+                    || std::accumulate(evaporations.begin(), evaporations.end(),
+                                       std::uint64_t{0})
+                           == number_of_pheromones,
+                "the pheromones' evaporations don't match their number");
+
+  std::uint64_t const number_of_squares{snapshot.read<std::uint64_t>()};
+  if (is_bounded) {
+    checkSnapshot(grid_width > 0 && grid_height > 0,
+                  "the pheromones' grid is empty");
+  }
+  if (model == Model::FIELD) {
+    checkSnapshot(number_of_squares == 0,
+                  "the pheromones' field has particles");
+  } else if (is_bounded) {
+    checkSnapshot(number_of_squares
+                      == static_cast<std::uint64_t>(grid_width)
+                             * static_cast<std::uint64_t>(grid_height),
+                  "the pheromones' squares don't match their grid");
+  }
 
-Pheromones::Iterator& Pheromones::Iterator::operator++() // prefix ++
+  std::vector<Square> squares;
+  std::unordered_map<PheromonesSquareCoordinate, std::size_t> square_indices;
+  std::uint64_t alive_pheromones{0};
+  for (std::uint64_t i{0}; i != number_of_squares; ++i) {
+    Square square{{0, 0}, {}, {}, {}, {}, {}, NO_EVAPORATION_TICK};
+    square.coordinate.x = snapshot.read<int>();
+    square.coordinate.y = snapshot.read<int>();
+    snapshot.readArray(square.x);
+    snapshot.readArray(square.y);
+    snapshot.readArray(square.intensity);
+    snapshot.readArray(square.deposit_tick);
+    snapshot.readArray(square.evaporation_tick);
+
+    std::size_t const size{square.x.size()};
+    checkSnapshot(square.y.size() == size && square.intensity.size() == size
+                      && square.deposit_tick.size() == size
+                      && square.evaporation_tick.size() == size,
+                  "the arrays of a pheromones' square have different sizes");
+    for (std::size_t p{0}; p != size; ++p) {
+      // the intensity of the particles alive must be in the decay table
+      checkSnapshot(square.deposit_tick[p] <= current_tick
+                        && square.deposit_tick[p] < square.evaporation_tick[p]
+                        && square.evaporation_tick[p] - square.deposit_tick[p]
+                               <= decay.size(),
+                    "pheromone particle with invalid ticks");
+      square.first_evaporation_tick =
+          std::min(square.first_evaporation_tick, square.evaporation_tick[p]);
+      if (square.evaporation_tick[p] > current_tick) {
+        ++alive_pheromones;
+      }
+    }
+
+    if (!is_bounded) {
+      checkSnapshot(
+          square_indices.try_emplace(square.coordinate, squares.size()).second,
+          "two pheromones' squares with the same coordinate");
+    }
+    squares.push_back(std::move(square));
+  }
+
+  double const diffusion_rate{snapshot.read<double>()};
+  std::vector<double> field;
+  snapshot.readArray(field);
+  if (model == Model::FIELD) {
+    checkSnapshot(diffusion_rate >= 0. && diffusion_rate < 1.,
+                  "pheromones' diffusion rate outside [0, 1)");
+    checkSnapshot(field.size()
+                      == static_cast<std::size_t>(grid_width)
+                             * static_cast<std::size_t>(grid_height),
+                  "the pheromones' field doesn't match its grid");
+    for (double intensity : field) {
+      checkSnapshot(intensity >= 0. && std::isfinite(intensity),
+                    "pheromones' field with an invalid intensity");
+      if (intensity != 0.) {
+        ++alive_pheromones;
+      }
+    }
+  } else {
+    checkSnapshot(diffusion_rate == 0. && field.empty(),
+                  "the pheromones' particles have a field");
+  }
+  checkSnapshot(alive_pheromones == number_of_pheromones,
+                "the pheromones don't match their number");
+
+  // all valid
+  SQUARE_LENGTH_               = square_length;
+  model_                       = model;
+  squares_                     = std::move(squares);
+  square_indices_              = std::move(square_indices);
+  is_bounded_                  = is_bounded;
+  grid_origin_                 = grid_origin;
+  grid_width_                  = grid_width;
+  grid_height_                 = grid_height;
+  number_of_pheromones_        = static_cast<std::size_t>(number_of_pheromones);
+  current_tick_                = static_cast<std::size_t>(current_tick);
+  decay_                       = std::move(decay);
+  evaporations_.assign(evaporations.size(), 0);
+  for (std::size_t k{0}; k != evaporations.size(); ++k) {
+    evaporations_[(current_tick_ + k + 1) % evaporations_.size()] =
+        static_cast<std::size_t>(evaporations[k]);
+  }
+  sweep_position_              = static_cast<std::size_t>(sweep_position);
+  random_engine_               = random_engine;
+  time_since_last_evaporation_ = time_since_last_evaporation;
+  MIN_PHEROMONE_INTENSITY_     = min_pheromone_intensity;
+  DECREASE_PERCENTAGE_AMOUNT_  = decrease_percentage_amount;
+  field_                       = std::move(field);
+  diffusion_rate_              = diffusion_rate;
+  if (diffusion_rate_ != 0.) {
+    diffused_field_.assign(field_.size(), 0.);
+  }
+  ++version_;
+}
+
+Pheromones::Iterator::Iterator(Pheromones const& pheromones,
+                               std::size_t square_index,
+                               std::size_t particle_index)
+    : pheromones_{&pheromones}
+    , square_index_{square_index}
+    , particle_index_{particle_index}
+    , particle_{}
 {
-  ++pheromone_particle_it_;
+  skipEvaporatedParticles();
+}
 
-  // check if we are not at the end of the current square
-  if (pheromone_particle_it_ != pheromones_square_it_->second.end()) {
-    return *this;
+void Pheromones::Iterator::skipEvaporatedParticles()
+{
+  // the squares with pheromones of the FIELD model stand for a single particle
+  // at their center
+  if (pheromones_->model_ == Model::FIELD) {
+    std::vector<double> const& field{pheromones_->field_};
+    while (square_index_ < field.size() && field[square_index_] == 0.) {
+      ++square_index_;
+    }
+    if (square_index_ >= field.size()) {
+      square_index_ = field.size();
+      particle_.reset();
+      return;
+    }
+    particle_.emplace(pheromones_->getFieldSquareCenter(square_index_),
+                      field[square_index_]);
+    return;
   }
 
-  // we're at the end of the current square
-  ++pheromones_square_it_;
-  if (pheromones_square_it_
-      == pheromones_square_end_it_) { // i.e. we're at the end() of all
-                                      // pheromones
-    return *this;
+  std::vector<Square> const& squares{pheromones_->squares_};
+  while (square_index_ < squares.size()) {
+    Square const& square{squares[square_index_]};
+    if (particle_index_ >= square.intensity.size()) {
+      ++square_index_;
+      particle_index_ = 0;
+    } else if (pheromones_->hasEvaporated(square, particle_index_)) {
+      ++particle_index_;
+    } else {
+      break;
+    }
+  }
+
+  if (square_index_ >= squares.size()) { // i.e. we're at the end() of all
+                                         // pheromones
+    square_index_   = squares.size();
+    particle_index_ = 0;
+    particle_.reset();
+    return;
   }
 
-  // we're at the end of the current square BUT it wasn't the last square
-  pheromone_particle_it_ = pheromones_square_it_->second.begin();
+  Square const& square{squares[square_index_]};
+  particle_.emplace(
+      Vector2d{square.x[particle_index_], square.y[particle_index_]},
+      pheromones_->getIntensity(square, particle_index_));
+}
+
+Pheromones::Iterator& Pheromones::Iterator::operator++() // prefix ++
+{
+  if (pheromones_->model_ == Model::FIELD) {
+    ++square_index_;
+  } else {
+    ++particle_index_;
+  }
+  skipEvaporatedParticles();
   return *this;
 }
 
 PheromoneParticle const& Pheromones::Iterator::operator*() const
 {
-  return *pheromone_particle_it_;
+  assert(particle_.has_value());
+  return *particle_;
 }
 
 PheromoneParticle const* Pheromones::Iterator::operator->() const
 {
-  return &(*pheromone_particle_it_);
+  assert(particle_.has_value());
+  return &(*particle_);
 }
 
 bool operator==(Pheromones::Iterator const& lhs,
                 Pheromones::Iterator const& rhs)
 {
-  // are they pointing to the same thing OR are they both end()?
-  return lhs.pheromone_particle_it_ == rhs.pheromone_particle_it_
-      || (lhs.pheromones_square_it_ == lhs.pheromones_square_end_it_
-          && rhs.pheromones_square_it_ == rhs.pheromones_square_end_it_);
+  return lhs.pheromones_ == rhs.pheromones_
+      && lhs.square_index_ == rhs.square_index_
+      && lhs.particle_index_ == rhs.particle_index_;
 }
 bool operator!=(Pheromones::Iterator const& lhs,
                 Pheromones::Iterator const& rhs)
@@ -832,18 +2110,12 @@ bool operator!=(Pheromones::Iterator const& lhs,
 
 Pheromones::Iterator Pheromones::begin() const
 {
-  if (pheromones_squares_.empty()) {
-    return end();
-  }
-
-  return Pheromones::Iterator{pheromones_squares_.begin()->second.begin(),
-                              pheromones_squares_.begin(),
-                              pheromones_squares_.end()};
+  return Pheromones::Iterator{*this, 0, 0};
 }
 Pheromones::Iterator Pheromones::end() const
 {
-  return Pheromones::Iterator{square_const_it{}, pheromones_squares_.end(),
-                              pheromones_squares_.end()};
+  return Pheromones::Iterator{
+      *this, model_ == Model::FIELD ? field_.size() : squares_.size(), 0};
 }
 
 // implementation of class Anthill
@@ -977,4 +2249,159 @@ bool Anthill::saveToFile(std::string const& filepath) const
   return true;
 }
 
-} // namespace kape
\ No newline at end of file
+void Anthill::saveToSnapshot(SnapshotWriter& snapshot) const
+{
+  snapshot.write(circle_.getCircleCenter().x);
+  snapshot.write(circle_.getCircleCenter().y);
+  snapshot.write(circle_.getCircleRadius());
+  snapshot.write(food_counter_);
+}
+
+// if it throws the anthill is left as it was
+// may throw std::runtime_error if the snapshot is badly formatted
+void Anthill::loadFromSnapshot(SnapshotReader& snapshot)
+{
+  double const center_x{snapshot.read<double>()};
+  double const center_y{snapshot.read<double>()};
+  double const radius{snapshot.read<double>()};
+  int const food_counter{snapshot.read<int>()};
+  checkSnapshot(radius > 0., "anthill with radius <= 0");
+  checkSnapshot(food_counter >= 0, "anthill with a negative food counter");
+
+  // all valid
+  circle_       = Circle{Vector2d{center_x, center_y}, radius};
+  food_counter_ = food_counter;
+}
+
+// implementation of class SensingGrid---------------------------------------
+SensingGrid::SensingGrid()
+    : origin_{0., 0.}
+    , cell_size_{1.}
+    , width_{0}
+    , height_{0}
+    , cells_{}
+    , reach_{0.}
+    , obstacles_version_{0}
+    , food_{nullptr}
+    , food_circles_version_{0}
+    , anthill_{nullptr}
+    , anthill_circle_{}
+{}
+
+void SensingGrid::markBox(Vector2d const& bottom_left,
+                          Vector2d const& top_right, std::uint8_t nearby)
+{
+  // the box is inside the grid, which was made to contain it
+  auto const to_cell{[this](double coordinate, double origin,
+                            std::size_t number_of_cells) {
+    double const cell{std::floor((coordinate - origin) / cell_size_)};
+    return static_cast<std::size_t>(std::clamp(
+        cell, 0., static_cast<double>(number_of_cells - 1)));
+  }};
+  std::size_t const first_column{
+      to_cell(bottom_left.x - reach_, origin_.x, width_)};
+  std::size_t const last_column{
+      to_cell(top_right.x + reach_, origin_.x, width_)};
+  std::size_t const first_row{
+      to_cell(bottom_left.y - reach_, origin_.y, height_)};
+  std::size_t const last_row{to_cell(top_right.y + reach_, origin_.y, height_)};
+  for (std::size_t row{first_row}; row <= last_row; ++row) {
+    for (std::size_t column{first_column}; column <= last_column; ++column) {
+      cells_[row * width_ + column] |= nearby;
+    }
+  }
+}
+
+// may throw std::invalid_argument if reach <= 0.
+void SensingGrid::build(Obstacles const& obstacles, Food const& food,
+                        Anthill const& anthill, double reach)
+{
+  if (!(reach > 0.)) {
+    throw std::invalid_argument{"The reach of the grid must be > 0."};
+  }
+  reach_                = reach;
+  obstacles_version_    = obstacles.getVersion();
+  food_                 = &food;
+  food_circles_version_ = food.getCirclesVersion();
+  anthill_              = &anthill;
+  anthill_circle_       = anthill.getCircle();
+
+  // the grid covers the boxes of all the objects, plus reach on every side
+  Circle const& anthill_circle{anthill.getCircle()};
+  Vector2d const anthill_extent{anthill_circle.getCircleRadius(),
+                                anthill_circle.getCircleRadius()};
+  Vector2d bottom_left{anthill_circle.getCircleCenter() - anthill_extent};
+  Vector2d top_right{anthill_circle.getCircleCenter() + anthill_extent};
+  auto const add_box{[&](Vector2d const& box_bottom_left,
+                         Vector2d const& box_top_right) {
+    bottom_left.x = std::min(bottom_left.x, box_bottom_left.x);
+    bottom_left.y = std::min(bottom_left.y, box_bottom_left.y);
+    top_right.x   = std::max(top_right.x, box_top_right.x);
+    top_right.y   = std::max(top_right.y, box_top_right.y);
+  }};
+  if (obstacles.getNumberOfObstacles() != 0) {
+    Rectangle const bounding_box{obstacles.getBoundingBox()};
+    Vector2d const& top_left{bounding_box.getRectangleTopLeftCorner()};
+    add_box(top_left - Vector2d{0., bounding_box.getRectangleHeight()},
+            top_left + Vector2d{bounding_box.getRectangleWidth(), 0.});
+  }
+  food.forEachCircleWithFood([&](Circle const& circle) {
+    Vector2d const extent{circle.getCircleRadius(), circle.getCircleRadius()};
+    add_box(circle.getCircleCenter() - extent,
+            circle.getCircleCenter() + extent);
+  });
+  origin_ = bottom_left - Vector2d{reach, reach};
+  double const width{top_right.x - bottom_left.x + 2. * reach};
+  double const height{top_right.y - bottom_left.y + 2. * reach};
+
+  // cells as wide as the reach, unless there would be too many of them
+  cell_size_ = std::max(
+      reach, std::sqrt(width * height / static_cast<double>(MAX_CELLS_)));
+  // one more cell than needed, for the points on the top and right sides
+  width_  = static_cast<std::size_t>(std::floor(width / cell_size_)) + 1;
+  height_ = static_cast<std::size_t>(std::floor(height / cell_size_)) + 1;
+  // no allocation if the grid didn't grow
+  cells_.assign(width_ * height_, NOTHING_);
+
+  for (Rectangle const& obstacle : obstacles) {
+    Vector2d const& top_left{obstacle.getRectangleTopLeftCorner()};
+    markBox(top_left - Vector2d{0., obstacle.getRectangleHeight()},
+            top_left + Vector2d{obstacle.getRectangleWidth(), 0.}, OBSTACLES_);
+  }
+  food.forEachCircleWithFood([this](Circle const& circle) {
+    Vector2d const extent{circle.getCircleRadius(), circle.getCircleRadius()};
+    markBox(circle.getCircleCenter() - extent,
+            circle.getCircleCenter() + extent, FOOD_);
+  });
+  markBox(anthill_circle.getCircleCenter() - anthill_extent,
+          anthill_circle.getCircleCenter() + anthill_extent, ANTHILL_);
+}
+
+bool SensingGrid::isBuiltFrom(Obstacles const& obstacles, Food const& food,
+                              Anthill const& anthill, double reach) const
+{
+  Circle const& anthill_circle{anthill.getCircle()};
+  return reach == reach_ && obstacles.getVersion() == obstacles_version_
+      && &food == food_ && food.getCirclesVersion() == food_circles_version_
+      && &anthill == anthill_
+      && anthill_circle.getCircleCenter().x
+             == anthill_circle_.getCircleCenter().x
+      && anthill_circle.getCircleCenter().y
+             == anthill_circle_.getCircleCenter().y
+      && anthill_circle.getCircleRadius() == anthill_circle_.getCircleRadius();
+}
+
+std::uint8_t SensingGrid::getNearby(Vector2d const& position) const
+{
+  // outside the grid there's nothing within reach
+  double const column{std::floor((position.x - origin_.x) / cell_size_)};
+  double const row{std::floor((position.y - origin_.y) / cell_size_)};
+  if (!(column >= 0. && column < static_cast<double>(width_) && row >= 0.
+        && row < static_cast<double>(height_))) {
+    return NOTHING_;
+  }
+  return cells_[static_cast<std::size_t>(row) * width_
+                + static_cast<std::size_t>(column)];
+}
+
+} // namespace kape
@@ -2,7 +2,11 @@
 #define ENVIRONMENT_HPP
 #include "geometry.hpp" //for Vector2d
 #include <SFML/Graphics.hpp>
-#include <deque>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
 #include <random>
 #include <stdexcept>
 #include <unordered_map>
@@ -10,9 +14,49 @@
 
 namespace kape {
 
+// defined in snapshot.hpp
+class SnapshotWriter;
+class SnapshotReader;
+
 class Obstacles
 {
+  // the obstacles are indexed by a uniform grid covering their bounding box,
+  // so that a circle is tested only against the obstacles in the cells it
+  // touches. The grid has about GRID_CELLS_PER_OBSTACLE_ cells per obstacle,
+  // and never more than MAX_GRID_CELLS_
+  inline static std::size_t const GRID_CELLS_PER_OBSTACLE_{4};
+  inline static std::size_t const MAX_GRID_CELLS_{1u << 20};
+  // the last version given to any Obstacles, see getVersion()
+  inline static std::atomic<std::uint64_t> last_version_{0};
+
+  // cells of the grid overlapped by an axis aligned box
+  struct GridRange
+  {
+    std::size_t first_column;
+    std::size_t last_column;
+    std::size_t first_row;
+    std::size_t last_row;
+  };
+
   std::vector<Rectangle> obstacles_vec_;
+  // bottom left corner of the grid
+  Vector2d grid_origin_;
+  double grid_cell_size_;
+  std::size_t grid_width_;  // number of columns
+  std::size_t grid_height_; // number of rows
+  // the indices of the obstacles overlapping the cell (row * grid_width_ +
+  // column) are grid_obstacle_indices_[grid_cell_offsets_[cell]] to
+  // grid_obstacle_indices_[grid_cell_offsets_[cell + 1] - 1]
+  std::vector<std::size_t> grid_cell_offsets_;
+  std::vector<std::size_t> grid_obstacle_indices_;
+  std::uint64_t version_;
+
+  // also gives the obstacles a new version
+  void buildGrid();
+  // returns an empty optional if the box doesn't overlap the grid, i.e. if
+  // there can't be any obstacles in it
+  std::optional<GridRange> getGridRange(Vector2d const& bottom_left,
+                                        Vector2d const& top_right) const;
 
  public:
   inline static std::string const DEFAULT_FILEPATH_{
@@ -20,10 +64,24 @@ class Obstacles
 
   explicit Obstacles();
   std::size_t getNumberOfObstacles() const;
+  // changes every time an obstacle is added or the obstacles are loaded, and
+  // it's taken from a counter shared by all the Obstacles: two Obstacles with
+  // the same version have the same obstacles (e.g. a copy keeps the version of
+  // its source), so one assigned and loaded again gets a new version
+  std::uint64_t getVersion() const;
+  // every call rebuilds the grid: to add many obstacles at once prefer
+  // loadFromFile(), which builds it only once
   void addObstacle(Vector2d const& top_left_corner, double width,
                    double height);
   void addObstacle(Rectangle const& obstacle);
   bool anyObstaclesInCircle(Circle const& circle) const;
+  // element i is anyObstaclesInCircle(circles[i]), but the grid is visited only
+  // once for all the circles (e.g. the circles of vision of an ant)
+  std::array<bool, 3>
+  anyObstaclesInCircles(std::array<Circle, 3> const& circles) const;
+  // returns the smallest rectangle containing all the obstacles
+  // may throw std::runtime_error if there are no obstacles
+  Rectangle getBoundingBox() const;
 
   bool loadFromFile(std::string const& filepath = DEFAULT_FILEPATH_);
   bool saveToFile(std::string const& filepath = DEFAULT_FILEPATH_) const;
@@ -68,8 +126,28 @@ class Food
   class CircleWithFood
   {
    private:
+    // the particles are bucketed in a square grid covering the circle, with
+    // about FOOD_PARTICLES_PER_CELL_ particles per cell when it's generated, so
+    // that a query only looks at the cells near it
+    inline static std::size_t const FOOD_PARTICLES_PER_CELL_{8};
+    inline static std::size_t const MAX_GRID_SIDE_{256};
+
     Circle circle_;
-    std::vector<FoodParticle> food_vec_;
+    std::size_t grid_side_; // number of cells per side
+    double cell_size_;
+    // cells_[row * grid_side_ + column], the order of the particles inside a
+    // cell isn't preserved when one of them is removed
+    std::vector<std::vector<FoodParticle>> cells_;
+    std::size_t number_of_food_particles_;
+
+    // a circle with grid_side * grid_side empty cells
+    explicit CircleWithFood(Circle const& circle, std::size_t grid_side);
+
+    std::size_t getCellIndex(Vector2d const& position) const;
+    // calls function(cell) for every cell overlapping the bounding box of
+    // circle, until function returns true. Returns true if it did
+    template<class Function>
+    bool anyCellAroundCircle(Circle const& circle, Function function) const;
 
    public:
     // may throw std::invalid_argument if the circle intersects with any of the
@@ -81,20 +159,42 @@ class Food
     Circle const& getCircle() const;
     std::size_t getNumberOfFoodParticles() const;
     bool removeOneFoodParticleInCircle(Circle const& circle);
+    bool isThereFoodInCircle(Circle const& circle) const;
     bool isThereFoodLeft() const;
 
-    std::vector<FoodParticle>::const_iterator begin() const;
-    std::vector<FoodParticle>::const_iterator end() const;
+    std::vector<std::vector<FoodParticle>> const& getCells() const;
+
+    void saveToSnapshot(SnapshotWriter& snapshot) const;
+    // may throw std::runtime_error if the snapshot is badly formatted
+    static CircleWithFood loadFromSnapshot(SnapshotReader& snapshot);
   };
 
   std::vector<CircleWithFood> circles_with_food_vec_;
   std::default_random_engine engine_;
+  std::size_t number_of_food_particles_;
+  std::uint64_t version_;
+  std::uint64_t circles_version_;
 
  public:
   inline static std::string const DEFAULT_FILEPATH_{
       "./assets/simulations/map_1/food/food.dat"};
   explicit Food(unsigned int seed = 11u);
+  // O(1)
   std::size_t getNumberOfFoodParticles() const;
+  // changes every time a particle is added or removed, e.g. to know if the
+  // food has to be drawn again
+  std::uint64_t getVersion() const;
+  // changes every time a circle with food is added or emptied, not when a
+  // particle is taken from a circle that still has some
+  std::uint64_t getCirclesVersion() const;
+  // calls function(circle) for every circle that still has food
+  template<class Function>
+  void forEachCircleWithFood(Function function) const
+  {
+    for (auto const& circle_with_food : circles_with_food_vec_) {
+      function(circle_with_food.getCircle());
+    }
+  }
 
   // returns:
   //  - true if it generated the food_particles
@@ -116,24 +216,38 @@ class Food
   //
   // iterators of class Food::Iterator are invalidated if true
   bool removeOneFoodParticleInCircle(Circle const& circle);
+  // returns true if removeOneFoodParticleInCircle(circle) would succeed
+  bool isThereFoodInCircle(Circle const& circle) const;
+  // cheaper than isThereFoodInCircle(): returns false if circle doesn't reach
+  // any of the circles with food, so that there's no food in any circle inside
+  // it
+  bool isNearFood(Circle const& circle) const;
 
   bool loadFromFile(Obstacles const& obstacles,
                     std::string const& filepath = DEFAULT_FILEPATH_);
   bool saveToFile(std::string const& filepath = DEFAULT_FILEPATH_) const;
 
+  // the particles left and the state of the random engine
+  void saveToSnapshot(SnapshotWriter& snapshot) const;
+  // if it throws the food is left as it was
+  // may throw std::runtime_error if the snapshot is badly formatted
+  void loadFromSnapshot(SnapshotReader& snapshot);
+
   class Iterator
   {
    private:
-    std::vector<FoodParticle>::const_iterator food_particle_it_;
-    std::vector<CircleWithFood>::const_iterator circle_with_food_it_;
-    std::vector<CircleWithFood>::const_iterator const circle_with_food_back_it_;
+    std::vector<CircleWithFood> const* circles_with_food_;
+    std::size_t circle_index_;
+    std::size_t cell_index_;
+    std::size_t particle_index_;
+
+    // moves forward until it points to a particle or to the end
+    void skipEmptyCells();
 
    public:
-    explicit Iterator(
-        std::vector<FoodParticle>::const_iterator const& food_particle_it,
-        std::vector<CircleWithFood>::const_iterator const& circle_with_food_it,
-        std::vector<CircleWithFood>::const_iterator const&
-            circle_with_food_back_it);
+    explicit Iterator(std::vector<CircleWithFood> const& circles_with_food,
+                      std::size_t circle_index, std::size_t cell_index,
+                      std::size_t particle_index);
     Iterator& operator++(); // prefix ++
     FoodParticle const& operator*() const;
 
@@ -164,9 +278,15 @@ struct std::hash<kape::PheromonesSquareCoordinate>
   std::size_t
   operator()(kape::PheromonesSquareCoordinate const& coordinate) const noexcept
   {
-    std::size_t hash_x = std::hash<int>{}(coordinate.x);
-    std::size_t hash_y = std::hash<int>{}(coordinate.y);
-    return hash_x ^ (hash_y << 1);
+    // both coordinates packed in 64 bits and then mixed (splitmix64 finalizer)
+    // so that neighbouring squares don't end up in neighbouring buckets
+    std::uint64_t mixed{
+        (static_cast<std::uint64_t>(static_cast<std::uint32_t>(coordinate.x))
+         << 32)
+        | static_cast<std::uint32_t>(coordinate.y)};
+    mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<std::size_t>(mixed ^ (mixed >> 31));
   }
 };
 
@@ -180,8 +300,38 @@ class Pheromones
     TO_FOOD,
     TO_ANTHILL
   };
+  // PARTICLES: every particle released is stored, with its own position.
+  // FIELD: a scalar field on a dense grid of squares smaller than the ant's
+  // circle of vision. The particles are added to the square they fall in, so
+  // the memory used depends on the area of the map and not on the particles
+  // released
+  enum class Model
+  {
+    PARTICLES,
+    FIELD
+  };
 
  private:
+  // the particles inside one of the squares, stored as a structure of arrays:
+  // the i-th particle is at (x[i], y[i]) and was released with intensity
+  // intensity[i] at the evaporation update deposit_tick[i]. The particles
+  // don't evaporate one by one: their intensity is computed when they are read
+  // and they are considered gone from the update evaporation_tick[i], even if
+  // they are removed from the square only later
+  // the arrays always have the same capacity: they grow together, by at least
+  // PARTICLES_CHUNK_ particles, and are never shrunk
+  struct Square
+  {
+    PheromonesSquareCoordinate coordinate;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> intensity;
+    std::vector<std::size_t> deposit_tick;
+    std::vector<std::size_t> evaporation_tick;
+    // the smallest of evaporation_tick
+    std::size_t first_evaporation_tick;
+  };
+
   PheromonesSquareCoordinate
   positionToPheromonesSquareCoordinate(Vector2d const& position) const;
   // returns the position of the top left corner of the square
@@ -201,38 +351,131 @@ class Pheromones
   inline static double const DECREASE_PERCENTAGE_AMOUNT_OPTIMIZATION_{0.001};
 
  private:
-  // has to be > than an ant's circle of vision diameter
-  double const SQUARE_LENGTH_;
-  std::unordered_map<PheromonesSquareCoordinate, std::deque<PheromoneParticle>>
-      pheromones_squares_;
-  const Type type_;
+  // the evaporated particles are removed a few squares at a time: every square
+  // is visited at least once every SWEEP_PERIOD_ evaporation updates
+  inline static std::size_t const SWEEP_PERIOD_{16};
+  // the arrays of the squares and the ring of evaporations_ grow to at least
+  // this many elements
+  inline static std::size_t const PARTICLES_CHUNK_{64};
+  // the squares of the FIELD model are this many times smaller than the ant's
+  // circle of vision diameter
+  inline static double const FIELD_SQUARES_PER_DIAMETER_{4.};
+
+  // has to be > than an ant's circle of vision diameter, except for the FIELD
+  // model
+  double SQUARE_LENGTH_;
+  Model model_;
+  // if the pheromones are bounded squares_ is a dense grid covering the
+  // bounds, one row after the other, starting from grid_origin_ (the square
+  // with the lowest coordinates). Otherwise the squares are created the first
+  // time a particle is added to them, and square_indices_ maps their
+  // coordinate to their index in squares_
+  std::vector<Square> squares_;
+  std::unordered_map<PheromonesSquareCoordinate, std::size_t> square_indices_;
+  bool is_bounded_;
+  PheromonesSquareCoordinate grid_origin_;
+  int grid_width_;
+  int grid_height_;
+  // doesn't count the evaporated particles, even if they haven't been removed
+  std::size_t number_of_pheromones_;
+  // number of evaporation updates done so far
+  std::size_t current_tick_;
+  // decay_[k] is the fraction of its intensity left to a particle after k
+  // evaporation updates. It's extended when a longer lived particle is added
+  std::vector<double> decay_;
+  // a ring: the particles that evaporate at the update t are counted in
+  // evaporations_[t % evaporations_.size()]. It's longer than the lifetime of
+  // any particle, so the updates never have to shift it
+  std::vector<std::size_t> evaporations_;
+  // free lists of the arrays taken from the squares that became empty,
+  // bucketed by capacity: free_particles_arrays_[c] holds the ones with a
+  // capacity in [PARTICLES_CHUNK_ * 2^c, PARTICLES_CHUNK_ * 2^(c + 1)). They
+  // are given to the squares that need larger ones, so that trails moving
+  // around reuse the memory of the ones that faded
+  std::vector<std::vector<Square>> free_particles_arrays_;
+  std::size_t number_of_allocations_;
+  // only for the FIELD model, where squares_ is empty: the intensity in each
+  // square of the grid, laid out like squares_. The number of pheromones is
+  // the number of squares with a non null intensity
+  std::vector<double> field_;
+  // where the diffusion is computed before being swapped with field_, kept to
+  // not allocate it at every update
+  std::vector<double> diffused_field_;
+  double diffusion_rate_;
+  // the next square to be visited looking for evaporated particles
+  std::size_t sweep_position_;
+  Type type_;
   std::default_random_engine random_engine_;
   double time_since_last_evaporation_;
 
   double MIN_PHEROMONE_INTENSITY_;
   double DECREASE_PERCENTAGE_AMOUNT_;
-
-  using map_const_it =
-      std::unordered_map<PheromonesSquareCoordinate,
-                         std::deque<PheromoneParticle>>::const_iterator;
-  using square_const_it = std::deque<PheromoneParticle>::const_iterator;
-
-  void fillWithNeighbouringPheromonesSquares(
-      std::vector<map_const_it>& neighbouring_squares,
-      PheromonesSquareCoordinate const& center_square_coordinate) const;
+  std::uint64_t version_;
+
+  // returns the index in squares_ of the square containing position, creating
+  // it if needed. If bounded, positions outside of the bounds are assigned to
+  // the closest square on the border
+  std::size_t getSquareIndexForInsertion(Vector2d const& position);
+  // returns the number of evaporation updates after which a particle released
+  // with the given intensity has evaporated (at least 1)
+  std::size_t getLifetime(double intensity);
+  bool hasEvaporated(Square const& square, std::size_t particle_index) const;
+  double getIntensity(Square const& square, std::size_t particle_index) const;
+  // the bucket of free_particles_arrays_ for arrays of this capacity
+  static std::size_t getCapacityClass(std::size_t capacity);
+  // arrays, empty but with memory, are moved to free_particles_arrays_
+  void addFreeParticlesArrays(Square&& arrays);
+  // the arrays of an empty square are moved to free_particles_arrays_
+  void removeEvaporatedParticles(Square& square);
+  // called when the arrays of square are full: they are replaced by larger
+  // ones, taken from free_particles_arrays_ if there are any
+  void growParticlesArrays(Square& square);
+  // counts a particle that evaporates lifetime updates from now
+  void addEvaporation(std::size_t lifetime);
+  // the position of the particle standing for the intensity of a square of
+  // field_
+  Vector2d getFieldSquareCenter(std::size_t square_index) const;
+  // each square gives diffusion_rate_ of its intensity to its 4 neighbours,
+  // the ones on the border keep the share of the neighbours they don't have
+  void diffuseField();
+  // the whole field loses DECREASE_PERCENTAGE_AMOUNT_ of its intensity, the
+  // squares left below the minimum intensity are emptied
+  void evaporateField();
+  // the particles already present keep their current intensity but from now on
+  // evaporate at the new rate
+  void setEvaporation(double min_pheromone_intensity,
+                      double decrease_percentage_amount);
+
+  // calls function(square_index, circles_mask) for each square that has at
+  // least one particle (a non null intensity for the FIELD model) and
+  // overlaps the bounding box of at least one of the circles, one row after
+  // the other. Bit c of circles_mask is set if it overlaps the c-th one's. The
+  // squares overlapped by more circles are visited once
+  template<std::size_t N, class Function>
+  void forEachSquareAroundCircles(std::array<Circle, N> const& circles,
+                                  Function function) const;
+  // calls function(square_index) for the squares around a single circle
+  template<class Function>
+  void forEachSquareAroundCircle(Circle const& circle, Function function) const;
 
  public:
   class Iterator
   {
    private:
-    square_const_it pheromone_particle_it_;
-    map_const_it pheromones_square_it_;
-    map_const_it pheromones_square_end_it_;
+    Pheromones const* pheromones_;
+    std::size_t square_index_;
+    std::size_t particle_index_;
+    // copy of the particle pointed to, with its current intensity, empty if
+    // it's the end() iterator
+    std::optional<PheromoneParticle> particle_;
+
+    // moves to the first particle that hasn't evaporated, starting from the
+    // current position
+    void skipEvaporatedParticles();
 
    public:
-    explicit Iterator(square_const_it const& pheromone_particle_it,
-                      map_const_it const& pheromones_square_it_,
-                      map_const_it const& pheromones_square_end_it);
+    explicit Iterator(Pheromones const& pheromones, std::size_t square_index,
+                      std::size_t particle_index);
     Iterator& operator++(); // prefix ++
     PheromoneParticle const& operator*() const;
     PheromoneParticle const* operator->() const;
@@ -241,44 +484,142 @@ class Pheromones
   };
 
   // Pheromone members------------------------
+  // unbounded pheromones: squares are allocated only where particles are added
   // may throw if ant_circle_of_vision_diameter<=0.
   explicit Pheromones(Type type, double ant_circle_of_vision_diameter,
                       unsigned int seed = 31415u);
+  // bounded pheromones: the squares are a dense grid covering bounds, faster
+  // to query than the unbounded ones. Particles outside of the bounds are still
+  // accepted and kept in the squares on the border of the grid
+  // may throw if ant_circle_of_vision_diameter<=0.
+  explicit Pheromones(Type type, double ant_circle_of_vision_diameter,
+                      Rectangle const& bounds, unsigned int seed = 31415u);
+  // bounded pheromones of the given model: the FIELD one needs the bounds to
+  // lay out its grid. Like above, particles outside of the bounds are added to
+  // the squares on the border
+  // may throw if ant_circle_of_vision_diameter<=0.
+  explicit Pheromones(Type type, double ant_circle_of_vision_diameter,
+                      Rectangle const& bounds, Model model,
+                      unsigned int seed = 31415u);
+  bool isBounded() const;
+  Model getModel() const;
+  // only for the FIELD model: at every evaporation update each square gives
+  // this fraction of its intensity to its 4 neighbours (0.: no diffusion)
+  // may throw std::invalid_argument if the model isn't FIELD or
+  // diffusion_rate isn't in [0., 1.)
+  void setDiffusionRate(double diffusion_rate);
+  double getDiffusionRate() const;
   double getPheromonesIntensityInCircle(Circle const& circle) const;
   // returns end() if there were no pheromones in the circle
   Iterator getRandomMaxPheromoneParticleInCircle(Circle const& circle);
+  // same as above, but the random draws come from random_engine instead of the
+  // Pheromones' own engine: since it doesn't modify the Pheromones it can be
+  // called concurrently by different threads, each with its own engine
+  Iterator getRandomMaxPheromoneParticleInCircle(
+      Circle const& circle, std::default_random_engine& random_engine) const;
+  // what sense() found in one circle
+  struct SensedPheromones
+  {
+    // chosen as by getRandomMaxPheromoneParticleInCircle(), empty if there
+    // were no pheromones in the circle
+    std::optional<PheromoneParticle> max_particle;
+    // of the pheromones in the circle, see sense()
+    double total_intensity;
+    std::size_t number_of_pheromones;
+  };
+  // the three circles of vision of an ant at once, without allocating. For
+  // the FIELD model the squares around them are visited in a single pass.
+  // Each circle returns early on its own as in
+  // getRandomMaxPheromoneParticleInCircle(), but with a single random draw
+  // each, so the particles chosen may differ from three separate calls.
+  // If count_all is true total_intensity and number_of_pheromones count all
+  // the pheromones in the circle. Otherwise the pheromones of a circle stop
+  // being looked at, and counted, when it returns early
+  std::array<SensedPheromones, 3> sense(std::array<Circle, 3> const& circles,
+                                        bool count_all = true);
+  // same as above, with the random draws from random_engine: it can be called
+  // concurrently by different threads, each with its own engine
+  std::array<SensedPheromones, 3>
+  sense(std::array<Circle, 3> const& circles,
+        std::default_random_engine& random_engine,
+        bool count_all = true) const;
   Pheromones::Type getPheromonesType() const;
+  // for the FIELD model, the number of squares with pheromones
   std::size_t getNumberOfPheromones() const;
+  // changes every time a particle is added and at every evaporation update,
+  // e.g. to know if the pheromones have to be drawn again
+  std::uint64_t getVersion() const;
+  // heap allocations made so far to store the particles, not counting the ones
+  // made by loadFromSnapshot(). It stops growing once as many particles are
+  // added as evaporate: the memory of the evaporated ones is reused
+  std::size_t getNumberOfAllocations() const;
   double getMinPheromoneIntensity() const;
   double getMaxPheromoneIntensity() const;
   // may throw std::invalid_argument if intensity is <= 0.
   void addPheromoneParticle(Vector2d const& position, double intensity);
   void addPheromoneParticle(PheromoneParticle const& particle);
   bool timeToEvaporate(double delta_t);
+  // every PERIOD_BETWEEN_EVAPORATION_UPDATE_ the intensity of the particles
+  // decreases and the ones that have evaporated disappear. Only a part of the
+  // squares is visited to free the memory of the evaporated particles
   // may throw std::invalid_argument if delta_t<0.
   void updateParticlesEvaporation(double delta_t = 0.01);
 
+  // better called before adding particles: the ones already present keep
+  // their current intensity but from now on evaporate at the new rate
   void optimizePath(bool optimize_path);
+  // overrides the evaporation rate chosen by optimizePath(): from now on every
+  // PERIOD_BETWEEN_EVAPORATION_UPDATE_ the particles lose this fraction of
+  // their intensity
+  // may throw std::invalid_argument if decrease_percentage_amount isn't in
+  // (0., 1.)
+  void setDecreasePercentageAmount(double decrease_percentage_amount);
+  double getDecreasePercentageAmount() const;
+
+  // all the particles, with the state of the evaporation and of the random
+  // engine
+  void saveToSnapshot(SnapshotWriter& snapshot) const;
+  // if it throws the pheromones are left as they were
+  // may throw std::runtime_error if the snapshot is badly formatted
+  void loadFromSnapshot(SnapshotReader& snapshot);
 
   // renders the pheromones into the supplied std::vector<sf::Vertex>
-  // pheromone_to_vertex_pos must be callable as a void function that takes a
-  // PheromoneParticle const& and a sf::Vector2f & and puts the
-  // PheromoneParticle position on the screen into the Vector2f
-  template<class PhToVertexPos>
+  // position_to_vertex_pos must be callable as a void function that takes a
+  // Vector2d const& (the position of a particle) and a sf::Vector2f & and puts
+  // the position on the screen into the Vector2f
+  // the squares are walked directly, without the copies made by Iterator
+  template<class PositionToVertexPos>
   void friend renderInto(std::vector<sf::Vertex>& vertices,
                          Pheromones const& pheromones,
-                         PhToVertexPos pheromone_to_vertex_pos,
+                         PositionToVertexPos position_to_vertex_pos,
                          sf::Color const& pheromone_color)
   {
     sf::Color color = pheromone_color;
-    double const max_pheromone_intensity{pheromones.getMaxPheromoneIntensity()};
+    double const alpha_multiplier{255.
+                                  / pheromones.getMaxPheromoneIntensity()};
 
     sf::Vector2f position;
-    for (auto const& square : pheromones.pheromones_squares_) {
-      for (auto const& pheromone_particle : square.second) {
-        color.a = static_cast<sf::Uint8>((pheromone_particle.getIntensity()
-                                          / max_pheromone_intensity * 255.));
-        pheromone_to_vertex_pos(pheromone_particle, position);
+    if (pheromones.model_ == Model::FIELD) {
+      for (std::size_t i{0}; i != pheromones.field_.size(); ++i) {
+        if (pheromones.field_[i] == 0.) {
+          continue;
+        }
+        // the particles added to the same square add up
+        color.a = static_cast<sf::Uint8>(
+            std::min(pheromones.field_[i] * alpha_multiplier, 255.));
+        position_to_vertex_pos(pheromones.getFieldSquareCenter(i), position);
+        vertices.emplace_back(position, color);
+      }
+      return;
+    }
+    for (auto const& square : pheromones.squares_) {
+      for (std::size_t i{0}; i != square.x.size(); ++i) {
+        if (pheromones.hasEvaporated(square, i)) {
+          continue;
+        }
+        color.a = static_cast<sf::Uint8>(pheromones.getIntensity(square, i)
+                                         * alpha_multiplier);
+        position_to_vertex_pos(Vector2d{square.x[i], square.y[i]}, position);
         vertices.emplace_back(position, color);
       }
     }
@@ -313,6 +654,61 @@ class Anthill
   bool loadFromFile(Obstacles const& obstacles,
                     std::string const& filepath = DEFAULT_FILEPATH_);
   bool saveToFile(std::string const& filepath = DEFAULT_FILEPATH_) const;
+
+  void saveToSnapshot(SnapshotWriter& snapshot) const;
+  // if it throws the anthill is left as it was
+  // may throw std::runtime_error if the snapshot is badly formatted
+  void loadFromSnapshot(SnapshotReader& snapshot);
+};
+
+// a coarse grid over the obstacles, the food and the anthill: every cell tells
+// which of them may be within reach of the points inside it, so that an ant
+// far from all of them skips their checks with a single lookup. Once built
+// it's only read, so the threads updating the ants can share it
+class SensingGrid
+{
+  inline static std::size_t const MAX_CELLS_{1u << 20};
+
+  // bottom left corner of the grid
+  Vector2d origin_;
+  double cell_size_;
+  std::size_t width_;  // number of columns
+  std::size_t height_; // number of rows
+  // what may be near the points of the cell (row * width_ + column)
+  std::vector<std::uint8_t> cells_;
+  // what the grid was built from, see isBuiltFrom()
+  double reach_;
+  std::uint64_t obstacles_version_;
+  Food const* food_;
+  std::uint64_t food_circles_version_;
+  Anthill const* anthill_;
+  Circle anthill_circle_;
+
+  // flags with nearby the cells within reach_ of the box
+  void markBox(Vector2d const& bottom_left, Vector2d const& top_right,
+               std::uint8_t nearby);
+
+ public:
+  // bits of the values returned by getNearby()
+  inline static std::uint8_t const NOTHING_{0};
+  inline static std::uint8_t const OBSTACLES_{1};
+  inline static std::uint8_t const FOOD_{2};
+  inline static std::uint8_t const ANTHILL_{4};
+  inline static std::uint8_t const ANYTHING_{OBSTACLES_ | FOOD_ | ANTHILL_};
+
+  // an empty grid: nothing is near any point
+  SensingGrid();
+  // may throw std::invalid_argument if reach <= 0.
+  void build(Obstacles const& obstacles, Food const& food,
+             Anthill const& anthill, double reach);
+  // returns true if the grid was built from these objects, with the same
+  // obstacles, circles with food and anthill they have now, and from reach.
+  // The obstacles are compared by their version
+  bool isBuiltFrom(Obstacles const& obstacles, Food const& food,
+                   Anthill const& anthill, double reach) const;
+  // what may intersect the circle of radius reach around position: if a bit
+  // isn't set, nothing of its kind does
+  std::uint8_t getNearby(Vector2d const& position) const;
 };
 } // namespace kape
 
@@ -1,6 +1,15 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "environment.hpp"
 #include "doctest.h"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
 
 TEST_CASE("Testing Obstacles class")
 {
@@ -25,6 +34,69 @@ TEST_CASE("Testing Obstacles class")
     CHECK(obstacles.anyObstaclesInCircle(c2) == true);
     CHECK(obstacles.anyObstaclesInCircle(c3) == true);
     CHECK(obstacles.anyObstaclesInCircle(c4) == true);
+    // outside of the grid
+    CHECK(obstacles.anyObstaclesInCircle(
+              kape::Circle{kape::Vector2d{100., -100.}, 1.})
+          == false);
+    CHECK(kape::Obstacles{}.anyObstaclesInCircle(c2) == false);
+  }
+  SUBCASE("Testing anyObstaclesInCircles function")
+  {
+    std::array<kape::Circle, 3> circles{
+        kape::Circle{kape::Vector2d{1., 0.}, 0.5},
+        kape::Circle{kape::Vector2d{3.5, 1.5}, 1.},
+        kape::Circle{kape::Vector2d{3.5, -3.}, 0.5}};
+    std::array<bool, 3> any_obstacles{obstacles.anyObstaclesInCircles(circles)};
+    CHECK(any_obstacles[0] == false);
+    CHECK(any_obstacles[1] == true);
+    CHECK(any_obstacles[2] == true);
+  }
+  SUBCASE("Testing the grid against a linear search")
+  {
+    std::default_random_engine engine{5u};
+    std::uniform_real_distribution<double> position{-10., 10.};
+    std::uniform_real_distribution<double> size{0.01, 2.};
+    std::uniform_real_distribution<double> radius{0.001, 0.5};
+
+    kape::Obstacles many_obstacles;
+    for (int i{0}; i != 300; ++i) {
+      many_obstacles.addObstacle(
+          kape::Vector2d{position(engine), position(engine)}, size(engine),
+          size(engine));
+    }
+
+    int mismatches{0};
+    for (int i{0}; i != 2000; ++i) {
+      std::array<kape::Circle, 3> circles;
+      for (auto& circle : circles) {
+        circle = kape::Circle{
+            kape::Vector2d{1.2 * position(engine), 1.2 * position(engine)},
+            radius(engine)};
+      }
+      std::array<bool, 3> const batched{
+          many_obstacles.anyObstaclesInCircles(circles)};
+      for (std::size_t c{0}; c != circles.size(); ++c) {
+        bool const expected{std::any_of(
+            many_obstacles.begin(), many_obstacles.end(),
+            [&](kape::Rectangle const& obstacle) {
+              return kape::doShapesIntersect(circles[c], obstacle);
+            })};
+        if (many_obstacles.anyObstaclesInCircle(circles[c]) != expected
+            || batched[c] != expected) {
+          ++mismatches;
+        }
+      }
+    }
+    CHECK(mismatches == 0);
+  }
+  SUBCASE("Testing getBoundingBox function")
+  {
+    kape::Rectangle box{obstacles.getBoundingBox()};
+    CHECK(box.getRectangleTopLeftCorner().x == doctest::Approx(-3.));
+    CHECK(box.getRectangleTopLeftCorner().y == doctest::Approx(3.));
+    CHECK(box.getRectangleWidth() == doctest::Approx(8.));
+    CHECK(box.getRectangleHeight() == doctest::Approx(6.));
+    CHECK_THROWS(kape::Obstacles{}.getBoundingBox());
   }
   SUBCASE("Testing const iterators begin && end")
   {
@@ -184,6 +256,17 @@ TEST_CASE("Testing Food class")
     }
     CHECK(food.isThereFoodLeft() == false);
   }
+  SUBCASE("Testing getVersion function")
+  {
+    auto const version{food.getVersion()};
+    CHECK(food.removeOneFoodParticleInCircle(
+              kape::Circle{kape::Vector2d{10., 10.}, 0.1})
+          == false);
+    CHECK(food.getVersion() == version);
+    food.removeOneFoodParticleInCircle(
+        kape::Circle{kape::Vector2d{1., -1.}, 1.});
+    CHECK(food.getVersion() != version);
+  }
   SUBCASE("Testing const iterators begin && end")
   {
     int number_of_food_particles{0};
@@ -200,6 +283,48 @@ TEST_CASE("Testing Food class")
     }
     CHECK(number_of_food_particles == 173);
   }
+  SUBCASE("Testing isNearFood function")
+  {
+    CHECK(food.isNearFood(kape::Circle{kape::Vector2d{1., -1.}, 0.1}));
+    CHECK(food.isNearFood(kape::Circle{kape::Vector2d{2.5, -1.}, 0.6}));
+    CHECK_FALSE(food.isNearFood(kape::Circle{kape::Vector2d{3., -1.}, 0.5}));
+    CHECK_FALSE(food.isNearFood(kape::Circle{kape::Vector2d{10., 10.}, 1.}));
+    while (food.removeOneFoodParticleInCircle(
+        kape::Circle{kape::Vector2d{1., -1.}, 1.})) {
+    }
+    CHECK_FALSE(food.isNearFood(kape::Circle{kape::Vector2d{1., -1.}, 0.1}));
+  }
+  SUBCASE("Testing removals against a linear search")
+  {
+    food.generateFoodInCircle(kape::Circle{kape::Vector2d{-6., -6.}, 0.5},
+                              2000, obstacles);
+    std::default_random_engine engine{3u};
+    std::uniform_real_distribution<double> coordinate{-6.6, -5.4};
+
+    int mismatches{0};
+    for (int i{0}; i != 3000; ++i) {
+      kape::Circle const circle{
+          kape::Vector2d{coordinate(engine), coordinate(engine)}, 0.05};
+      bool expected{false};
+      for (auto food_it = food.begin(), food_end = food.end();
+           food_it != food_end; ++food_it) {
+        expected = expected || circle.isInside((*food_it).getPosition());
+      }
+      if (food.isThereFoodInCircle(circle) != expected
+          || food.removeOneFoodParticleInCircle(circle) != expected) {
+        ++mismatches;
+      }
+    }
+    CHECK(mismatches == 0);
+
+    std::size_t number_of_food_particles{0};
+    for (auto food_it = food.begin(), food_end = food.end();
+         food_it != food_end; ++food_it) {
+      ++number_of_food_particles;
+    }
+    CHECK(number_of_food_particles == food.getNumberOfFoodParticles());
+    CHECK(food.getNumberOfFoodParticles() < 2050);
+  }
 }
 
 TEST_CASE("Testing Iterator class")
@@ -406,6 +531,367 @@ TEST_CASE("Testing Pheromones class")
   }
 }
 
+TEST_CASE("Testing bounded Pheromones class")
+{
+  kape::Rectangle bounds{kape::Vector2d{-1., 12.}, 12., 13.};
+  kape::Pheromones ph_bounded(kape::Pheromones::Type::TO_ANTHILL, 1., bounds);
+  kape::Pheromones ph_unbounded(kape::Pheromones::Type::TO_ANTHILL, 1.);
+  ph_bounded.optimizePath(false);
+  ph_unbounded.optimizePath(false);
+  for (double d{0.}; d != 10.; ++d) {
+    ph_bounded.addPheromoneParticle(kape::Vector2d{d, d}, 10. + d);
+    ph_unbounded.addPheromoneParticle(kape::Vector2d{d, d}, 10. + d);
+  }
+
+  SUBCASE("Testing isBounded function")
+  {
+    CHECK(ph_bounded.isBounded() == true);
+    CHECK(ph_unbounded.isBounded() == false);
+  }
+  SUBCASE("Testing the queries give the same results as the unbounded ones")
+  {
+    CHECK(ph_bounded.getNumberOfPheromones() == 10);
+    for (double d{-2.}; d < 12.; d += 0.5) {
+      kape::Circle circle{kape::Vector2d{d, d + 0.3}, 1.5};
+      CHECK(ph_bounded.getPheromonesIntensityInCircle(circle)
+            == ph_unbounded.getPheromonesIntensityInCircle(circle));
+    }
+    auto max_particle{ph_bounded.getRandomMaxPheromoneParticleInCircle(
+        kape::Circle{kape::Vector2d{3., 2.}, 1.5})};
+    REQUIRE(max_particle != ph_bounded.end());
+    CHECK(max_particle->getIntensity() == 13.);
+    CHECK(max_particle->getPosition().x == 3.);
+    CHECK(ph_bounded.getRandomMaxPheromoneParticleInCircle(
+              kape::Circle{kape::Vector2d{10., 4.}, 2.5})
+          == ph_bounded.end());
+  }
+  SUBCASE("Testing sense function")
+  {
+    for (double d{-2.}; d < 12.; d += 0.5) {
+      std::array<kape::Circle, 3> const circles{
+          kape::Circle{kape::Vector2d{d, d + 0.3}, 1.5},
+          kape::Circle{kape::Vector2d{d + 1., d}, 1.},
+          kape::Circle{kape::Vector2d{d - 2., d + 1.}, 2.}};
+      for (auto* pheromones : {&ph_bounded, &ph_unbounded}) {
+        auto const sensed{pheromones->sense(circles)};
+        for (std::size_t c{0}; c != 3; ++c) {
+          CHECK(sensed[c].total_intensity
+                == doctest::Approx(
+                    pheromones->getPheromonesIntensityInCircle(circles[c])));
+          CHECK(sensed[c].max_particle.has_value()
+                == (sensed[c].number_of_pheromones != 0));
+          if (sensed[c].max_particle.has_value()) {
+            CHECK(circles[c].isInside(sensed[c].max_particle->getPosition()));
+          }
+        }
+      }
+    }
+    auto const sensed{ph_bounded.sense(
+        {kape::Circle{kape::Vector2d{3., 2.}, 1.5},
+         kape::Circle{kape::Vector2d{10., 4.}, 2.5},
+         kape::Circle{kape::Vector2d{4.5, 4.5}, 1.}})};
+    REQUIRE(sensed[0].max_particle.has_value());
+    CHECK(sensed[0].max_particle->getIntensity() == 13.);
+    CHECK(sensed[0].number_of_pheromones == 2);
+    CHECK(sensed[0].total_intensity == 25.);
+    CHECK(sensed[1].max_particle.has_value() == false);
+    CHECK(sensed[1].total_intensity == 0.);
+    CHECK(sensed[2].number_of_pheromones == 2);
+    REQUIRE(sensed[2].max_particle.has_value());
+    CHECK(sensed[2].max_particle->getIntensity() == 15.);
+  }
+  SUBCASE("Testing particles outside of the bounds")
+  {
+    ph_bounded.addPheromoneParticle(kape::Vector2d{-30., 5.}, 100.);
+    ph_bounded.addPheromoneParticle(kape::Vector2d{40., 40.}, 50.);
+    CHECK(ph_bounded.getNumberOfPheromones() == 12);
+    CHECK(ph_bounded.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{-30., 5.5}, 1.})
+          == 100.);
+    CHECK(ph_bounded.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{40., 39.}, 1.5})
+          == 50.);
+  }
+  SUBCASE("Testing updateParticlesEvaporation function")
+  {
+    ph_bounded.addPheromoneParticle(kape::Vector2d{5., 5.}, 0.505);
+    ph_bounded.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    CHECK(ph_bounded.getNumberOfPheromones() == 10);
+    CHECK(ph_bounded.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{5., 5.}, 0.5})
+          == doctest::Approx(15. * (1 - 0.01)));
+  }
+  SUBCASE("Testing getVersion function")
+  {
+    auto const version{ph_bounded.getVersion()};
+    ph_bounded.updateParticlesEvaporation(0.);
+    CHECK(ph_bounded.getVersion() == version);
+    ph_bounded.addPheromoneParticle(kape::Vector2d{5., 5.}, 1.);
+    auto const version_after_adding{ph_bounded.getVersion()};
+    CHECK(version_after_adding != version);
+    ph_bounded.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    CHECK(ph_bounded.getVersion() != version_after_adding);
+  }
+  SUBCASE("Testing renderInto function")
+  {
+    ph_bounded.addPheromoneParticle(kape::Vector2d{5., 5.}, 0.505);
+    ph_bounded.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    std::vector<sf::Vertex> vertices;
+    renderInto(
+        vertices, ph_bounded,
+        [](kape::Vector2d const& position, sf::Vector2f& vertex_position) {
+          vertex_position = sf::Vector2f{static_cast<float>(position.x),
+                                         static_cast<float>(position.y)};
+        },
+        sf::Color{10, 20, 30});
+    // the evaporated particle isn't drawn
+    REQUIRE(vertices.size() == ph_bounded.getNumberOfPheromones());
+    std::size_t i{0};
+    for (auto const& particle : ph_bounded) {
+      CHECK(vertices[i].position.x
+            == static_cast<float>(particle.getPosition().x));
+      CHECK(vertices[i].color.a
+            == static_cast<sf::Uint8>(particle.getIntensity() * 255.
+                                      / ph_bounded.getMaxPheromoneIntensity()));
+      ++i;
+    }
+  }
+  SUBCASE("Testing setDecreasePercentageAmount function")
+  {
+    CHECK(ph_bounded.getDecreasePercentageAmount() == doctest::Approx(0.01));
+    ph_bounded.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    ph_bounded.setDecreasePercentageAmount(0.1);
+    CHECK(ph_bounded.getDecreasePercentageAmount() == doctest::Approx(0.1));
+    ph_bounded.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    CHECK(ph_bounded.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{5., 5.}, 0.5})
+          == doctest::Approx(15. * (1 - 0.01) * (1 - 0.1)));
+    CHECK_THROWS(ph_bounded.setDecreasePercentageAmount(0.));
+    CHECK_THROWS(ph_bounded.setDecreasePercentageAmount(1.));
+  }
+  SUBCASE("Testing const iterators begin && end")
+  {
+    int number_of_pheromones{0};
+    double total_intensity{0.};
+    for (auto it = ph_bounded.begin(), end = ph_bounded.end(); it != end;
+         ++it) {
+      ++number_of_pheromones;
+      total_intensity += it->getIntensity();
+    }
+    CHECK(number_of_pheromones == 10);
+    CHECK(total_intensity == 145.);
+  }
+}
+
+TEST_CASE("Testing the evaporation of the pheromones over many updates")
+{
+  for (bool optimize_path : {false, true}) {
+    CAPTURE(optimize_path);
+    kape::Rectangle bounds{kape::Vector2d{0., 4.}, 4., 4.};
+    kape::Pheromones pheromones{kape::Pheromones::Type::TO_FOOD, 0.25, bounds};
+    pheromones.optimizePath(optimize_path);
+    double const multiplier{
+        1.
+        - (optimize_path
+               ? kape::Pheromones::DECREASE_PERCENTAGE_AMOUNT_OPTIMIZATION_
+               : kape::Pheromones::DECREASE_PERCENTAGE_AMOUNT_MAP_)};
+
+    // the same particles evaporated one update at a time
+    std::vector<double> intensities;
+    for (int tick{0}; tick != 600; ++tick) {
+      if (tick % 7 == 0) {
+        kape::Vector2d const position{0.1 + (tick % 37) * 0.1,
+                                      0.1 + (tick % 23) * 0.15};
+        double const intensity{5. + tick % 11};
+        pheromones.addPheromoneParticle(position, intensity);
+        intensities.push_back(intensity);
+      }
+
+      pheromones.updateParticlesEvaporation(
+          kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+      std::size_t kept{0};
+      for (std::size_t i{0}; i != intensities.size(); ++i) {
+        intensities[i] *= multiplier;
+        if (intensities[i] > kape::Pheromones::MIN_PHEROMONE_INTENSITY_MAP_) {
+          intensities[kept] = intensities[i];
+          ++kept;
+        }
+      }
+      intensities.resize(kept);
+
+      REQUIRE(pheromones.getNumberOfPheromones() == intensities.size());
+    }
+
+    REQUIRE(!intensities.empty());
+    double total_intensity{0.};
+    std::size_t number_of_pheromones{0};
+    for (auto const& particle : pheromones) {
+      total_intensity += particle.getIntensity();
+      ++number_of_pheromones;
+    }
+    CHECK(number_of_pheromones == intensities.size());
+    CHECK(total_intensity
+          == doctest::Approx(std::accumulate(intensities.begin(),
+                                             intensities.end(), 0.)));
+    CHECK(pheromones.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{2., 2.}, 10.})
+          == doctest::Approx(total_intensity));
+  }
+}
+
+TEST_CASE("Testing the pheromones reuse their memory once the trails formed")
+{
+  kape::Rectangle bounds{kape::Vector2d{-10., 10.}, 70., 20.};
+  kape::Pheromones ph_bounded{kape::Pheromones::Type::TO_FOOD, 1., bounds};
+  kape::Pheromones ph_unbounded{kape::Pheromones::Type::TO_FOOD, 1.};
+
+  // an ant walking around one of two loops, switching loop every 400 updates:
+  // by then the trail around the other loop has faded
+  auto const update{[](kape::Pheromones& pheromones, int tick) {
+    double const angle{2. * kape::PI * (tick % 250) / 250.};
+    double const center_x{(tick / 400) % 2 == 0 ? 0. : 50.};
+    pheromones.addPheromoneParticle(
+        kape::Vector2d{center_x + 5. * std::cos(angle), 5. * std::sin(angle)},
+        10.);
+    pheromones.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+  }};
+
+  for (kape::Pheromones* pheromones : {&ph_bounded, &ph_unbounded}) {
+    CAPTURE(pheromones->isBounded());
+    int tick{0};
+    for (; tick != 1600; ++tick) {
+      update(*pheromones, tick);
+    }
+    std::size_t const number_of_allocations{
+        pheromones->getNumberOfAllocations()};
+    CHECK(number_of_allocations > 0);
+
+    for (; tick != 4800; ++tick) {
+      update(*pheromones, tick);
+    }
+    CHECK(pheromones->getNumberOfAllocations() == number_of_allocations);
+    CHECK(pheromones->getNumberOfPheromones() > 0);
+  }
+}
+
+TEST_CASE("Testing the FIELD model of the pheromones")
+{
+  // squares of 0.25, the particles below are in the ones with their center at
+  // (1.125, 1.125) and (2.125, 2.125)
+  kape::Rectangle const bounds{kape::Vector2d{0., 4.}, 4., 4.};
+  kape::Pheromones field{kape::Pheromones::Type::TO_FOOD, 1., bounds,
+                         kape::Pheromones::Model::FIELD};
+  field.addPheromoneParticle(kape::Vector2d{1.01, 1.01}, 10.);
+  field.addPheromoneParticle(kape::Vector2d{1.2, 1.2}, 5.);
+  field.addPheromoneParticle(kape::Vector2d{2.1, 2.1}, 20.);
+
+  SUBCASE("Testing getModel and setDiffusionRate functions")
+  {
+    kape::Pheromones particles{kape::Pheromones::Type::TO_FOOD, 1., bounds};
+    CHECK(field.getModel() == kape::Pheromones::Model::FIELD);
+    CHECK(particles.getModel() == kape::Pheromones::Model::PARTICLES);
+    CHECK(field.isBounded() == true);
+    CHECK_THROWS_AS(particles.setDiffusionRate(0.1), std::invalid_argument);
+    CHECK_THROWS_AS(field.setDiffusionRate(1.), std::invalid_argument);
+    CHECK_THROWS_AS(field.setDiffusionRate(-0.1), std::invalid_argument);
+    field.setDiffusionRate(0.1);
+    CHECK(field.getDiffusionRate() == 0.1);
+  }
+  SUBCASE("Testing the particles in the same square add up")
+  {
+    CHECK(field.getNumberOfPheromones() == 2);
+    CHECK(field.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{1.1, 1.1}, 0.3})
+          == doctest::Approx(15.));
+
+    auto max_particle{field.getRandomMaxPheromoneParticleInCircle(
+        kape::Circle{kape::Vector2d{1.5, 1.5}, 1.})};
+    REQUIRE(max_particle != field.end());
+    CHECK(max_particle->getIntensity() == doctest::Approx(20.));
+    // the center of the square
+    CHECK(max_particle->getPosition().x == doctest::Approx(2.125));
+    CHECK(max_particle->getPosition().y == doctest::Approx(2.125));
+    CHECK(field.getRandomMaxPheromoneParticleInCircle(
+              kape::Circle{kape::Vector2d{3.5, 0.5}, 0.4})
+          == field.end());
+
+    double total_intensity{0.};
+    std::size_t number_of_pheromones{0};
+    for (auto const& particle : field) {
+      total_intensity += particle.getIntensity();
+      ++number_of_pheromones;
+    }
+    CHECK(number_of_pheromones == 2);
+    CHECK(total_intensity == doctest::Approx(35.));
+
+    auto const sensed{
+        field.sense({kape::Circle{kape::Vector2d{1.1, 1.1}, 0.3},
+                     kape::Circle{kape::Vector2d{1.5, 1.5}, 1.},
+                     kape::Circle{kape::Vector2d{3.5, 0.5}, 0.4}})};
+    CHECK(sensed[0].total_intensity == doctest::Approx(15.));
+    CHECK(sensed[0].number_of_pheromones == 1);
+    REQUIRE(sensed[1].max_particle.has_value());
+    CHECK(sensed[1].max_particle->getIntensity() == doctest::Approx(20.));
+    CHECK(sensed[1].max_particle->getPosition().x == doctest::Approx(2.125));
+    CHECK(sensed[1].total_intensity == doctest::Approx(35.));
+    CHECK(sensed[2].max_particle.has_value() == false);
+  }
+  SUBCASE("Testing the evaporation and the diffusion")
+  {
+    field.addPheromoneParticle(kape::Vector2d{3.9, 0.1}, 0.505);
+    CHECK(field.getNumberOfPheromones() == 3);
+    field.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    CHECK(field.getNumberOfPheromones() == 2);
+    CHECK(field.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{2., 2.}, 3.})
+          == doctest::Approx(35. * (1. - 0.01)));
+
+    // the intensity spreads to the 4 neighbours, without being lost
+    field.setDiffusionRate(0.2);
+    field.updateParticlesEvaporation(
+        kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    CHECK(field.getNumberOfPheromones() == 10);
+    CHECK(field.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{2., 2.}, 3.})
+          == doctest::Approx(35. * (1. - 0.01) * (1. - 0.01)));
+    CHECK(field.getPheromonesIntensityInCircle(
+              kape::Circle{kape::Vector2d{2.125, 2.375}, 0.1})
+          == doctest::Approx(20. * 0.99 * 0.05 * 0.99));
+  }
+  SUBCASE("Testing saveToSnapshot and loadFromSnapshot functions")
+  {
+    field.setDiffusionRate(0.1);
+    kape::SnapshotWriter writer;
+    field.saveToSnapshot(writer);
+    std::vector<char> const bytes{writer.releaseBuffer()};
+    kape::SnapshotReader reader{bytes};
+    kape::Pheromones loaded{kape::Pheromones::Type::TO_FOOD, 1.};
+    loaded.loadFromSnapshot(reader);
+    CHECK(reader.isAtEnd());
+
+    CHECK(loaded.getModel() == kape::Pheromones::Model::FIELD);
+    CHECK(loaded.getDiffusionRate() == 0.1);
+    for (int tick{0}; tick != 50; ++tick) {
+      REQUIRE(loaded.getNumberOfPheromones() == field.getNumberOfPheromones());
+      kape::Circle const circle{
+          kape::Vector2d{(tick % 40) * 0.1, (tick % 40) * 0.1}, 0.5};
+      CHECK(loaded.getPheromonesIntensityInCircle(circle)
+            == field.getPheromonesIntensityInCircle(circle));
+      loaded.updateParticlesEvaporation(
+          kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+      field.updateParticlesEvaporation(
+          kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+    }
+  }
+}
+
 TEST_CASE("Testing Anthill class")
 {
   kape::Anthill anthill1{};
@@ -458,4 +944,218 @@ TEST_CASE("Testing Anthill class")
     CHECK_THROWS(anthill1.addFood(-1));
     CHECK_THROWS(anthill2.addFood(-8));
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Testing SensingGrid class")
+{
+  kape::Obstacles obstacles;
+  obstacles.addObstacle(kape::Vector2d{-1., 1.}, 0.05, 2.);
+  obstacles.addObstacle(kape::Vector2d{0.5, -0.5}, 1., 0.05);
+  kape::Food food;
+  food.generateFoodInCircle(kape::Circle{kape::Vector2d{1., 0.5}, 0.1}, 10,
+                            obstacles);
+  food.generateFoodInCircle(kape::Circle{kape::Vector2d{-0.5, -0.7}, 0.2},
+                            100, obstacles);
+  kape::Anthill anthill{kape::Vector2d{0., 0.}, 0.1};
+  double const reach{0.07};
+  kape::SensingGrid grid;
+  CHECK(grid.getNearby(kape::Vector2d{0., 0.}) == kape::SensingGrid::NOTHING_);
+  CHECK_THROWS_AS(grid.build(obstacles, food, anthill, 0.),
+                  std::invalid_argument);
+  grid.build(obstacles, food, anthill, reach);
+
+  SUBCASE("Testing getNearby function against the exact checks")
+  {
+    std::default_random_engine engine{5u};
+    std::uniform_real_distribution<double> coordinate{-1.5, 1.5};
+    int missed{0};
+    int nothing_nearby{0};
+    for (int i{0}; i != 20000; ++i) {
+      kape::Vector2d const position{coordinate(engine), coordinate(engine)};
+      kape::Circle const circle{position, reach};
+      std::uint8_t const nearby{grid.getNearby(position)};
+      if ((obstacles.anyObstaclesInCircle(circle)
+           && (nearby & kape::SensingGrid::OBSTACLES_) == 0)
+          || (food.isNearFood(circle)
+              && (nearby & kape::SensingGrid::FOOD_) == 0)
+          || (kape::doShapesIntersect(circle, anthill.getCircle())
+              && (nearby & kape::SensingGrid::ANTHILL_) == 0)) {
+        ++missed;
+      }
+      if (nearby == kape::SensingGrid::NOTHING_) {
+        ++nothing_nearby;
+      }
+    }
+    CHECK(missed == 0);
+    // most of the area is far from everything
+    CHECK(nothing_nearby > 10000);
+    CHECK(grid.getNearby(kape::Vector2d{0., 0.})
+          == kape::SensingGrid::ANTHILL_);
+    CHECK(grid.getNearby(kape::Vector2d{10., 10.})
+          == kape::SensingGrid::NOTHING_);
+  }
+  SUBCASE("Testing isBuiltFrom function")
+  {
+    CHECK(grid.isBuiltFrom(obstacles, food, anthill, reach));
+    CHECK_FALSE(grid.isBuiltFrom(obstacles, food, anthill, 2. * reach));
+    kape::Anthill const other_anthill{kape::Vector2d{0., 0.}, 0.1};
+    CHECK_FALSE(grid.isBuiltFrom(obstacles, food, other_anthill, reach));
+
+    // taking a particle from a circle with food doesn't change the grid...
+    kape::Circle const small_circle{kape::Vector2d{1., 0.5}, 0.1};
+    REQUIRE(food.removeOneFoodParticleInCircle(small_circle));
+    CHECK(grid.isBuiltFrom(obstacles, food, anthill, reach));
+    // ...emptying it does
+    while (food.removeOneFoodParticleInCircle(small_circle)) {
+    }
+    CHECK_FALSE(grid.isBuiltFrom(obstacles, food, anthill, reach));
+    CHECK((grid.getNearby(kape::Vector2d{1., 0.5})
+           & kape::SensingGrid::FOOD_)
+          != 0);
+    grid.build(obstacles, food, anthill, reach);
+    CHECK(grid.isBuiltFrom(obstacles, food, anthill, reach));
+    CHECK(grid.getNearby(kape::Vector2d{1., 0.5})
+          == kape::SensingGrid::NOTHING_);
+
+    obstacles.addObstacle(kape::Vector2d{1., 1.}, 0.1, 0.1);
+    CHECK_FALSE(grid.isBuiltFrom(obstacles, food, anthill, reach));
+  }
+  SUBCASE("Testing isBuiltFrom function with the obstacles reloaded in place")
+  {
+    kape::Vector2d const near_old_obstacle{-0.975, 0.};
+    REQUIRE((grid.getNearby(near_old_obstacle) & kape::SensingGrid::OBSTACLES_)
+            != 0);
+    // same address and same number of obstacles, as when a snapshot is loaded
+    obstacles = kape::Obstacles{};
+    obstacles.addObstacle(kape::Vector2d{1.2, 1.4}, 0.05, 0.05);
+    obstacles.addObstacle(kape::Vector2d{1.3, -1.2}, 0.05, 0.05);
+    REQUIRE(obstacles.getNumberOfObstacles() == 2);
+    CHECK_FALSE(grid.isBuiltFrom(obstacles, food, anthill, reach));
+    grid.build(obstacles, food, anthill, reach);
+    CHECK(grid.isBuiltFrom(obstacles, food, anthill, reach));
+    CHECK(grid.getNearby(near_old_obstacle) == kape::SensingGrid::NOTHING_);
+  }
+}
+
+TEST_CASE("Testing the snapshots of the environment")
+{
+  SUBCASE("Testing Pheromones saveToSnapshot and loadFromSnapshot functions")
+  {
+    for (bool bounded : {false, true}) {
+      CAPTURE(bounded);
+      kape::Rectangle const bounds{kape::Vector2d{0., 4.}, 4., 4.};
+      kape::Pheromones pheromones{
+          bounded ? kape::Pheromones{kape::Pheromones::Type::TO_FOOD, 0.25,
+                                     bounds}
+                  : kape::Pheromones{kape::Pheromones::Type::TO_FOOD, 0.25}};
+      for (int tick{0}; tick != 300; ++tick) {
+        pheromones.addPheromoneParticle(
+            kape::Vector2d{0.1 + (tick % 37) * 0.1, 0.1 + (tick % 23) * 0.15},
+            5. + tick % 11);
+        pheromones.updateParticlesEvaporation(
+            kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+      }
+
+      kape::SnapshotWriter writer;
+      pheromones.saveToSnapshot(writer);
+      std::vector<char> const bytes{writer.releaseBuffer()};
+      kape::SnapshotReader wrong_type_reader{bytes};
+      kape::Pheromones wrong_type{kape::Pheromones::Type::TO_ANTHILL, 1.};
+      CHECK_THROWS_AS(wrong_type.loadFromSnapshot(wrong_type_reader),
+                      std::runtime_error);
+
+      kape::SnapshotReader reader{bytes};
+      kape::Pheromones loaded{kape::Pheromones::Type::TO_FOOD, 1.};
+      loaded.loadFromSnapshot(reader);
+      CHECK(reader.isAtEnd());
+
+      CHECK(loaded.isBounded() == bounded);
+      // both evolve the same way after being loaded
+      for (int tick{0}; tick != 200; ++tick) {
+        REQUIRE(loaded.getNumberOfPheromones()
+                == pheromones.getNumberOfPheromones());
+        kape::Circle const circle{
+            kape::Vector2d{(tick % 40) * 0.1, (tick % 40) * 0.1}, 0.5};
+        CHECK(loaded.getPheromonesIntensityInCircle(circle)
+              == pheromones.getPheromonesIntensityInCircle(circle));
+        loaded.updateParticlesEvaporation(
+            kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+        pheromones.updateParticlesEvaporation(
+            kape::Pheromones::PERIOD_BETWEEN_EVAPORATION_UPDATE_);
+      }
+    }
+  }
+
+  SUBCASE("Testing Food saveToSnapshot and loadFromSnapshot functions")
+  {
+    kape::Obstacles obstacles;
+    kape::Food food{3u};
+    kape::Circle const circle{kape::Vector2d{1., 1.}, 0.5};
+    food.generateFoodInCircle(circle, 100, obstacles);
+    food.removeOneFoodParticleInCircle(
+        kape::Circle{kape::Vector2d{1., 1.}, 0.2});
+
+    kape::SnapshotWriter writer;
+    food.saveToSnapshot(writer);
+    std::vector<char> const bytes{writer.releaseBuffer()};
+    kape::SnapshotReader reader{bytes};
+    kape::Food loaded{};
+    loaded.loadFromSnapshot(reader);
+    CHECK(reader.isAtEnd());
+
+    REQUIRE(loaded.getNumberOfFoodParticles() == 99);
+    CHECK(std::equal(food.begin(), food.end(), loaded.begin(),
+                     [](kape::FoodParticle const& lhs,
+                        kape::FoodParticle const& rhs) {
+                       return lhs.getPosition().x == rhs.getPosition().x
+                           && lhs.getPosition().y == rhs.getPosition().y;
+                     }));
+    // the random engine is restored too
+    food.generateFoodInCircle(circle, 10, obstacles);
+    loaded.generateFoodInCircle(circle, 10, obstacles);
+    CHECK(std::equal(food.begin(), food.end(), loaded.begin(),
+                     [](kape::FoodParticle const& lhs,
+                        kape::FoodParticle const& rhs) {
+                       return lhs.getPosition().x == rhs.getPosition().x
+                           && lhs.getPosition().y == rhs.getPosition().y;
+                     }));
+  }
+
+  SUBCASE("Testing Anthill saveToSnapshot and loadFromSnapshot functions")
+  {
+    kape::Anthill anthill{kape::Vector2d{10.5, 3.4}, 2.5, 5};
+    kape::SnapshotWriter writer;
+    anthill.saveToSnapshot(writer);
+    std::vector<char> const bytes{writer.releaseBuffer()};
+    kape::SnapshotReader reader{bytes};
+    kape::Anthill loaded{};
+    loaded.loadFromSnapshot(reader);
+    CHECK(reader.isAtEnd());
+    CHECK(loaded.getCenter().x == doctest::Approx(10.5));
+    CHECK(loaded.getCenter().y == doctest::Approx(3.4));
+    CHECK(loaded.getRadius() == doctest::Approx(2.5));
+    CHECK(loaded.getFoodCounter() == 5);
+  }
+
+  SUBCASE("Testing badly formatted snapshots")
+  {
+    kape::SnapshotWriter writer;
+    kape::writeSnapshotHeader(writer);
+    kape::Anthill{kape::Vector2d{1., 1.}, 0.5, 3}.saveToSnapshot(writer);
+    std::vector<char> bytes{writer.releaseBuffer()};
+
+    std::vector<char> const truncated(bytes.begin(), bytes.end() - 1);
+    kape::SnapshotReader truncated_reader{truncated};
+    kape::readSnapshotHeader(truncated_reader);
+    kape::Anthill anthill{};
+    CHECK_THROWS_AS(anthill.loadFromSnapshot(truncated_reader),
+                    std::runtime_error);
+    // left as it was
+    CHECK(anthill.getFoodCounter() == 0);
+
+    bytes[0] = 'X';
+    kape::SnapshotReader wrong_magic_reader{bytes};
+    CHECK_THROWS_AS(kape::readSnapshotHeader(wrong_magic_reader),
+                    std::runtime_error);
+  }
+}
@@ -1,6 +1,14 @@
 #ifndef GEOMETRY_HPP
 #define GEOMETRY_HPP
 
+#include <algorithm> // for std::clamp
+#include <cmath>     // for std::sqrt, std::sin, std::cos
+#include <stdexcept> // for std::domain_error
+
+// the functions called in the hot loops of the other translation units (the
+// operators, the norms, rotate, doShapesIntersect and the getters) are defined
+// here, inline, so that they can be inlined there
+
 namespace kape {
 
 double constexpr PI{3.1415926535897932};
@@ -10,39 +18,127 @@ struct Vector2d
   double x;
   double y;
 
-  explicit Vector2d(double x_input, double y_input);
+  constexpr explicit Vector2d(double x_input, double y_input)
+      : x{x_input}
+      , y{y_input}
+  {}
 
-  Vector2d& operator+=(Vector2d const& rhs);
-  Vector2d& operator-=(Vector2d const& rhs);
-  Vector2d& operator*=(double rhs);
+  constexpr Vector2d& operator+=(Vector2d const& rhs);
+  constexpr Vector2d& operator-=(Vector2d const& rhs);
+  constexpr Vector2d& operator*=(double rhs);
   // may throw a std::domain_error if rhs==0 (division by 0)
-  Vector2d& operator/=(double rhs);
+  constexpr Vector2d& operator/=(double rhs);
 };
 
 // dot product
-double operator*(Vector2d const& lhs, Vector2d const& rhs);
+constexpr double operator*(Vector2d const& lhs, Vector2d const& rhs)
+{
+  return lhs.x * rhs.x + lhs.y * rhs.y;
+}
+
 // scalar*vector
-Vector2d operator*(double lhs, Vector2d const& rhs);
+constexpr Vector2d operator*(double lhs, Vector2d const& rhs)
+{
+  return Vector2d{lhs * rhs.x, lhs * rhs.y};
+}
+
 // vector*scalar
-Vector2d operator*(Vector2d const& lhs, double rhs);
+constexpr Vector2d operator*(Vector2d const& lhs, double rhs)
+{
+  return Vector2d{lhs.x * rhs, lhs.y * rhs};
+}
+
 // vector/scalar.
 // may throw a std::domain_error if rhs==0 (division by 0)
-Vector2d operator/(Vector2d const& lhs, double rhs);
+constexpr Vector2d operator/(Vector2d const& lhs, double rhs)
+{
+  if (rhs == 0.) {
+    throw std::domain_error{"the denominator can't be 0"};
+  }
+  return (1. / rhs) * lhs;
+}
+
 // sum between two vectors
-Vector2d operator+(Vector2d const& lhs, Vector2d const& rhs);
+constexpr Vector2d operator+(Vector2d const& lhs, Vector2d const& rhs)
+{
+  return Vector2d{lhs.x + rhs.x, lhs.y + rhs.y};
+}
+
 // opposite of a vector
-Vector2d operator-(Vector2d const& rhs);
+constexpr Vector2d operator-(Vector2d const& rhs)
+{
+  return Vector2d{-rhs.x, -rhs.y};
+}
+
 // difference between two vectors
-Vector2d operator-(Vector2d const& lhs, Vector2d const& rhs);
+constexpr Vector2d operator-(Vector2d const& lhs, Vector2d const& rhs)
+{
+  return Vector2d{lhs.x - rhs.x, lhs.y - rhs.y};
+}
+
+constexpr Vector2d& Vector2d::operator+=(Vector2d const& rhs)
+{
+  x += rhs.x;
+  y += rhs.y;
+  return *this;
+}
+
+constexpr Vector2d& Vector2d::operator-=(Vector2d const& rhs)
+{
+  x -= rhs.x;
+  y -= rhs.y;
+  return *this;
+}
+
+constexpr Vector2d& Vector2d::operator*=(double rhs)
+{
+  x *= rhs;
+  y *= rhs;
+  return *this;
+}
+
+// may throw a std::domain_error if rhs==0 (division by 0)
+constexpr Vector2d& Vector2d::operator/=(double rhs)
+{
+  *this = *this / rhs;
+  return *this;
+}
 
 // returns the norm squared of a vector
-double norm2(Vector2d const& vec);
+constexpr double norm2(Vector2d const& vec)
+{
+  return vec.x * vec.x + vec.y * vec.y;
+}
 
 // returns the norm of a vector
-double norm(Vector2d const& vec);
+inline double norm(Vector2d const& vec)
+{
+  return std::sqrt(norm2(vec));
+}
+
+// returns vec / norm(vec) without checking the division: vec mustn't be null
+inline Vector2d normalize(Vector2d const& vec)
+{
+  return (1. / norm(vec)) * vec;
+}
 
 // rotate the vector by "angle" radians
-Vector2d rotate(Vector2d const& vec, double angle);
+inline Vector2d rotate(Vector2d const& vec, double angle)
+{
+  double const sin_angle{std::sin(angle)};
+  double const cos_angle{std::cos(angle)};
+  return Vector2d{vec.x * cos_angle - vec.y * sin_angle,
+                  vec.x * sin_angle + vec.y * cos_angle};
+}
+
+// rotate the vector by the angle whose sine and cosine are given, e.g. to
+// rotate many vectors by the same angle computing them only once
+constexpr Vector2d rotate(Vector2d const& vec, double sin_angle,
+                          double cos_angle)
+{
+  return Vector2d{vec.x * cos_angle - vec.y * sin_angle,
+                  vec.x * sin_angle + vec.y * cos_angle};
+}
 
 // return the angle of rotation in respect to the +x axis, in the range [-PI,
 // +PI] if vec == {0.,0.} instead of the angle it returns 0.
@@ -60,9 +156,19 @@ class Circle
   // may throw std::invalid_argument if radius <= 0
   explicit Circle(Vector2d const& center = Vector2d{0., 0.},
                   double radius          = 1.);
-  Vector2d const& getCircleCenter() const;
-  double getCircleRadius() const;
-  void setCircleCenter(Vector2d const& center);
+  Vector2d const& getCircleCenter() const
+  {
+    return center_;
+  }
+  double getCircleRadius() const
+  {
+    return radius_;
+  }
+  void setCircleCenter(Vector2d const& center)
+  {
+    center_ = center;
+  }
+  // may throw std::invalid_argument if radius <= 0
   void setCircleRadius(double radius);
   bool isInside(Vector2d const& position) const;
 };
@@ -77,18 +183,69 @@ class Rectangle
   // may throw std::invalid_argument if width or height <= 0
   explicit Rectangle(Vector2d const& top_left_corner, double width,
                      double height);
-  Vector2d const& getRectangleTopLeftCorner() const;
-  double getRectangleWidth() const;
-  double getRectangleHeight() const;
+  Vector2d const& getRectangleTopLeftCorner() const
+  {
+    return top_left_corner_;
+  }
+  double getRectangleWidth() const
+  {
+    return width_;
+  }
+  double getRectangleHeight() const
+  {
+    return height_;
+  }
   void setRectangleTopLeftCorner(Vector2d const& position);
 };
 
 // true: they intersect
 // false: they don't
-bool doShapesIntersect(Circle const& circle, Vector2d const& point);
-bool doShapesIntersect(Rectangle const& rectangle, Vector2d const& point);
-bool doShapesIntersect(Circle const& circle, Rectangle const& rectangle);
-bool doShapesIntersect(Circle const& circle1, Circle const& circle2);
+// the borders count as part of the shapes
+inline bool doShapesIntersect(Circle const& circle, Vector2d const& point)
+{
+  return norm2(circle.getCircleCenter() - point)
+      <= circle.getCircleRadius() * circle.getCircleRadius();
+}
+
+inline bool doShapesIntersect(Rectangle const& rectangle,
+                              Vector2d const& point)
+{
+  Vector2d const& tlc{rectangle.getRectangleTopLeftCorner()};
+  // & instead of &&: all the comparisons are done, without branches
+  return (point.x >= tlc.x) & (point.x <= tlc.x + rectangle.getRectangleWidth())
+       & (point.y <= tlc.y)
+       & (point.y >= tlc.y - rectangle.getRectangleHeight());
+}
+
+// the point of the rectangle closest to the center of the circle is found
+// clamping the center inside the rectangle: they intersect if it's inside the
+// circle. It's also the center itself if the circle is inside the rectangle
+inline bool doShapesIntersect(Circle const& circle, Rectangle const& rectangle)
+{
+  Vector2d const& center{circle.getCircleCenter()};
+  Vector2d const& tlc{rectangle.getRectangleTopLeftCorner()};
+  double const radius{circle.getCircleRadius()};
+  double const dx{
+      center.x
+      - std::clamp(center.x, tlc.x, tlc.x + rectangle.getRectangleWidth())};
+  double const dy{
+      center.y
+      - std::clamp(center.y, tlc.y - rectangle.getRectangleHeight(), tlc.y)};
+  return dx * dx + dy * dy <= radius * radius;
+}
+
+inline bool doShapesIntersect(Circle const& circle1, Circle const& circle2)
+{
+  double const max_distance_to_intersect{circle1.getCircleRadius()
+                                         + circle2.getCircleRadius()};
+  return norm2(circle1.getCircleCenter() - circle2.getCircleCenter())
+      <= max_distance_to_intersect * max_distance_to_intersect;
+}
+
+inline bool Circle::isInside(Vector2d const& position) const
+{
+  return doShapesIntersect(*this, position);
+}
 } // namespace kape
 
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,7 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "geometry.hpp"
 #include "doctest.h"
+#include <cmath>
 #include <numbers>
 
 TEST_CASE("Testing the Vector2d class")
@@ -143,6 +144,32 @@ TEST_CASE("Testing the Vector2d class")
     CHECK(kape::rotate(v1, -(kape::PI) / 3.).x == doctest::Approx(4.830127));
     CHECK(kape::rotate(v1, -(kape::PI) / 3.).y == doctest::Approx(1.633975));
   }
+  SUBCASE("Testing the rotate function with the sine and cosine given")
+  {
+    for (double angle : {0., kape::PI / 3., -kape::PI / 4., 2.5}) {
+      CAPTURE(angle);
+      kape::Vector2d const rotated{
+          kape::rotate(v1, std::sin(angle), std::cos(angle))};
+      CHECK(rotated.x == kape::rotate(v1, angle).x);
+      CHECK(rotated.y == kape::rotate(v1, angle).y);
+    }
+  }
+  SUBCASE("Testing the normalize function")
+  {
+    CHECK(kape::normalize(v1).x == doctest::Approx(1. / std::sqrt(26.)));
+    CHECK(kape::normalize(v1).y == doctest::Approx(5. / std::sqrt(26.)));
+    CHECK(kape::normalize(v2).x == 0.);
+    CHECK(kape::normalize(v2).y == -1.);
+  }
+  SUBCASE("Testing the operations can be evaluated at compile time")
+  {
+    constexpr kape::Vector2d v3{kape::Vector2d{3., 4.}
+                                - kape::Vector2d{1., 2.}};
+    static_assert(v3.x == 2. && v3.y == 2.);
+    static_assert(kape::norm2(kape::Vector2d{3., 4.}) == 25.);
+    static_assert((-kape::Vector2d{1., -1.}).y == 1.);
+    static_assert(kape::rotate(kape::Vector2d{1., 0.}, 1., 0.).y == 1.);
+  }
   SUBCASE("Testing the cross_product function")
   {
     // kape::Vector2d v1{1., 5.};
@@ -212,4 +239,36 @@ TEST_CASE("Testing doShapesIntersect function")
   CHECK(kape::doShapesIntersect(c1, r1) == true);
   CHECK(kape::doShapesIntersect(c2, c3) == true);
   CHECK(kape::doShapesIntersect(c3, c5) == false);
+
+  SUBCASE("Testing the edge cases of a circle and a rectangle")
+  {
+    kape::Rectangle const rectangle{kape::Vector2d{0., 2.}, 4., 2.};
+    // touching a side, from outside
+    CHECK(kape::doShapesIntersect(kape::Circle{kape::Vector2d{5., 1.}, 1.},
+                                  rectangle)
+          == true);
+    CHECK(kape::doShapesIntersect(kape::Circle{kape::Vector2d{2., 3.}, 0.99},
+                                  rectangle)
+          == false);
+    // near a corner: the distance is from the corner, not from the sides
+    CHECK(kape::doShapesIntersect(kape::Circle{kape::Vector2d{4.6, 2.6}, 0.8},
+                                  rectangle)
+          == false);
+    CHECK(kape::doShapesIntersect(kape::Circle{kape::Vector2d{4.6, 2.6}, 0.9},
+                                  rectangle)
+          == true);
+    // one inside the other
+    CHECK(kape::doShapesIntersect(kape::Circle{kape::Vector2d{2., 1.}, 0.5},
+                                  rectangle)
+          == true);
+    CHECK(kape::doShapesIntersect(kape::Circle{kape::Vector2d{2., 1.}, 10.},
+                                  rectangle)
+          == true);
+    // the borders of the rectangle are part of it
+    CHECK(kape::doShapesIntersect(rectangle, kape::Vector2d{4., 0.}) == true);
+    CHECK(kape::doShapesIntersect(rectangle, kape::Vector2d{4.01, 1.})
+          == false);
+    CHECK(kape::doShapesIntersect(rectangle, kape::Vector2d{1., -0.01})
+          == false);
+  }
 }
\ No newline at end of file
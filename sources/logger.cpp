@@ -1,16 +1,204 @@
 #include "logger.hpp"
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
 
 namespace kape {
-Logger::Logger(std::string filepath)
+// the smallest power of 2 >= number
+std::size_t roundUpToPowerOf2(std::size_t number)
+{
+  std::size_t power{1};
+  while (power < number) {
+    power *= 2;
+  }
+  return power;
+}
+
+// writes time as e.g. 2026-01-01T12:00:00.000000Z. std::gmtime() isn't used
+// since it isn't thread-safe
+void writeUtcTime(std::ostream& out, std::chrono::system_clock::time_point time)
+{
+  using namespace std::chrono;
+  std::int64_t const microseconds{
+      duration_cast<std::chrono::microseconds>(time.time_since_epoch())
+          .count()};
+  std::int64_t const microseconds_per_day{86'400'000'000};
+  std::int64_t days{microseconds / microseconds_per_day};
+  std::int64_t time_of_day{microseconds % microseconds_per_day};
+  if (time_of_day < 0) {
+    --days;
+    time_of_day += microseconds_per_day;
+  }
+
+  // from the days since 1970-01-01 to the date, in the proleptic Gregorian
+  // calendar (H. Hinnant's civil_from_days)
+  days += 719'468;
+  std::int64_t const era{(days >= 0 ? days : days - 146'096) / 146'097};
+  std::int64_t const day_of_era{days - era * 146'097};
+  std::int64_t const year_of_era{(day_of_era - day_of_era / 1460
+                                  + day_of_era / 36'524
+                                  - day_of_era / 146'096)
+                                 / 365};
+  std::int64_t const day_of_year{
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100)};
+  std::int64_t const shifted_month{(5 * day_of_year + 2) / 153};
+  std::int64_t const day{day_of_year - (153 * shifted_month + 2) / 5 + 1};
+  std::int64_t const month{shifted_month < 10 ? shifted_month + 3
+                                              : shifted_month - 9};
+  std::int64_t const year{year_of_era + era * 400 + (month <= 2 ? 1 : 0)};
+
+  char const fill{out.fill('0')};
+  out << std::setw(4) << year << '-' << std::setw(2) << month << '-'
+      << std::setw(2) << day << 'T' << std::setw(2)
+      << time_of_day / 3'600'000'000 << ':' << std::setw(2)
+      << time_of_day / 60'000'000 % 60 << ':' << std::setw(2)
+      << time_of_day / 1'000'000 % 60 << '.' << std::setw(6)
+      << time_of_day % 1'000'000 << 'Z';
+  out.fill(fill);
+}
+
+// may throw std::invalid_argument if capacity == 0
+Logger::Logger(std::string const& filepath, std::size_t capacity)
     : file_out_{filepath, std::ios::out | std::ios::trunc}
     , is_available_{true}
+    , capacity_{roundUpToPowerOf2(capacity)}
+    , slots_{nullptr}
+    , push_position_{0}
+    , pop_position_{0}
+    , written_position_{0}
+    , number_of_dropped_records_{0}
+    , stopping_{false}
+    , writer_{}
 {
+  if (capacity == 0) {
+    throw std::invalid_argument{"the capacity of the logger can't be 0"};
+  }
   if (!file_out_.is_open()) {
     std::cout << "[ERROR]: Failed to open the file for the logger at: \""
                      + filepath + "\"";
     is_available_ = false;
+    return;
+  }
+
+  slots_ = std::make_unique<Slot[]>(capacity_);
+  for (std::size_t i{0}; i != capacity_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  writer_ = std::thread{&Logger::writerLoop, this};
+}
+
+Logger::~Logger()
+{
+  if (writer_.joinable()) {
+    stopping_.store(true, std::memory_order_release);
+    writer_.join();
+  }
+}
+
+bool Logger::push(Record&& record)
+{
+  std::size_t position{push_position_.load(std::memory_order_relaxed)};
+  Slot* slot{nullptr};
+  while (true) {
+    slot = &slots_[position & (capacity_ - 1)];
+    std::size_t const sequence{slot->sequence.load(std::memory_order_acquire)};
+    if (sequence == position) { // free: try to claim it
+      if (push_position_.compare_exchange_weak(position, position + 1,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (sequence < position) { // still holds the record of a lap ago
+      number_of_dropped_records_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else { // another producer claimed it first
+      position = push_position_.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->record = std::move(record);
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool Logger::pop(Record& record)
+{
+  Slot& slot{slots_[pop_position_ & (capacity_ - 1)]};
+  if (slot.sequence.load(std::memory_order_acquire) != pop_position_ + 1) {
+    return false;
+  }
+  record = std::move(slot.record);
+  // free for the record capacity_ positions later
+  slot.sequence.store(pop_position_ + capacity_, std::memory_order_release);
+  ++pop_position_;
+  return true;
+}
+
+void Logger::writerLoop()
+{
+  Record record{};
+  std::size_t reported_dropped_records{0};
+  while (true) {
+    // read before emptying the buffer, so that the records pushed before the
+    // destructor was called are all written
+    bool const stopping{stopping_.load(std::memory_order_acquire)};
+
+    bool wrote{false};
+    while (pop(record)) {
+      if (record.is_structured) {
+        writeUtcTime(file_out_, record.time);
+        file_out_ << ' ' << LOG_LEVEL_NAMES[static_cast<std::size_t>(
+                                record.level)]
+                  << ' ' << record.text << '\n';
+      } else {
+        file_out_ << record.text;
+      }
+      wrote = true;
+    }
+    std::size_t const dropped_records{
+        number_of_dropped_records_.load(std::memory_order_relaxed)};
+    if (dropped_records != reported_dropped_records) {
+      file_out_ << "\n[WARNING]: the log was full, "
+                << dropped_records - reported_dropped_records
+                << " records were dropped\n";
+      reported_dropped_records = dropped_records;
+      wrote                    = true;
+    }
+    if (wrote) {
+      file_out_.flush();
+    }
+    written_position_.store(pop_position_, std::memory_order_release);
+
+    if (stopping) {
+      return;
+    }
+    if (!wrote) {
+      std::this_thread::sleep_for(WRITER_PERIOD_);
+    }
+  }
+}
+
+void Logger::write(std::string&& text)
+{
+  if (is_available_) {
+    push(Record{std::chrono::system_clock::time_point{}, LogLevel::INFO, false,
+                std::move(text)});
   }
 }
 
-} // namespace kape
\ No newline at end of file
+void Logger::flush()
+{
+  if (!is_available_) {
+    return;
+  }
+  std::size_t const position{push_position_.load(std::memory_order_acquire)};
+  while (written_position_.load(std::memory_order_acquire) < position) {
+    std::this_thread::sleep_for(WRITER_PERIOD_);
+  }
+}
+
+std::size_t Logger::getNumberOfDroppedRecords() const
+{
+  return number_of_dropped_records_.load(std::memory_order_relaxed);
+}
+
+} // namespace kape
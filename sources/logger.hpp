@@ -1,32 +1,197 @@
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <fstream>
+#include <iomanip>
+#include <iostream> // before log, whose constructor may write to std::cout
+#include <memory>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// the records below KAPE_MIN_LOG_LEVEL (0: debug, 1: info, 2: warning, 3:
+// error) aren't even built
+#ifndef KAPE_MIN_LOG_LEVEL
+#  define KAPE_MIN_LOG_LEVEL 1
+#endif
 
 namespace kape {
+
+enum class LogLevel
+{
+  DEBUG,
+  INFO,
+  WARNING,
+  ERROR
+};
+
+inline constexpr LogLevel MIN_LOG_LEVEL{
+    static_cast<LogLevel>(KAPE_MIN_LOG_LEVEL)};
+inline constexpr std::array<char const*, 4> LOG_LEVEL_NAMES{"DEBUG", "INFO",
+                                                            "WARNING", "ERROR"};
+
+class Logger;
+
+// the text of a single record written with <<, e.g.
+//    kape::log << "loaded " << number_of_ants << " ants\n";
+// it's handed to the logger as a whole when the statement ends, so that the
+// records of different threads don't mix
+class LogRecord
+{
+ private:
+  Logger& logger_;
+  std::ostringstream text_;
+
+ public:
+  template<class OUTPUT>
+  explicit LogRecord(Logger& logger, OUTPUT const& output)
+      : logger_{logger}
+      , text_{}
+  {
+    text_ << output;
+  }
+  LogRecord(LogRecord const&)            = delete;
+  LogRecord& operator=(LogRecord const&) = delete;
+  ~LogRecord();
+
+  template<class OUTPUT>
+  LogRecord& operator<<(OUTPUT const& output)
+  {
+    text_ << output;
+    return *this;
+  }
+};
+
+// the records are put in a bounded ring buffer, without locks, and written to
+// the file by a thread of the logger, so that logging never waits for the
+// disk and can be done from many threads at once. If the buffer is full the
+// record is dropped, and the number of records dropped is written instead
 class Logger
 {
+ public:
+  inline static const std::string DEFAULT_FILEPATH{"./log/log.txt"};
+  inline static std::size_t const DEFAULT_CAPACITY{4096};
+
  private:
+  // period of the checks of the writer thread while there's nothing to write
+  inline static std::chrono::milliseconds const WRITER_PERIOD_{2};
+
+  struct Record
+  {
+    std::chrono::system_clock::time_point time;
+    LogLevel level;
+    // the text written with << is kept as it is, without time and level
+    bool is_structured;
+    std::string text;
+  };
+  // a slot can be written when sequence == position, and read when
+  // sequence == position + 1, where position is the number of records pushed
+  // before the one it holds
+  struct Slot
+  {
+    std::atomic<std::size_t> sequence;
+    Record record;
+  };
+
   std::ofstream file_out_;
   bool is_available_;
+  std::size_t const capacity_; // a power of 2
+  std::unique_ptr<Slot[]> slots_;
+  // every producer claims a position by increasing it
+  alignas(64) std::atomic<std::size_t> push_position_;
+  // the position of the next record to be written, only used by the writer
+  alignas(64) std::size_t pop_position_;
+  // the records before it are in the file
+  std::atomic<std::size_t> written_position_;
+  // since the logger was created
+  std::atomic<std::size_t> number_of_dropped_records_;
+  std::atomic<bool> stopping_;
+  std::thread writer_;
+
+  // returns false if the buffer is full
+  bool push(Record&& record);
+  // returns false if the next record hasn't been pushed yet
+  bool pop(Record& record);
+  void writerLoop();
+
+  template<class VALUE>
+  static void writeField(std::ostringstream& text, char const* key,
+                         VALUE const& value)
+  {
+    text << ' ' << key << '=';
+    if constexpr (std::is_convertible_v<VALUE const&, std::string_view>) {
+      text << std::quoted(std::string_view{value});
+    } else {
+      text << value;
+    }
+  }
+  static void writeFields(std::ostringstream&)
+  {}
+  template<class VALUE, class... FIELDS>
+  static void writeFields(std::ostringstream& text, char const* key,
+                          VALUE const& value, FIELDS const&... fields)
+  {
+    writeField(text, key, value);
+    writeFields(text, fields...);
+  }
 
  public:
-  inline static const std::string DEFAULT_FILEPATH{"./log/log.txt"};
-  Logger(std::string filepath = DEFAULT_FILEPATH);
+  // capacity is rounded up to a power of 2
+  // may throw std::invalid_argument if capacity == 0
+  explicit Logger(std::string const& filepath = DEFAULT_FILEPATH,
+                  std::size_t capacity          = DEFAULT_CAPACITY);
+  Logger(Logger const&)            = delete;
+  Logger& operator=(Logger const&) = delete;
+  // writes all the records left
+  ~Logger();
 
-  template<class OUTPUT>  
-  friend Logger& operator<<(Logger& log, OUTPUT const& output)
+  // a structured record: one line with the time (UTC), the level, the event
+  // and the fields, given as key, value, key, value..., e.g.
+  //    log.write<LogLevel::INFO>("checkpoint", "step", 1000, "file", path);
+  // becomes
+  //    2026-01-01T12:00:00.000000Z INFO checkpoint step=1000 file="./s.kape"
+  // the strings are quoted. Nothing is done if LEVEL < MIN_LOG_LEVEL
+  template<LogLevel LEVEL, class... FIELDS>
+  void write(char const* event, FIELDS const&... fields)
   {
-    if (log.is_available_) {
-      log.file_out_ << output;
+    if constexpr (LEVEL >= MIN_LOG_LEVEL) {
+      static_assert(sizeof...(FIELDS) % 2 == 0,
+                    "the fields must be pairs of key and value");
+      if (!is_available_) {
+        return;
+      }
+      std::ostringstream text;
+      text << event;
+      writeFields(text, fields...);
+      push(Record{std::chrono::system_clock::now(), LEVEL, true, text.str()});
     }
-    return log;
+  }
+  // the raw text of a LogRecord
+  void write(std::string&& text);
+  // waits until all the records pushed before the call are in the file
+  void flush();
+  std::size_t getNumberOfDroppedRecords() const;
+
+  template<class OUTPUT>
+  friend LogRecord operator<<(Logger& logger, OUTPUT const& output)
+  {
+    return LogRecord{logger, output};
   }
 };
 
+inline LogRecord::~LogRecord()
+{
+  logger_.write(text_.str());
+}
+
 inline Logger log{};
 
 } // namespace kape
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,77 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "logger.hpp"
+#include "doctest.h"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+TEST_CASE("Testing the Logger class")
+{
+  std::string const filepath{"./logger_test.txt"};
+  CHECK_THROWS_AS(kape::Logger(filepath, 0), std::invalid_argument);
+
+  SUBCASE("the records of many threads are written whole")
+  {
+    {
+      kape::Logger logger{filepath, 1 << 14};
+      kape::ThreadPool pool{4};
+      pool.run(4000, [&logger](std::size_t i) {
+        logger << "record " << i << " of the ants\n";
+      });
+      logger.write<kape::LogLevel::ERROR>("event", "key", 42, "name",
+                                          "two words");
+      logger.flush();
+      CHECK(logger.getNumberOfDroppedRecords() == 0);
+    }
+
+    std::ifstream file_in{filepath};
+    std::size_t number_of_records{0};
+    std::string line;
+    std::string last_line;
+    while (std::getline(file_in, line)) {
+      if (line.rfind("record ", 0) == 0) {
+        CHECK(line.size() >= 20);
+        CHECK(line.compare(line.size() - 12, 12, " of the ants") == 0);
+        ++number_of_records;
+      }
+      last_line = line;
+    }
+    CHECK(number_of_records == 4000);
+    // e.g. 2026-01-01T12:00:00.000000Z ERROR event key=42 name="two words"
+    REQUIRE(last_line.size() == 27 + 36);
+    CHECK(last_line[10] == 'T');
+    CHECK(last_line[26] == 'Z');
+    CHECK(last_line.substr(27) == " ERROR event key=42 name=\"two words\"");
+  }
+
+  SUBCASE("the records below the minimum level are left out")
+  {
+    {
+      kape::Logger logger{filepath};
+      logger.write<kape::LogLevel::DEBUG>("hidden");
+      logger.write<kape::LogLevel::WARNING>("shown");
+    }
+    std::ifstream file_in{filepath};
+    std::string const content{std::istreambuf_iterator<char>{file_in}, {}};
+    CHECK((content.find("hidden") == std::string::npos)
+          == (kape::MIN_LOG_LEVEL > kape::LogLevel::DEBUG));
+    CHECK(content.find("WARNING shown") != std::string::npos);
+  }
+
+  SUBCASE("the records that don't fit are counted")
+  {
+    kape::Logger logger{filepath, 2};
+    // they're pushed faster than they're written: some must be dropped
+    for (int i{0}; i != 10000; ++i) {
+      logger << i << '\n';
+    }
+    logger.flush();
+    CHECK(logger.getNumberOfDroppedRecords() > 0);
+  }
+
+  std::remove(filepath.c_str());
+}
@@ -1,16 +1,411 @@
+#include "metrics.hpp"
+#include "profiler.hpp"
 #include "simulation.hpp"
+#include "sweep.hpp"
+#include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-int main()
+// options that can be passed from the command line
+struct CommandLineOptions
 {
-  kape::Simulation sim;
-  if (!sim.chooseAndLoadSimulation()) {
+  bool headless{false};
+  bool show_help{false};
+  // if empty the simulation is chosen interactively (or the default one is
+  // loaded if headless)
+  std::string simulation_name{};
+  // if both are 0 DEFAULT_HEADLESS_SIMULATED_TIME is used
+  std::size_t number_of_steps{0};
+  double simulated_time{0.};
+  unsigned int seed{kape::Simulation::DEFAULT_SEED_};
+  // 0: one per hardware thread. In a sweep, number of simulations run at the
+  // same time
+  std::size_t number_of_threads{0};
+  // if not empty the simulation is resumed from this snapshot
+  std::string resume_filepath{};
+  // in simulated seconds, 0: no checkpoints (headless only)
+  double checkpoint_period{0.};
+  std::string checkpoint_filepath{
+      kape::Simulation::DEFAULT_SNAPSHOT_FILEPATH_};
+  // if not empty the parameter sweep described in this file is run
+  std::string sweep_filepath{};
+  std::string sweep_results_filepath{"./sweep_results.csv"};
+  kape::Pheromones::Model pheromones_model{
+      kape::Pheromones::Model::PARTICLES};
+  // only for the FIELD model
+  double diffusion_rate{0.};
+  // steps of the ants in every step of the simulation
+  std::size_t number_of_substeps{1};
+  // if not empty the times of the phases of the steps are written here at the
+  // end of the run (builds with KAPE_PROFILING only)
+  std::string profile_filepath{};
+  // if not empty the metrics are sampled into this CSV file while running
+  std::string metrics_filepath{};
+  double metrics_period{1.}; // in simulated seconds
+  // empty: all of them
+  std::vector<kape::Metric> metrics{};
+};
+
+// in seconds, used if neither --steps nor --seconds are passed
+double const DEFAULT_HEADLESS_SIMULATED_TIME{60.};
+// more threads than this are surely a typo
+std::size_t const MAX_NUMBER_OF_THREADS{1024};
+
+void printUsage(std::string const& program_name)
+{
+  std::cout
+      << "Usage: " << program_name << " [options]\n"
+      << "Options:\n"
+         "  --headless        run without opening a window, as fast as "
+         "possible,\n"
+         "                    then print a summary of the run\n"
+         "  --map <name>      load the simulation <name> from "
+         "./assets/simulations\n"
+         "  --seconds <s>     simulated seconds to run for (headless only)\n"
+         "  --steps <n>       number of steps to run for (headless only)\n"
+         "  --seed <n>        seed of the simulation's random generators\n"
+         "  --threads <n>     threads used to update the ants (default: one "
+         "per\n"
+         "                    hardware thread); doesn't change the results\n"
+         "  --resume <file>   resume the simulation saved in the snapshot "
+         "<file>\n"
+         "  --checkpoint-every <s>\n"
+         "                    save a snapshot every <s> simulated seconds "
+         "(headless\n"
+         "                    only)\n"
+         "  --checkpoint-file <file>\n"
+         "                    where the checkpoints are saved (default: "
+         "./snapshot.kape)\n"
+         "  --sweep <file>    run all the simulations of the parameter sweep "
+         "described\n"
+         "                    in <file>, --threads at a time, without a "
+         "window\n"
+         "  --sweep-out <file>\n"
+         "                    where the results of the sweep are written "
+         "(default:\n"
+         "                    ./sweep_results.csv)\n"
+         "  --pheromones <particles|field>\n"
+         "                    store every pheromone particle released "
+         "(default), or\n"
+         "                    add them to a field on a grid, whose memory "
+         "doesn't\n"
+         "                    grow with the run (needs a map enclosed by "
+         "obstacles)\n"
+         "  --diffusion <r>   fraction of the field's intensity spread to the "
+         "nearby\n"
+         "                    squares every second (field only, default: 0)\n"
+         "  --substeps <n>    move the ants <n> times per step, with the ones "
+         "far from\n"
+         "                    everything looking around only after the last "
+         "time:\n"
+         "                    longer steps, at most 10 (default: 1)\n"
+         "  --profile <file>  write the time spent in every phase of the "
+         "steps to\n"
+         "                    <file> at the end of the run, as JSON if it "
+         "ends with\n"
+         "                    .json, as CSV otherwise (builds with "
+         "KAPE_PROFILING\n"
+         "                    only). F3 shows them in the window\n"
+         "  --metrics <file>  append the metrics of the simulation to the "
+         "CSV <file>\n"
+         "                    while it runs, in a bounded amount of memory\n"
+         "  --metrics-every <s>\n"
+         "                    simulated seconds between two samples of the "
+         "metrics\n"
+         "                    (default: 1)\n"
+         "  --metrics-only <list>\n"
+         "                    the metrics to record, separated by commas "
+         "(default:\n"
+         "                    all of them): food_collected, "
+         "ants_carrying_food,\n"
+         "                    to_anthill_pheromones, to_food_pheromones,\n"
+         "                    distance_from_optimal_path, step_time\n"
+         "  --help            show this message\n";
+}
+
+// throws std::invalid_argument if the arguments are badly formatted
+CommandLineOptions parseCommandLine(int argc, char* argv[])
+{
+  CommandLineOptions options;
+
+  for (int index{1}; index < argc; ++index) {
+    std::string const argument{argv[index]};
+
+    if (argument == "--headless") {
+      options.headless = true;
+      continue;
+    }
+    if (argument == "--help" || argument == "-h") {
+      options.show_help = true;
+      continue;
+    }
+
+    if (argument != "--map" && argument != "--seconds" && argument != "--steps"
+        && argument != "--seed" && argument != "--threads"
+        && argument != "--resume" && argument != "--checkpoint-every"
+        && argument != "--checkpoint-file" && argument != "--sweep"
+        && argument != "--sweep-out" && argument != "--pheromones"
+        && argument != "--diffusion" && argument != "--substeps"
+        && argument != "--profile"
+        && argument != "--metrics" && argument != "--metrics-every"
+        && argument != "--metrics-only") {
+      throw std::invalid_argument{"unknown option \"" + argument + "\""};
+    }
+
+    // all the other options need a value
+    if (index + 1 >= argc) {
+      throw std::invalid_argument{"missing value after \"" + argument + "\""};
+    }
+    std::string const value{argv[++index]};
+
+    try {
+      if (argument == "--map") {
+        options.simulation_name = value;
+      } else if (argument == "--seconds") {
+        options.simulated_time = std::stod(value);
+      } else if (argument == "--steps") {
+        options.number_of_steps = kape::parseUnsignedNumber<std::size_t>(value);
+      } else if (argument == "--seed") {
+        options.seed = kape::parseUnsignedNumber<unsigned int>(value);
+      } else if (argument == "--threads") {
+        options.number_of_threads =
+            kape::parseUnsignedNumber<std::size_t>(value);
+      } else if (argument == "--resume") {
+        options.resume_filepath = value;
+      } else if (argument == "--checkpoint-every") {
+        options.checkpoint_period = std::stod(value);
+      } else if (argument == "--checkpoint-file") {
+        options.checkpoint_filepath = value;
+      } else if (argument == "--sweep") {
+        options.sweep_filepath = value;
+      } else if (argument == "--pheromones") {
+        if (value != "particles" && value != "field") {
+          throw std::invalid_argument{"invalid value \"" + value
+                                      + "\" for \"" + argument + "\""};
+        }
+        options.pheromones_model = value == "field"
+                                     ? kape::Pheromones::Model::FIELD
+                                     : kape::Pheromones::Model::PARTICLES;
+      } else if (argument == "--diffusion") {
+        options.diffusion_rate = std::stod(value);
+      } else if (argument == "--substeps") {
+        options.number_of_substeps =
+            kape::parseUnsignedNumber<std::size_t>(value);
+      } else if (argument == "--profile") {
+        options.profile_filepath = value;
+      } else if (argument == "--metrics") {
+        options.metrics_filepath = value;
+      } else if (argument == "--metrics-every") {
+        options.metrics_period = std::stod(value);
+      } else if (argument == "--metrics-only") {
+        options.metrics.clear();
+        std::istringstream names{value};
+        std::string name;
+        while (std::getline(names, name, ',')) {
+          std::optional<kape::Metric> const metric{kape::metricFromName(name)};
+          if (!metric.has_value()) {
+            throw std::invalid_argument{"unknown metric \"" + name + "\""};
+          }
+          options.metrics.push_back(*metric);
+        }
+      } else {
+        options.sweep_results_filepath = value;
+      }
+    } catch (std::logic_error const&) { // not a number or out of range
+      throw std::invalid_argument{"invalid value \"" + value + "\" for \""
+                                  + argument + "\""};
+    }
+  }
+
+  if (options.simulated_time < 0.) {
+    throw std::invalid_argument{"--seconds can't be negative"};
+  }
+  if (options.number_of_steps != 0 && options.simulated_time != 0.) {
+    throw std::invalid_argument{"--steps and --seconds can't be used together"};
+  }
+  if (options.checkpoint_period < 0.) {
+    throw std::invalid_argument{"--checkpoint-every can't be negative"};
+  }
+  if (options.checkpoint_period > 0. && !options.headless) {
+    throw std::invalid_argument{"--checkpoint-every needs --headless"};
+  }
+  if (!options.resume_filepath.empty() && !options.simulation_name.empty()) {
+    throw std::invalid_argument{"--resume and --map can't be used together"};
+  }
+  if (!options.sweep_filepath.empty()
+      && (!options.simulation_name.empty() || !options.resume_filepath.empty()
+          || options.checkpoint_period > 0.)) {
+    throw std::invalid_argument{
+        "--sweep can't be used with --map, --resume or --checkpoint-every"};
+  }
+  if (!(options.diffusion_rate >= 0. && options.diffusion_rate < 1.)) {
+    throw std::invalid_argument{"--diffusion must be in [0, 1)"};
+  }
+  if (options.diffusion_rate != 0.
+      && options.pheromones_model != kape::Pheromones::Model::FIELD) {
+    throw std::invalid_argument{"--diffusion needs --pheromones field"};
+  }
+  // the model is saved in the snapshot, and the sweep runs the default one
+  if (options.pheromones_model != kape::Pheromones::Model::PARTICLES
+      && (!options.resume_filepath.empty()
+          || !options.sweep_filepath.empty())) {
+    throw std::invalid_argument{
+        "--pheromones can't be used with --resume or --sweep"};
+  }
+  if (options.number_of_threads > MAX_NUMBER_OF_THREADS) {
+    throw std::invalid_argument{"--threads must be at most "
+                                + std::to_string(MAX_NUMBER_OF_THREADS)};
+  }
+  if (options.number_of_substeps == 0
+      || options.number_of_substeps
+             > kape::Simulation::MAX_NUMBER_OF_SUBSTEPS_) {
+    throw std::invalid_argument{"--substeps must be in [1, 10]"};
+  }
+  // the sweep runs the default number of substeps
+  if (options.number_of_substeps != 1 && !options.sweep_filepath.empty()) {
+    throw std::invalid_argument{"--substeps can't be used with --sweep"};
+  }
+  if (!options.profile_filepath.empty() && !kape::PROFILING_ENABLED) {
+    throw std::invalid_argument{
+        "--profile needs a build configured with -DKAPE_PROFILING=ON"};
+  }
+  // the simulations of a sweep run at the same time would share the profiler
+  if (!options.profile_filepath.empty() && !options.sweep_filepath.empty()) {
+    throw std::invalid_argument{"--profile can't be used with --sweep"};
+  }
+
+  if (!(options.metrics_period > 0.)) {
+    throw std::invalid_argument{"--metrics-every must be > 0"};
+  }
+  // every run of the sweep would write to the same file
+  if (!options.metrics_filepath.empty() && !options.sweep_filepath.empty()) {
+    throw std::invalid_argument{"--metrics can't be used with --sweep"};
+  }
+
+  return options;
+}
+
+void printSummary(kape::RunSummary const& summary)
+{
+  double const steps_per_second{
+      summary.wall_time > 0.
+          ? static_cast<double>(summary.steps) / summary.wall_time
+          : 0.};
+
+  std::cout << "[INFO]: headless run completed\n"
+            << "\tsteps:                 " << summary.steps << '\n'
+            << "\tsimulated time:        " << summary.simulated_time << " s\n"
+            << "\twall time:             " << summary.wall_time << " s\n"
+            << "\tsteps per second:      " << steps_per_second << '\n'
+            << "\tants:                  " << summary.number_of_ants << '\n'
+            << "\tthreads:               " << summary.number_of_threads
+            << '\n'
+            << "\tfood collected:        " << summary.food_collected << '\n'
+            << "\tfood left:             " << summary.food_left << '\n'
+            << "\tpheromones to anthill: "
+            << summary.number_of_to_anthill_pheromones << '\n'
+            << "\tpheromones to food:    "
+            << summary.number_of_to_food_pheromones << '\n'
+            << "\tcheckpoints:           " << summary.number_of_checkpoints
+            << '\n';
+}
+
+// nothing to do if filepath is empty
+bool saveProfile(std::string const& filepath)
+{
+  if (filepath.empty()) {
+    return true;
+  }
+  if (!kape::profiler.saveToFile(filepath)) {
+    std::cout << "[ERROR]: couldn't write the profile, please refer to the "
+                 "logs at ./log/log.txt\n";
+    return false;
+  }
+  std::cout << "[INFO]: the times of the phases of the steps are in "
+            << filepath << '\n';
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  CommandLineOptions options;
+  try {
+    options = parseCommandLine(argc, argv);
+  } catch (std::invalid_argument const& error) {
+    std::cout << "[ERROR]: " << error.what() << "\n\n";
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  if (options.show_help) {
+    printUsage(argv[0]);
+    return 0;
+  }
+
+  if (!options.sweep_filepath.empty()) {
+    std::optional<kape::SweepSpec> const spec{
+        kape::loadSweepSpecFromFile(options.sweep_filepath)};
+    if (!spec.has_value()
+        || !kape::runSweep(*spec, options.sweep_results_filepath,
+                           options.number_of_threads)) {
+      std::cout << "[ERROR]: something went wrong running the sweep, please "
+                   "refer to the logs at ./log/log.txt\n";
+      return 1;
+    }
+    std::cout << "[INFO]: the results of the sweep are in "
+              << options.sweep_results_filepath << '\n';
+    return 0;
+  }
+
+  kape::Simulation sim{options.headless, options.seed,
+                       options.number_of_threads};
+  sim.setNumberOfSubsteps(options.number_of_substeps);
+
+  // when headless there's nobody to choose the simulation interactively
+  bool const loaded{
+      !options.resume_filepath.empty()
+          ? sim.loadSnapshot(options.resume_filepath)
+      : options.headless || !options.simulation_name.empty()
+          ? sim.loadSimulationByName(options.simulation_name)
+          : sim.chooseAndLoadSimulation()};
+  if (!loaded
+      || (options.pheromones_model != kape::Pheromones::Model::PARTICLES
+          && !sim.setPheromonesModel(options.pheromones_model,
+                                     options.diffusion_rate))) {
     std::cout << "[ERROR]: something went wrong loading the simulation, please "
                  "refer to the logs at ./log/log.txt\n";
     return 1;
   }
+  if (!options.metrics_filepath.empty()
+      && !sim.recordMetrics(options.metrics_filepath, options.metrics_period,
+                            options.metrics)) {
+    std::cout << "[ERROR]: couldn't open the file of the metrics, please "
+                 "refer to the logs at ./log/log.txt\n";
+    return 1;
+  }
+
+  if (!options.headless) {
+    sim.run();
+    return saveProfile(options.profile_filepath) ? 0 : 1;
+  }
+
+  std::size_t number_of_steps{options.number_of_steps};
+  if (number_of_steps == 0) {
+    double const simulated_time{options.simulated_time > 0.
+                                    ? options.simulated_time
+                                    : DEFAULT_HEADLESS_SIMULATED_TIME};
+    number_of_steps = static_cast<std::size_t>(
+        std::ceil(simulated_time / sim.getSimulationDeltaT()));
+  }
 
-  sim.run();
+  printSummary(sim.runHeadless(number_of_steps, options.checkpoint_period,
+                               options.checkpoint_filepath));
+  sim.logAverageAntsDistances();
 
-  return 0;
-}
\ No newline at end of file
+  return saveProfile(options.profile_filepath) ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+#include "metrics.hpp"
+#include "logger.hpp"
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace kape {
+
+std::optional<Metric> metricFromName(std::string const& name)
+{
+  for (std::size_t index{0}; index != NUMBER_OF_METRICS; ++index) {
+    if (name == METRIC_NAMES[index]) {
+      return static_cast<Metric>(index);
+    }
+  }
+  return std::nullopt;
+}
+
+// MetricsRecorder implementation
+MetricsRecorder::MetricsRecorder(std::string const& filepath,
+                                 std::vector<Metric> metrics)
+    : file_out_{filepath, std::ios::out | std::ios::app}
+    , metrics_{std::move(metrics)}
+    , block_{}
+    , rows_in_block_{0}
+    , number_of_samples_{0}
+    , last_flush_{clock::now()}
+{
+  if (metrics_.empty()) {
+    for (std::size_t index{0}; index != NUMBER_OF_METRICS; ++index) {
+      metrics_.push_back(static_cast<Metric>(index));
+    }
+  }
+
+  // failed to open the file
+  if (!file_out_.is_open()) {
+    kape::log << "[ERROR]:\tfrom MetricsRecorder::MetricsRecorder(std::string "
+                 "const& filepath, std::vector<Metric> metrics):\n\t\t\t"
+                 "Couldn't open file at \""
+              << filepath << "\"\n";
+    return;
+  }
+
+  std::string header{"step,simulated_time"};
+  for (Metric metric : metrics_) {
+    header += ',';
+    header += METRIC_NAMES[static_cast<std::size_t>(metric)];
+  }
+
+  // e.g. a resumed run: its rows go under the ones already in the file, which
+  // must have the same columns
+  file_out_.seekp(0, std::ios::end);
+  if (file_out_.tellp() != 0) {
+    std::ifstream file_in{filepath, std::ios::in};
+    std::string first_line;
+    std::getline(file_in, first_line);
+    if (first_line != header) {
+      kape::log << "[ERROR]:\tfrom MetricsRecorder::MetricsRecorder("
+                   "std::string const& filepath, std::vector<Metric> "
+                   "metrics):\n\t\t\tThe file at \""
+                << filepath << "\" already has other columns\n";
+      file_out_.close();
+    }
+    return;
+  }
+  file_out_ << header << std::endl;
+}
+
+MetricsRecorder::~MetricsRecorder()
+{
+  flush();
+}
+
+bool MetricsRecorder::isGood() const
+{
+  return file_out_.is_open() && file_out_.good();
+}
+
+std::vector<Metric> const& MetricsRecorder::getMetrics() const
+{
+  return metrics_;
+}
+
+std::size_t MetricsRecorder::getNumberOfSamples() const
+{
+  return number_of_samples_;
+}
+
+void MetricsRecorder::record(MetricsSample const& sample)
+{
+  if (!file_out_.is_open()) {
+    return;
+  }
+
+  std::ostringstream row;
+  row << sample.step << ',' << sample.simulated_time;
+  for (Metric metric : metrics_) {
+    row << ',';
+    double const value{sample.values[static_cast<std::size_t>(metric)]};
+    if (!std::isnan(value)) {
+      row << value;
+    }
+  }
+  row << '\n';
+  block_ += row.str();
+  ++rows_in_block_;
+  ++number_of_samples_;
+
+  if (rows_in_block_ == ROWS_PER_BLOCK
+      || clock::now() - last_flush_ >= FLUSH_PERIOD_) {
+    flush();
+  }
+}
+
+void MetricsRecorder::flush()
+{
+  if (!file_out_.is_open()) {
+    return;
+  }
+  file_out_ << block_;
+  file_out_.flush();
+  // keeps its memory for the next block
+  block_.clear();
+  rows_in_block_ = 0;
+  last_flush_    = clock::now();
+}
+
+// DecimatedSeries implementation
+// may throw std::invalid_argument if capacity < 2
+DecimatedSeries::DecimatedSeries(std::size_t capacity)
+    : capacity_{capacity + capacity % 2}
+    , values_{}
+    , stride_{1}
+    , pending_sum_{0.}
+    , pending_count_{0}
+{
+  if (capacity < 2) {
+    throw std::invalid_argument{
+        "a DecimatedSeries must hold at least 2 points"};
+  }
+  values_.reserve(capacity_);
+}
+
+void DecimatedSeries::add(double value)
+{
+  pending_sum_ += value;
+  ++pending_count_;
+  if (pending_count_ != stride_) {
+    return;
+  }
+
+  if (values_.size() == capacity_) {
+    for (std::size_t index{0}; index != capacity_ / 2; ++index) {
+      values_[index] = (values_[2 * index] + values_[2 * index + 1]) / 2.;
+    }
+    values_.resize(capacity_ / 2);
+    // the samples pending are the first half of the next point
+    stride_ *= 2;
+    return;
+  }
+
+  values_.push_back(pending_sum_ / static_cast<double>(stride_));
+  pending_sum_   = 0.;
+  pending_count_ = 0;
+}
+
+std::vector<double> const& DecimatedSeries::getValues() const
+{
+  return values_;
+}
+
+std::size_t DecimatedSeries::getStride() const
+{
+  return stride_;
+}
+
+void DecimatedSeries::clear()
+{
+  values_.clear();
+  stride_        = 1;
+  pending_sum_   = 0.;
+  pending_count_ = 0;
+}
+
+void DecimatedSeries::saveToSnapshot(SnapshotWriter& snapshot) const
+{
+  snapshot.write<std::uint64_t>(capacity_);
+  snapshot.writeArray(values_);
+  snapshot.write<std::uint64_t>(stride_);
+  snapshot.write(pending_sum_);
+  snapshot.write<std::uint64_t>(pending_count_);
+}
+
+// may throw std::runtime_error if the snapshot is badly formatted
+void DecimatedSeries::loadFromSnapshot(SnapshotReader& snapshot)
+{
+  std::size_t const capacity{
+      static_cast<std::size_t>(snapshot.read<std::uint64_t>())};
+  std::vector<double> values;
+  snapshot.readArray(values);
+  std::size_t const stride{
+      static_cast<std::size_t>(snapshot.read<std::uint64_t>())};
+  double const pending_sum{snapshot.read<double>()};
+  std::size_t const pending_count{
+      static_cast<std::size_t>(snapshot.read<std::uint64_t>())};
+  checkSnapshot(capacity >= 2 && capacity % 2 == 0,
+                "series with an invalid capacity");
+  checkSnapshot(values.size() <= capacity, "series with too many points");
+  checkSnapshot(stride != 0 && (stride & (stride - 1)) == 0,
+                "series with a stride that isn't a power of 2");
+  checkSnapshot(pending_count < stride,
+                "series with too many samples pending");
+
+  // all valid
+  capacity_      = capacity;
+  values_        = std::move(values);
+  stride_        = stride;
+  pending_sum_   = pending_sum;
+  pending_count_ = pending_count;
+  values_.reserve(capacity_);
+}
+
+} // namespace kape
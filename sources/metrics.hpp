@@ -0,0 +1,123 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "snapshot.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kape {
+
+// the quantities that can be sampled while the simulation runs
+enum class Metric : std::size_t
+{
+  FOOD_COLLECTED, // by the anthill since the simulation was loaded
+  ANTS_CARRYING_FOOD,
+  TO_ANTHILL_PHEROMONES,
+  TO_FOOD_PHEROMONES,
+  // mean distance of the ants from the optimal path, only known by some maps
+  DISTANCE_FROM_OPTIMAL_PATH,
+  // mean wall time of the steps since the previous sample, in seconds
+  STEP_TIME
+};
+
+inline constexpr std::size_t NUMBER_OF_METRICS{6};
+inline constexpr std::array<char const*, NUMBER_OF_METRICS> METRIC_NAMES{
+    "food_collected",        "ants_carrying_food",
+    "to_anthill_pheromones", "to_food_pheromones",
+    "distance_from_optimal_path", "step_time"};
+
+// returns an empty optional if name isn't one of METRIC_NAMES
+std::optional<Metric> metricFromName(std::string const& name);
+
+// the values of all the metrics at a step, NaN if one isn't known
+struct MetricsSample
+{
+  std::size_t step;
+  double simulated_time; // in seconds
+  std::array<double, NUMBER_OF_METRICS> values;
+};
+
+// writes the samples to a CSV file, one column per metric, while the
+// simulation runs. The rows are buffered and appended to the file in blocks,
+// at least every FLUSH_PERIOD_ of wall time: the memory used doesn't grow with
+// the run, and the file can be read while it's still being written
+class MetricsRecorder
+{
+ public:
+  inline static std::size_t const ROWS_PER_BLOCK{256};
+
+ private:
+  inline static std::chrono::seconds const FLUSH_PERIOD_{1};
+  using clock = std::chrono::steady_clock;
+
+  std::ofstream file_out_;
+  std::vector<Metric> metrics_;
+  // the rows not in the file yet
+  std::string block_;
+  std::size_t rows_in_block_;
+  std::size_t number_of_samples_;
+  std::chrono::time_point<clock> last_flush_;
+
+ public:
+  // the columns are the step, the simulated time and metrics, in this order.
+  // If metrics is empty all of them are recorded. The rows are appended to the
+  // file: if it isn't empty it must already have the same columns, or nothing
+  // is written
+  explicit MetricsRecorder(std::string const& filepath,
+                           std::vector<Metric> metrics = {});
+  MetricsRecorder(MetricsRecorder const&)            = delete;
+  MetricsRecorder& operator=(MetricsRecorder const&) = delete;
+  // writes the rows left
+  ~MetricsRecorder();
+
+  // false if the file couldn't be opened or a write failed
+  bool isGood() const;
+  std::vector<Metric> const& getMetrics() const;
+  std::size_t getNumberOfSamples() const;
+  // the unknown values are left empty
+  void record(MetricsSample const& sample);
+  // appends the buffered rows to the file
+  void flush();
+};
+
+// the history of a value sampled at a fixed period, in at most capacity
+// points: when it's full, consecutive pairs of points are averaged and the
+// period of the following ones doubles. Its memory doesn't grow with the run
+class DecimatedSeries
+{
+ public:
+  inline static std::size_t const DEFAULT_CAPACITY{1024};
+
+ private:
+  std::size_t capacity_; // even
+  std::vector<double> values_;
+  // every point is the mean of stride_ samples
+  std::size_t stride_;
+  // of the samples of the next point
+  double pending_sum_;
+  std::size_t pending_count_;
+
+ public:
+  // may throw std::invalid_argument if capacity < 2. It's rounded up to an
+  // even number
+  explicit DecimatedSeries(std::size_t capacity = DEFAULT_CAPACITY);
+
+  void add(double value);
+  std::vector<double> const& getValues() const;
+  // the number of samples averaged in each point
+  std::size_t getStride() const;
+  void clear();
+
+  void saveToSnapshot(SnapshotWriter& snapshot) const;
+  // may throw std::runtime_error if the snapshot is badly formatted
+  void loadFromSnapshot(SnapshotReader& snapshot);
+};
+
+} // namespace kape
+
+#endif
@@ -0,0 +1,146 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "metrics.hpp"
+#include "doctest.h"
+#include "snapshot.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("Testing the DecimatedSeries class")
+{
+  CHECK_THROWS_AS(kape::DecimatedSeries{1}, std::invalid_argument);
+
+  kape::DecimatedSeries series{4};
+  for (int i{0}; i != 4; ++i) {
+    series.add(i);
+  }
+  CHECK(series.getValues() == std::vector<double>{0., 1., 2., 3.});
+  CHECK(series.getStride() == 1);
+
+  // full: the pairs are averaged and the next points are made of 2 samples
+  series.add(4.);
+  CHECK(series.getValues() == std::vector<double>{0.5, 2.5});
+  CHECK(series.getStride() == 2);
+  series.add(5.);
+  CHECK(series.getValues() == std::vector<double>{0.5, 2.5, 4.5});
+
+  // however many samples are added, the points never exceed the capacity
+  for (int i{6}; i != 1000; ++i) {
+    series.add(i);
+    CHECK(series.getValues().size() <= 4);
+  }
+  CHECK(series.getStride() == 256);
+
+  SUBCASE("the series is restored from a snapshot")
+  {
+    kape::SnapshotWriter writer;
+    series.saveToSnapshot(writer);
+    std::vector<char> const bytes{writer.releaseBuffer()};
+    kape::SnapshotReader reader{bytes};
+    kape::DecimatedSeries restored{};
+    restored.loadFromSnapshot(reader);
+    CHECK(reader.isAtEnd());
+    for (int i{1000}; i != 2000; ++i) {
+      series.add(i);
+      restored.add(i);
+    }
+    CHECK(restored.getValues() == series.getValues());
+    CHECK(restored.getStride() == series.getStride());
+  }
+
+  SUBCASE("clear() starts again from a stride of 1")
+  {
+    series.clear();
+    CHECK(series.getValues().empty());
+    CHECK(series.getStride() == 1);
+  }
+}
+
+TEST_CASE("Testing the MetricsRecorder class")
+{
+  std::string const filepath{"./metrics_test.csv"};
+
+  CHECK(kape::metricFromName("step_time") == kape::Metric::STEP_TIME);
+  CHECK(!kape::metricFromName("steps").has_value());
+
+  SUBCASE("the chosen columns are written, the unknown values left empty")
+  {
+    {
+      kape::MetricsRecorder recorder{
+          filepath,
+          {kape::Metric::FOOD_COLLECTED,
+           kape::Metric::DISTANCE_FROM_OPTIMAL_PATH}};
+      REQUIRE(recorder.isGood());
+      std::size_t const number_of_steps{3
+                                        * kape::MetricsRecorder::ROWS_PER_BLOCK};
+      for (std::size_t step{0}; step != number_of_steps; ++step) {
+        kape::MetricsSample sample{step, 0.5, {}};
+        sample.values.fill(std::nan(""));
+        sample.values[static_cast<std::size_t>(
+            kape::Metric::FOOD_COLLECTED)] = 7.;
+        recorder.record(sample);
+      }
+      CHECK(recorder.getNumberOfSamples() == number_of_steps);
+    }
+
+    std::ifstream file_in{filepath};
+    std::string line;
+    REQUIRE(std::getline(file_in, line));
+    CHECK(line
+          == "step,simulated_time,food_collected,distance_from_optimal_path");
+    REQUIRE(std::getline(file_in, line));
+    CHECK(line == "0,0.5,7,");
+    std::size_t number_of_rows{1};
+    while (std::getline(file_in, line)) {
+      ++number_of_rows;
+    }
+    CHECK(number_of_rows == 3 * kape::MetricsRecorder::ROWS_PER_BLOCK);
+  }
+
+  SUBCASE("all the metrics are recorded if none is chosen")
+  {
+    {
+      kape::MetricsRecorder recorder{filepath};
+      CHECK(recorder.getMetrics().size() == kape::NUMBER_OF_METRICS);
+    }
+    std::ifstream file_in{filepath};
+    std::string line;
+    REQUIRE(std::getline(file_in, line));
+    CHECK(line
+          == "step,simulated_time,food_collected,ants_carrying_food,"
+             "to_anthill_pheromones,to_food_pheromones,"
+             "distance_from_optimal_path,step_time");
+  }
+
+  SUBCASE("the rows are appended to the ones already in the file")
+  {
+    for (std::size_t run{0}; run != 2; ++run) {
+      kape::MetricsRecorder recorder{filepath,
+                                     {kape::Metric::FOOD_COLLECTED}};
+      REQUIRE(recorder.isGood());
+      kape::MetricsSample sample{run, 0.5, {}};
+      sample.values.fill(std::nan(""));
+      recorder.record(sample);
+    }
+    {
+      // the columns are different: nothing is written
+      kape::MetricsRecorder recorder{filepath, {kape::Metric::STEP_TIME}};
+      CHECK_FALSE(recorder.isGood());
+    }
+
+    std::ifstream file_in{filepath};
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file_in, line);) {
+      lines.push_back(line);
+    }
+    CHECK(lines
+          == std::vector<std::string>{"step,simulated_time,food_collected",
+                                      "0,0.5,", "1,0.5,"});
+  }
+
+  std::remove(filepath.c_str());
+}
@@ -0,0 +1,246 @@
+#include "profiler.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace kape {
+
+// PhaseStatistics implementation
+void PhaseStatistics::addFrame(std::uint64_t nanoseconds)
+{
+  // the weight of the new frame in the moving average
+  double const RECENT_WEIGHT{0.05};
+
+  min_ns    = frames == 0 ? nanoseconds : std::min(min_ns, nanoseconds);
+  max_ns    = std::max(max_ns, nanoseconds);
+  recent_ns = frames == 0 ? static_cast<double>(nanoseconds)
+                          : recent_ns
+                                + RECENT_WEIGHT
+                                      * (static_cast<double>(nanoseconds)
+                                         - recent_ns);
+  ++frames;
+  total_ns += nanoseconds;
+
+  // index of the highest bit set, i.e. floor(log2(nanoseconds))
+  std::size_t bucket{0};
+  while (bucket + 1 < NUMBER_OF_BUCKETS && (nanoseconds >> (bucket + 1)) != 0) {
+    ++bucket;
+  }
+  ++histogram[bucket];
+}
+
+double PhaseStatistics::getMeanNs() const
+{
+  return frames == 0
+           ? 0.
+           : static_cast<double>(total_ns) / static_cast<double>(frames);
+}
+
+std::uint64_t PhaseStatistics::getPercentileNs(double percentile) const
+{
+  if (frames == 0) {
+    return 0;
+  }
+  // the frames up to and including the one at the percentile
+  std::uint64_t const target{std::max(
+      std::uint64_t{1}, static_cast<std::uint64_t>(std::ceil(
+                            percentile * static_cast<double>(frames))))};
+  std::uint64_t counted{0};
+  for (std::size_t bucket{0}; bucket != NUMBER_OF_BUCKETS; ++bucket) {
+    counted += histogram[bucket];
+    if (counted >= target) {
+      // the upper bound of the bucket can't be more than the slowest frame
+      return std::min(max_ns, (std::uint64_t{2} << bucket) - 1);
+    }
+  }
+  return max_ns;
+}
+
+// Profiler class implementation
+// 0 is never used, so that it's never the id of a thread's cached profiler
+std::atomic<std::uint64_t> next_profiler_id{1};
+
+Profiler::Profiler()
+    : id_{next_profiler_id.fetch_add(1)}
+    , threads_counters_mutex_{}
+    , threads_counters_{}
+    , statistics_mutex_{}
+    , statistics_{}
+    , number_of_frames_{0}
+{}
+
+Profiler::ThreadCounters& Profiler::getThreadCounters()
+{
+  // the profiler used last by this thread, and its counters
+  thread_local std::uint64_t cached_profiler_id{0};
+  thread_local ThreadCounters* cached_counters{nullptr};
+
+  if (cached_profiler_id != id_) {
+    std::lock_guard<std::mutex> const lock{threads_counters_mutex_};
+    // the elements of a deque don't move when more are added
+    cached_counters    = &threads_counters_.emplace_back();
+    cached_profiler_id = id_;
+  }
+  return *cached_counters;
+}
+
+void Profiler::endFrame()
+{
+  std::array<std::uint64_t, NUMBER_OF_PHASES> nanoseconds{};
+  std::array<std::uint64_t, NUMBER_OF_PHASES> calls{};
+  {
+    std::lock_guard<std::mutex> const lock{threads_counters_mutex_};
+    for (auto& counters : threads_counters_) {
+      for (std::size_t phase{0}; phase != NUMBER_OF_PHASES; ++phase) {
+        nanoseconds[phase] += counters.nanoseconds[phase].exchange(
+            0, std::memory_order_relaxed);
+        calls[phase] +=
+            counters.calls[phase].exchange(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> const lock{statistics_mutex_};
+  ++number_of_frames_;
+  for (std::size_t phase{0}; phase != NUMBER_OF_PHASES; ++phase) {
+    if (calls[phase] != 0) {
+      statistics_[phase].addFrame(nanoseconds[phase]);
+    }
+  }
+}
+
+std::uint64_t Profiler::getNumberOfFrames() const
+{
+  std::lock_guard<std::mutex> const lock{statistics_mutex_};
+  return number_of_frames_;
+}
+
+std::array<PhaseStatistics, NUMBER_OF_PHASES> Profiler::getStatistics() const
+{
+  std::lock_guard<std::mutex> const lock{statistics_mutex_};
+  return statistics_;
+}
+
+void Profiler::reset()
+{
+  {
+    std::lock_guard<std::mutex> const lock{threads_counters_mutex_};
+    for (auto& counters : threads_counters_) {
+      for (std::size_t phase{0}; phase != NUMBER_OF_PHASES; ++phase) {
+        counters.nanoseconds[phase].store(0, std::memory_order_relaxed);
+        counters.calls[phase].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+  std::lock_guard<std::mutex> const lock{statistics_mutex_};
+  statistics_       = {};
+  number_of_frames_ = 0;
+}
+
+std::string Profiler::toCsv() const
+{
+  std::array<PhaseStatistics, NUMBER_OF_PHASES> const statistics{
+      getStatistics()};
+
+  std::ostringstream csv;
+  csv << "phase,frames,total_ns,mean_ns,min_ns,max_ns,p50_ns,p90_ns,p99_ns,"
+         "histogram\n";
+  for (std::size_t phase{0}; phase != NUMBER_OF_PHASES; ++phase) {
+    PhaseStatistics const& phase_statistics{statistics[phase]};
+    csv << PHASE_NAMES[phase] << ',' << phase_statistics.frames << ','
+        << phase_statistics.total_ns << ',' << phase_statistics.getMeanNs()
+        << ',' << phase_statistics.min_ns << ',' << phase_statistics.max_ns
+        << ',' << phase_statistics.getPercentileNs(0.5) << ','
+        << phase_statistics.getPercentileNs(0.9) << ','
+        << phase_statistics.getPercentileNs(0.99) << ',';
+    for (std::size_t bucket{0}; bucket != PhaseStatistics::NUMBER_OF_BUCKETS;
+         ++bucket) {
+      csv << (bucket == 0 ? "" : ";") << phase_statistics.histogram[bucket];
+    }
+    csv << '\n';
+  }
+  return csv.str();
+}
+
+std::string Profiler::toJson() const
+{
+  std::array<PhaseStatistics, NUMBER_OF_PHASES> const statistics{
+      getStatistics()};
+
+  std::ostringstream json;
+  json << "{\n"
+       << "  \"frames\": " << getNumberOfFrames() << ",\n"
+       << "  \"time_unit\": \"ns\",\n"
+       << "  \"histogram_buckets\": \"[2^i, 2^(i+1)) ns\",\n"
+       << "  \"phases\": [";
+  for (std::size_t phase{0}; phase != NUMBER_OF_PHASES; ++phase) {
+    PhaseStatistics const& phase_statistics{statistics[phase]};
+    json << (phase == 0 ? "\n" : ",\n") << "    {\n"
+         << "      \"name\": \"" << PHASE_NAMES[phase] << "\",\n"
+         << "      \"frames\": " << phase_statistics.frames << ",\n"
+         << "      \"total\": " << phase_statistics.total_ns << ",\n"
+         << "      \"mean\": " << phase_statistics.getMeanNs() << ",\n"
+         << "      \"min\": " << phase_statistics.min_ns << ",\n"
+         << "      \"max\": " << phase_statistics.max_ns << ",\n"
+         << "      \"p50\": " << phase_statistics.getPercentileNs(0.5) << ",\n"
+         << "      \"p90\": " << phase_statistics.getPercentileNs(0.9) << ",\n"
+         << "      \"p99\": " << phase_statistics.getPercentileNs(0.99)
+         << ",\n"
+         << "      \"histogram\": [";
+    for (std::size_t bucket{0}; bucket != PhaseStatistics::NUMBER_OF_BUCKETS;
+         ++bucket) {
+      json << (bucket == 0 ? "" : ", ") << phase_statistics.histogram[bucket];
+    }
+    json << "]\n"
+         << "    }";
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+std::string Profiler::toText() const
+{
+  std::array<PhaseStatistics, NUMBER_OF_PHASES> const statistics{
+      getStatistics()};
+
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(3) << std::left
+       << std::setw(20) << "phase [ms]" << std::right << std::setw(9)
+       << "recent" << std::setw(9) << "mean" << std::setw(9) << "p90" << '\n';
+  for (std::size_t phase{0}; phase != NUMBER_OF_PHASES; ++phase) {
+    PhaseStatistics const& phase_statistics{statistics[phase]};
+    text << std::left << std::setw(20) << PHASE_NAMES[phase] << std::right
+         << std::setw(9) << phase_statistics.recent_ns / 1e6 << std::setw(9)
+         << phase_statistics.getMeanNs() / 1e6 << std::setw(9)
+         << static_cast<double>(phase_statistics.getPercentileNs(0.9)) / 1e6
+         << '\n';
+  }
+  return text.str();
+}
+
+bool Profiler::saveToFile(std::string const& filepath) const
+{
+  std::ofstream file_out{filepath, std::ios::out | std::ios::trunc};
+
+  // failed to open the file
+  if (!file_out.is_open()) {
+    kape::log << "[ERROR]:\tfrom Profiler::saveToFile(std::string const& "
+                 "filepath):\n\t\t\tCouldn't open file at \""
+              << filepath << "\"\n";
+    return false;
+  }
+
+  std::string const json_extension{".json"};
+  bool const is_json{
+      filepath.size() >= json_extension.size()
+      && filepath.compare(filepath.size() - json_extension.size(),
+                          json_extension.size(), json_extension)
+             == 0};
+  file_out << (is_json ? toJson() : toCsv());
+  return file_out.good();
+}
+
+} // namespace kape
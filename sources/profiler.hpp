@@ -0,0 +1,177 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// the timers placed in the simulation with KAPE_PROFILE_SCOPE() and
+// KAPE_PROFILE_SWITCH() are compiled only if KAPE_PROFILING is defined
+// (cmake -DKAPE_PROFILING=ON): otherwise they cost nothing
+#ifdef KAPE_PROFILING
+// times the rest of the enclosing scope as phase
+#  define KAPE_PROFILE_SCOPE(timer, phase) kape::ScopedPhaseTimer timer{phase}
+// the time from here on is counted in phase instead of timer's previous one
+#  define KAPE_PROFILE_SWITCH(timer, phase) timer.switchTo(phase)
+#else
+#  define KAPE_PROFILE_SCOPE(timer, phase) static_cast<void>(0)
+#  define KAPE_PROFILE_SWITCH(timer, phase) static_cast<void>(0)
+#endif
+
+namespace kape {
+
+#ifdef KAPE_PROFILING
+inline constexpr bool PROFILING_ENABLED{true};
+#else
+inline constexpr bool PROFILING_ENABLED{false};
+#endif
+
+// the parts a step of the simulation is split into
+enum class Phase : std::size_t
+{
+  STEP, // the whole Simulation::update()
+  MOVEMENT,
+  OBSTACLE_AVOIDANCE,
+  FOOD_SEARCH,
+  ANTHILL_CHECKS,
+  PHEROMONE_QUERIES,
+  DEPOSITS, // of the pheromones and food requested by the ants
+  EVAPORATION,
+  RENDERING
+};
+
+inline constexpr std::size_t NUMBER_OF_PHASES{9};
+inline constexpr std::array<char const*, NUMBER_OF_PHASES> PHASE_NAMES{
+    "step",        "movement",       "obstacle_avoidance",
+    "food_search", "anthill_checks", "pheromone_queries",
+    "deposits",    "evaporation",    "rendering"};
+
+// the times of one phase over all the frames in which it ran at least once
+struct PhaseStatistics
+{
+  // bucket i counts the frames that took [2^i, 2^(i+1)) ns, the last one also
+  // the longer ones
+  inline static constexpr std::size_t NUMBER_OF_BUCKETS{40};
+
+  std::uint64_t frames{0};
+  std::uint64_t total_ns{0};
+  std::uint64_t min_ns{0};
+  std::uint64_t max_ns{0};
+  // moving average of the last frames (about 20), for the live overlay
+  double recent_ns{0.};
+  std::array<std::uint64_t, NUMBER_OF_BUCKETS> histogram{};
+
+  void addFrame(std::uint64_t nanoseconds);
+  double getMeanNs() const;
+  // estimated from the histogram: the upper bound of the bucket that holds
+  // the percentile. percentile is in [0, 1]
+  std::uint64_t getPercentileNs(double percentile) const;
+};
+
+// collects the time spent in every phase. The timers add to counters owned by
+// their thread, so that the ants updated in parallel don't contend for them,
+// and endFrame() gathers the counters of all the threads into the
+// statistics. The time of a phase run on more threads at once is the sum of
+// the times of every thread
+class Profiler
+{
+ public:
+  // every thread that times a phase gets its own, on its own cache lines
+  struct alignas(64) ThreadCounters
+  {
+    std::array<std::atomic<std::uint64_t>, NUMBER_OF_PHASES> nanoseconds{};
+    std::array<std::atomic<std::uint64_t>, NUMBER_OF_PHASES> calls{};
+  };
+
+ private:
+  // tells apart the profilers, even if one is created where another was
+  std::uint64_t const id_;
+  std::mutex threads_counters_mutex_;
+  std::deque<ThreadCounters> threads_counters_;
+  // protected by statistics_mutex_
+  mutable std::mutex statistics_mutex_;
+  std::array<PhaseStatistics, NUMBER_OF_PHASES> statistics_;
+  std::uint64_t number_of_frames_;
+
+ public:
+  explicit Profiler();
+  Profiler(Profiler const&)            = delete;
+  Profiler& operator=(Profiler const&) = delete;
+
+  // the counters of the calling thread
+  ThreadCounters& getThreadCounters();
+  // adds the time counted since the last call to the statistics, as a frame.
+  // The phases that weren't timed since the last call are left out of it
+  void endFrame();
+  std::uint64_t getNumberOfFrames() const;
+  std::array<PhaseStatistics, NUMBER_OF_PHASES> getStatistics() const;
+  // forgets all the frames
+  void reset();
+
+  // one row per phase, the histogram is a list of counts separated by ';'
+  std::string toCsv() const;
+  std::string toJson() const;
+  // a few lines with the recent, mean and 90th percentile time of each phase
+  std::string toText() const;
+  // writes toJson() if filepath ends with ".json", toCsv() otherwise
+  // returns false if it fails
+  bool saveToFile(std::string const& filepath) const;
+};
+
+// the profiler the timers of the simulation report to
+inline Profiler profiler{};
+
+// adds the time from its construction (or the last switchTo()) to its
+// destruction to the current phase, in the counters of the thread
+class ScopedPhaseTimer
+{
+ private:
+  using clock = std::chrono::steady_clock;
+
+  Profiler::ThreadCounters& counters_;
+  Phase phase_;
+  clock::time_point start_;
+
+  void addElapsed(clock::time_point now)
+  {
+    std::size_t const index{static_cast<std::size_t>(phase_)};
+    auto const elapsed{
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_)};
+    // endFrame() only needs the totals, not any ordering: relaxed is enough
+    counters_.nanoseconds[index].fetch_add(
+        static_cast<std::uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    counters_.calls[index].fetch_add(1, std::memory_order_relaxed);
+  }
+
+ public:
+  explicit ScopedPhaseTimer(Phase phase,
+                            Profiler& phases_profiler = kape::profiler)
+      : counters_{phases_profiler.getThreadCounters()}
+      , phase_{phase}
+      , start_{clock::now()}
+  {}
+  ScopedPhaseTimer(ScopedPhaseTimer const&)            = delete;
+  ScopedPhaseTimer& operator=(ScopedPhaseTimer const&) = delete;
+  ~ScopedPhaseTimer()
+  {
+    addElapsed(clock::now());
+  }
+
+  // a single clock read ends the current phase and starts the next one
+  void switchTo(Phase phase)
+  {
+    clock::time_point const now{clock::now()};
+    addElapsed(now);
+    phase_ = phase;
+    start_ = now;
+  }
+};
+
+} // namespace kape
+
+#endif
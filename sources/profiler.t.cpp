@@ -0,0 +1,82 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "profiler.hpp"
+#include "doctest.h"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+TEST_CASE("Testing the Profiler class")
+{
+  auto const phase_frames{
+      [](kape::Profiler const& profiler, kape::Phase phase) {
+        return profiler.getStatistics()[static_cast<std::size_t>(phase)]
+            .frames;
+      }};
+
+  kape::Profiler profiler;
+  profiler.endFrame();
+  CHECK(profiler.getNumberOfFrames() == 1);
+  // no phase was timed in the first frame
+  CHECK(phase_frames(profiler, kape::Phase::MOVEMENT) == 0);
+
+  SUBCASE("the phases timed are counted in the frame")
+  {
+    {
+      kape::ScopedPhaseTimer timer{kape::Phase::MOVEMENT, profiler};
+      timer.switchTo(kape::Phase::FOOD_SEARCH);
+    }
+    profiler.endFrame();
+    CHECK(profiler.getNumberOfFrames() == 2);
+    CHECK(phase_frames(profiler, kape::Phase::MOVEMENT) == 1);
+    CHECK(phase_frames(profiler, kape::Phase::FOOD_SEARCH) == 1);
+    CHECK(phase_frames(profiler, kape::Phase::RENDERING) == 0);
+
+    // the counters are emptied by endFrame()
+    profiler.endFrame();
+    CHECK(phase_frames(profiler, kape::Phase::MOVEMENT) == 1);
+
+    profiler.reset();
+    CHECK(profiler.getNumberOfFrames() == 0);
+    CHECK(phase_frames(profiler, kape::Phase::MOVEMENT) == 0);
+  }
+
+  SUBCASE("the times of all the threads end up in the same frame")
+  {
+    kape::ThreadPool pool{4};
+    pool.run(100, [&profiler](std::size_t) {
+      kape::ScopedPhaseTimer timer{kape::Phase::OBSTACLE_AVOIDANCE, profiler};
+    });
+    profiler.endFrame();
+    CHECK(phase_frames(profiler, kape::Phase::OBSTACLE_AVOIDANCE) == 1);
+  }
+
+  SUBCASE("the output has one row per phase")
+  {
+    std::string const csv{profiler.toCsv()};
+    CHECK(std::count(csv.begin(), csv.end(), '\n')
+          == static_cast<std::ptrdiff_t>(kape::NUMBER_OF_PHASES + 1));
+    CHECK(csv.find("pheromone_queries,0,") != std::string::npos);
+  }
+
+  SUBCASE("the histogram of a phase")
+  {
+    kape::PhaseStatistics statistics;
+    CHECK(statistics.getPercentileNs(0.5) == 0);
+    statistics.addFrame(1);
+    statistics.addFrame(700);  // in [512, 1024)
+    statistics.addFrame(1000); // in [512, 1024)
+    statistics.addFrame(5000); // in [4096, 8192)
+    CHECK(statistics.frames == 4);
+    CHECK(statistics.min_ns == 1);
+    CHECK(statistics.max_ns == 5000);
+    CHECK(statistics.getMeanNs() == doctest::Approx(6701. / 4.));
+    CHECK(statistics.histogram[0] == 1);
+    CHECK(statistics.histogram[9] == 2);
+    CHECK(statistics.histogram[12] == 1);
+    CHECK(statistics.getPercentileNs(0.25) == 1);
+    CHECK(statistics.getPercentileNs(0.5) == 1023);
+    // not more than the slowest frame
+    CHECK(statistics.getPercentileNs(1.) == 5000);
+  }
+}
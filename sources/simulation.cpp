@@ -3,11 +3,27 @@
 #include "drawing.hpp"
 #include "environment.hpp"
 #include "logger.hpp"
+#include "profiler.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <random> // for std::seed_seq
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace kape {
 
@@ -52,6 +68,19 @@ bool Simulation::loadConfigFromFile(std::string const& filepath)
   return true;
 }
 
+// derives the seed of one of the simulation's components (food, ants, ...)
+// from the seed of the whole simulation
+unsigned int deriveSeed(unsigned int seed, unsigned int component)
+{
+  std::seed_seq sequence{seed, component};
+  std::array<std::uint32_t, 1> derived_seed;
+  sequence.generate(derived_seed.begin(), derived_seed.end());
+  return static_cast<unsigned int>(derived_seed[0]);
+}
+
+std::string extractSimulationName(
+    std::filesystem::directory_entry const& simulation_directory_path);
+
 bool Simulation::loadSimulation(
     std::filesystem::directory_entry const& simulation_folder_path)
 {
@@ -65,14 +94,28 @@ bool Simulation::loadSimulation(
                                simulation_path + "anthill/anthill.dat")
       && food_.loadFromFile(obstacles_, simulation_path + "food/food.dat")
       && ants_.loadFromFile(anthill_, simulation_path + "ants/ants.dat")
-      && window_.loadAntAnimationFrames(
-          simulation_path + "ants/",
-          kape::Ant::ANIMATION_TOTAL_NUMBER_OF_FRAMES)
+      && (!window_.has_value()
+          || window_->loadAntAnimationFrames(
+              simulation_path + "ants/",
+              kape::Ant::ANIMATION_TOTAL_NUMBER_OF_FRAMES))
       && loadConfigFromFile(simulation_path + "config.txt")};
 
   if (correctly_loaded) {
+    // the map is enclosed by the obstacles: the pheromones can use a dense grid
+    if (obstacles_.getNumberOfObstacles() != 0) {
+      Rectangle const bounds{obstacles_.getBoundingBox()};
+      to_anthill_ph_ =
+          Pheromones{Pheromones::Type::TO_ANTHILL,
+                     2. * Ant::CIRCLE_OF_VISION_RADIUS, bounds,
+                     deriveSeed(seed_, 2u)};
+      to_food_ph_ = Pheromones{Pheromones::Type::TO_FOOD,
+                               2. * Ant::CIRCLE_OF_VISION_RADIUS, bounds,
+                               deriveSeed(seed_, 3u)};
+    }
     to_anthill_ph_.optimizePath(calculate_ants_average_distances_);
     to_food_ph_.optimizePath(calculate_ants_average_distances_);
+    simulation_name_ = extractSimulationName(simulation_folder_path);
+    simulated_time_  = 0.;
   }
 
   return correctly_loaded;
@@ -96,7 +139,7 @@ bool Simulation::timeToRender()
 
 bool Simulation::timeToCalculateAverageDistances()
 {
-  time_since_last_ants_average_distances_check_ += simulation_delta_t_;
+  time_since_last_ants_average_distances_check_ += getSimulationDeltaT();
   if (time_since_last_ants_average_distances_check_
       > PERIOD_BETWEEN_PATH_OPTIMIZATION_CHECK_) {
     time_since_last_ants_average_distances_check_ -=
@@ -106,25 +149,124 @@ bool Simulation::timeToCalculateAverageDistances()
   return false;
 }
 
-Simulation::Simulation()
-    : obstacles_{}
+double averageDistance(Ants const& ants, double slope, double y_intercept)
+{
+  double total_distance =
+      std::accumulate(ants.begin(), ants.end(), 0.,
+                      [slope, y_intercept](double sum, Ant const& ant) {
+                        return sum
+                             + (std::abs(slope * ant.getPosition().x
+                                         + y_intercept - ant.getPosition().y))
+                                   / std::sqrt(slope * slope + 1);
+                      });
+  return total_distance / static_cast<double>(ants.getNumberOfAnts());
+}
+
+MetricsSample Simulation::makeMetricsSample()
+{
+  MetricsSample sample{};
+  sample.step = static_cast<std::size_t>(
+      std::llround(simulated_time_ / getSimulationDeltaT()));
+  sample.simulated_time = simulated_time_;
+  sample.values.fill(std::nan(""));
+
+  auto const set{[&sample](Metric metric, double value) {
+    sample.values[static_cast<std::size_t>(metric)] = value;
+  }};
+  set(Metric::FOOD_COLLECTED, anthill_.getFoodCounter());
+  AntsSoA const& ants{ants_.getAntsData()};
+  set(Metric::ANTS_CARRYING_FOOD,
+      static_cast<double>(std::count_if(
+          ants.has_food.begin(), ants.has_food.end(),
+          [](unsigned char has_food) { return has_food != 0; })));
+  set(Metric::TO_ANTHILL_PHEROMONES,
+      static_cast<double>(to_anthill_ph_.getNumberOfPheromones()));
+  set(Metric::TO_FOOD_PHEROMONES,
+      static_cast<double>(to_food_ph_.getNumberOfPheromones()));
+  if (calculate_ants_average_distances_ && ants_.getNumberOfAnts() != 0) {
+    set(Metric::DISTANCE_FROM_OPTIMAL_PATH,
+        averageDistance(ants_, optimal_line_slope_, optimal_line_intercept_));
+  }
+  set(Metric::STEP_TIME,
+      metrics_steps_wall_time_.count()
+          / static_cast<double>(steps_since_metrics_sample_));
+  return sample;
+}
+
+void Simulation::update()
+{
+  // the clock is read only if it's needed
+  std::chrono::time_point<clock> const step_start{
+      metrics_recorder_.has_value() ? clock::now()
+                                    : std::chrono::time_point<clock>{}};
+  {
+    KAPE_PROFILE_SCOPE(timer, Phase::STEP);
+    ants_.update(food_, to_anthill_ph_, to_food_ph_, anthill_, obstacles_,
+                 simulation_delta_t_, number_of_substeps_);
+    to_anthill_ph_.updateParticlesEvaporation(getSimulationDeltaT());
+    to_food_ph_.updateParticlesEvaporation(getSimulationDeltaT());
+    simulated_time_ += getSimulationDeltaT();
+
+    // only if it's a simulation where we know which is the optimal path
+    if (calculate_ants_average_distances_) {
+      if (timeToCalculateAverageDistances()) {
+        average_ants_distance_from_line_.add(averageDistance(
+            ants_, optimal_line_slope_, optimal_line_intercept_));
+      }
+    }
+  }
+
+  if (metrics_recorder_.has_value()) {
+    metrics_steps_wall_time_ += clock::now() - step_start;
+    ++steps_since_metrics_sample_;
+    if (steps_since_metrics_sample_ == steps_between_metrics_samples_) {
+      metrics_recorder_->record(makeMetricsSample());
+      steps_since_metrics_sample_ = 0;
+      metrics_steps_wall_time_    = std::chrono::duration<double>{0.};
+    }
+  }
+  // every step is a frame of the profiler
+  if constexpr (PROFILING_ENABLED) {
+    profiler.endFrame();
+  }
+}
+
+// number_of_threads == 0 means one per hardware thread
+// may throw std::runtime_error if !headless and it fails to open the window
+Simulation::Simulation(bool headless, unsigned int seed,
+                       std::size_t number_of_threads)
+    : seed_{seed}
+    , simulation_name_{}
+    , obstacles_{}
     , anthill_{}
-    , food_{}
-    , ants_{}
+    , food_{deriveSeed(seed, 0u)}
+    , ants_{deriveSeed(seed, 1u), number_of_threads}
     , to_anthill_ph_{Pheromones::Type::TO_ANTHILL,
-                     2. * Ant::CIRCLE_OF_VISION_RADIUS}
-    , to_food_ph_{Pheromones::Type::TO_FOOD, 2. * Ant::CIRCLE_OF_VISION_RADIUS}
+                     2. * Ant::CIRCLE_OF_VISION_RADIUS, deriveSeed(seed, 2u)}
+    , to_food_ph_{Pheromones::Type::TO_FOOD, 2. * Ant::CIRCLE_OF_VISION_RADIUS,
+                  deriveSeed(seed, 3u)}
     , simulation_delta_t_{SIMULATION_DELTA_T_}
+    , number_of_substeps_{1}
+    , simulated_time_{0.}
     , last_frame_update_{clock::now()}
+    , pending_snapshot_{}
     , ready_to_run_{false}
     , window_{}
     , time_since_last_ants_average_distances_check_{}
     , average_ants_distance_from_line_{}
+    , metrics_recorder_{}
+    , steps_between_metrics_samples_{0}
+    , steps_since_metrics_sample_{0}
+    , metrics_steps_wall_time_{0.}
     , is_debug_{}
     , calculate_ants_average_distances_{}
     , optimal_line_slope_{}
     , optimal_line_intercept_{}
-{}
+{
+  if (!headless) {
+    window_.emplace();
+  }
+}
 
 // gets only the name of the simulation folder starting from the path
 //  e.g.:
@@ -236,8 +378,8 @@ bool Simulation::chooseAndLoadSimulation()
   }
 
   std::size_t chosen_simulation_index{0};
-  if (window_.isOpen()) {
-    chosen_simulation_index = window_.chooseOneOption(
+  if (window_.has_value() && window_->isOpen()) {
+    chosen_simulation_index = window_->chooseOneOption(
         available_simulations_names, DEFAULT_BUTTON_COLOR_,
         CHOSEN_BUTTON_COLOR_, BACKGROUND_COLOR_, DEFAULT_BACKGROUND_PATH_);
   } else {
@@ -274,61 +416,434 @@ bool Simulation::chooseAndLoadSimulation()
   return ready_to_run_;
 }
 
+bool Simulation::loadSimulationByName(std::string const& simulation_name)
+{
+  std::filesystem::directory_entry simulation_folder{
+      DEFAULT_SIMULATIONS_FOLDER_PATH_ + '/'
+      + (simulation_name.empty() ? DEFAULT_SIMULATION_NAME_ : simulation_name)};
+
+  if (!simulation_folder.is_directory()) {
+    log << "[ERROR]: from Simulation::loadSimulationByName(std::string const& "
+           "simulation_name): \n\t\t\tThe simulation folder path at \""
+        << simulation_folder.path().string()
+        << "\" isn't a directory/doesn't exist\n";
+    ready_to_run_ = false;
+    return false;
+  }
+
+  ready_to_run_ = loadSimulation(simulation_folder);
+  if (!ready_to_run_) {
+    kape::log << "[ERROR]:\tfrom Simulation::loadSimulationByName(std::string "
+                 "const& simulation_name):"
+                 "\n\t\t\tTried to load the simulation from \""
+              << simulation_folder.path().string() << " but failed to do so.\n";
+  }
+
+  return ready_to_run_;
+}
+
 bool Simulation::isReadyToRun() const
 {
   return ready_to_run_;
 }
 
-void averageDistances(Ants const& ants, double slope, double y_intercept,
-                      std::vector<double>& average_distances)
+bool Simulation::isHeadless() const
 {
-  double total_distance =
-      std::accumulate(ants.begin(), ants.end(), 0.,
-                      [slope, y_intercept](double sum, Ant const& ant) {
-                        return sum
-                             + (std::abs(slope * ant.getPosition().x
-                                         + y_intercept - ant.getPosition().y))
-                                   / std::sqrt(slope * slope + 1);
-                      });
-  double avg_distance{total_distance
-                      / static_cast<double>(ants.getNumberOfAnts())};
-  average_distances.push_back(avg_distance);
+  return !window_.has_value();
 }
 
-void Simulation::run()
+double Simulation::getSimulationDeltaT() const
+{
+  return simulation_delta_t_ * static_cast<double>(number_of_substeps_);
+}
+
+// may throw std::invalid_argument if number_of_substeps isn't in
+// [1, MAX_NUMBER_OF_SUBSTEPS_]
+void Simulation::setNumberOfSubsteps(std::size_t number_of_substeps)
+{
+  if (number_of_substeps == 0
+      || number_of_substeps > MAX_NUMBER_OF_SUBSTEPS_) {
+    throw std::invalid_argument{
+        "The number of substeps must be between 1 and "
+        + std::to_string(MAX_NUMBER_OF_SUBSTEPS_)};
+  }
+  number_of_substeps_ = number_of_substeps;
+}
+
+std::size_t Simulation::getNumberOfSubsteps() const
+{
+  return number_of_substeps_;
+}
+
+double Simulation::getSimulatedTime() const
+{
+  return simulated_time_;
+}
+
+std::vector<double> const& Simulation::getAverageAntsDistances() const
+{
+  return average_ants_distance_from_line_.getValues();
+}
+
+bool Simulation::setNumberOfAnts(std::size_t number_of_ants)
+{
+  if (!ready_to_run_) {
+    return false;
+  }
+  ants_ = Ants{deriveSeed(seed_, 1u), ants_.getNumberOfThreads()};
+  ants_.addAntsAroundCircle(anthill_.getCircle(), number_of_ants);
+  return true;
+}
+
+bool Simulation::setPheromonesDecreasePercentageAmount(
+    double decrease_percentage_amount)
 {
   if (!ready_to_run_) {
+    return false;
+  }
+  to_anthill_ph_.setDecreasePercentageAmount(decrease_percentage_amount);
+  to_food_ph_.setDecreasePercentageAmount(decrease_percentage_amount);
+  return true;
+}
+
+bool Simulation::setPheromonesModel(Pheromones::Model model,
+                                    double diffusion_rate)
+{
+  if (!ready_to_run_) {
+    return false;
+  }
+  if (model == Pheromones::Model::PARTICLES && diffusion_rate != 0.) {
+    throw std::invalid_argument{
+        "only the pheromones of the FIELD model can diffuse"};
+  }
+
+  if (obstacles_.getNumberOfObstacles() != 0) {
+    Rectangle const bounds{obstacles_.getBoundingBox()};
+    to_anthill_ph_ =
+        Pheromones{Pheromones::Type::TO_ANTHILL,
+                   2. * Ant::CIRCLE_OF_VISION_RADIUS, bounds, model,
+                   deriveSeed(seed_, 2u)};
+    to_food_ph_ = Pheromones{Pheromones::Type::TO_FOOD,
+                             2. * Ant::CIRCLE_OF_VISION_RADIUS, bounds, model,
+                             deriveSeed(seed_, 3u)};
+  } else if (model == Pheromones::Model::PARTICLES) {
+    to_anthill_ph_ =
+        Pheromones{Pheromones::Type::TO_ANTHILL,
+                   2. * Ant::CIRCLE_OF_VISION_RADIUS, deriveSeed(seed_, 2u)};
+    to_food_ph_ = Pheromones{Pheromones::Type::TO_FOOD,
+                             2. * Ant::CIRCLE_OF_VISION_RADIUS,
+                             deriveSeed(seed_, 3u)};
+  } else {
+    kape::log << "[ERROR]:\tfrom Simulation::setPheromonesModel(Pheromones::"
+                 "Model model, double diffusion_rate):\n\t\t\tThe FIELD "
+                 "model needs a map enclosed by obstacles\n";
+    return false;
+  }
+
+  if (model == Pheromones::Model::FIELD) {
+    to_anthill_ph_.setDiffusionRate(diffusion_rate);
+    to_food_ph_.setDiffusionRate(diffusion_rate);
+  }
+  to_anthill_ph_.optimizePath(calculate_ants_average_distances_);
+  to_food_ph_.optimizePath(calculate_ants_average_distances_);
+  return true;
+}
+
+// may throw std::invalid_argument if sampling_period <= 0.
+bool Simulation::recordMetrics(std::string const& filepath,
+                               double sampling_period,
+                               std::vector<Metric> const& metrics)
+{
+  if (!(sampling_period > 0.)) {
+    throw std::invalid_argument{"the sampling period must be > 0."};
+  }
+  if (!ready_to_run_) {
+    return false;
+  }
+
+  metrics_recorder_.reset(); // the rows of the previous file are written
+  metrics_recorder_.emplace(filepath, metrics);
+  if (!metrics_recorder_->isGood()) {
+    metrics_recorder_.reset();
+    return false;
+  }
+  steps_between_metrics_samples_ = std::max(
+      std::size_t{1}, static_cast<std::size_t>(
+                          std::round(sampling_period / getSimulationDeltaT())));
+  steps_since_metrics_sample_ = 0;
+  metrics_steps_wall_time_    = std::chrono::duration<double>{0.};
+  return true;
+}
+
+void Simulation::run()
+{
+  if (!ready_to_run_ || !window_.has_value()) {
     return;
   }
 
-  while (window_.isOpen()) {
-    ants_.update(food_, to_anthill_ph_, to_food_ph_, anthill_, obstacles_,
-                 simulation_delta_t_);
-    to_anthill_ph_.updateParticlesEvaporation(simulation_delta_t_);
-    to_food_ph_.updateParticlesEvaporation(simulation_delta_t_);
+  // the simulation is updated on its own thread, which publishes a copy of
+  // what has to be drawn FRAMERATE times per second. The window stays on this
+  // thread, since its events must be handled by the thread that created it.
+  // Neither thread waits for the other: a slow display() doesn't slow down the
+  // simulation, and a slow update() doesn't freeze the window
+  std::mutex frames_mutex;
+  std::condition_variable new_frame_available;
+  // protected by frames_mutex
+  RenderFrame published_frame;
+  bool is_new_frame_published{false};
+  std::atomic<bool> stop_simulation{false};
+
+  std::future<void> simulation_thread{std::async(std::launch::async, [&] {
+    RenderFrame back_frame;
+    while (!stop_simulation.load(std::memory_order_relaxed)) {
+      update();
+
+      if (timeToRender()) {
+        loadRenderFrame(back_frame, ants_, food_, to_anthill_ph_, to_food_ph_,
+                        anthill_, FOOD_COLOR_, TO_ANTHILL_PHEROMONES_COLOR_,
+                        TO_FOOD_PHEROMONES_COLOR_);
+        {
+          std::lock_guard<std::mutex> const lock{frames_mutex};
+          std::swap(back_frame, published_frame);
+          is_new_frame_published = true;
+        }
+        new_frame_available.notify_one();
+      }
+    }
+  })};
+
+  RenderFrame front_frame;
+  bool has_frame{false};
+  // the layers of points stay on the graphics card while they don't change
+  PointsLayerBuffer food_buffer;
+  PointsLayerBuffer to_anthill_pheromones_buffer;
+  PointsLayerBuffer to_food_pheromones_buffer;
+  std::chrono::microseconds const microseconds_between_frames{1'000'000
+                                                              / FRAMERATE};
+  while (window_->isOpen()) {
+    {
+      std::unique_lock<std::mutex> lock{frames_mutex};
+      // the input is handled even if no new frame comes
+      new_frame_available.wait_for(
+          lock, microseconds_between_frames,
+          [&is_new_frame_published] { return is_new_frame_published; });
+      if (is_new_frame_published) {
+        std::swap(front_frame, published_frame);
+        is_new_frame_published = false;
+        has_frame              = true;
+      }
+    }
 
-    // only if it's a simulation where we know which is the optimal path
-    if (calculate_ants_average_distances_) {
-      if (timeToCalculateAverageDistances()) {
-        averageDistances(ants_, optimal_line_slope_, optimal_line_intercept_,
-                         average_ants_distance_from_line_);
+    if (has_frame) {
+      KAPE_PROFILE_SCOPE(timer, Phase::RENDERING);
+      window_->clear(BACKGROUND_COLOR_);
+      window_->draw(front_frame.ants, is_debug_);
+      window_->draw(front_frame.food, food_buffer);
+      window_->draw(front_frame.to_anthill_pheromones,
+                    to_anthill_pheromones_buffer);
+      window_->draw(front_frame.to_food_pheromones, to_food_pheromones_buffer);
+      window_->draw(front_frame.anthill, ANTHILL_COLOR_);
+      window_->draw(obstacles_, OBSTACLES_COLOR_);
+      if constexpr (PROFILING_ENABLED) {
+        window_->drawProfilerOverlay(profiler);
       }
+      window_->display();
     }
+    window_->inputHandling();
 
-    if (timeToRender()) {
-      window_.clear(BACKGROUND_COLOR_);
-      window_.draw(ants_, is_debug_);
-      window_.draw(food_, to_anthill_ph_, to_food_ph_, FOOD_COLOR_,
-                   TO_ANTHILL_PHEROMONES_COLOR_, TO_FOOD_PHEROMONES_COLOR_);
-      window_.draw(anthill_, ANTHILL_COLOR_);
-      window_.draw(obstacles_, OBSTACLES_COLOR_);
-      window_.display();
-      window_.inputHandling();
+    // the simulation thread ended early: it threw
+    if (simulation_thread.wait_for(std::chrono::seconds{0})
+        == std::future_status::ready) {
+      break;
     }
   }
 
+  stop_simulation = true;
+  simulation_thread.get(); // rethrows the exceptions of the simulation thread
+  if (metrics_recorder_.has_value()) {
+    metrics_recorder_->flush();
+  }
+
   if (calculate_ants_average_distances_) {
-    graphPoints(average_ants_distance_from_line_);
+    graphPoints(average_ants_distance_from_line_.getValues());
+  }
+}
+
+RunSummary Simulation::runHeadless(std::size_t number_of_steps,
+                                   double checkpoint_period,
+                                   std::string const& checkpoint_filepath)
+{
+  RunSummary summary{};
+  if (!ready_to_run_) {
+    return summary;
+  }
+
+  // 0: no checkpoints
+  std::size_t const steps_between_checkpoints{
+      checkpoint_period > 0.
+          ? std::max(std::size_t{1},
+                     static_cast<std::size_t>(
+                         std::round(checkpoint_period / getSimulationDeltaT())))
+          : 0};
+
+  int const initial_food_counter{anthill_.getFoodCounter()};
+  std::chrono::time_point<clock> const start{clock::now()};
+
+  for (std::size_t step{0}; step != number_of_steps; ++step) {
+    update();
+
+    if (steps_between_checkpoints != 0
+        && (step + 1) % steps_between_checkpoints == 0) {
+      saveSnapshotInBackground(checkpoint_filepath);
+      ++summary.number_of_checkpoints;
+      log.write<LogLevel::INFO>("checkpoint", "step", step + 1, "file",
+                                checkpoint_filepath);
+    }
   }
+
+  std::chrono::duration<double> const wall_time{clock::now() - start};
+
+  // the last checkpoint must be on disk when the run is over
+  if (pending_snapshot_.valid()) {
+    pending_snapshot_.get();
+  }
+  // and so must the metrics sampled
+  if (metrics_recorder_.has_value()) {
+    metrics_recorder_->flush();
+  }
+
+  summary.steps             = number_of_steps;
+  summary.simulated_time    = static_cast<double>(number_of_steps)
+                            * getSimulationDeltaT();
+  summary.wall_time         = wall_time.count();
+  summary.food_collected    = anthill_.getFoodCounter() - initial_food_counter;
+  summary.food_left         = food_.getNumberOfFoodParticles();
+  summary.number_of_ants    = ants_.getNumberOfAnts();
+  summary.number_of_threads = ants_.getNumberOfThreads();
+  summary.number_of_to_anthill_pheromones =
+      to_anthill_ph_.getNumberOfPheromones();
+  summary.number_of_to_food_pheromones = to_food_ph_.getNumberOfPheromones();
+
+  return summary;
+}
+
+void Simulation::logAverageAntsDistances() const
+{
+  if (!calculate_ants_average_distances_) {
+    return;
+  }
+
+  // a single record, however many points there are
+  std::ostringstream results;
+  results << "\nResults of the optimization:";
+  int index{0};
+  for (auto point : average_ants_distance_from_line_.getValues()) {
+    results << "(" << index << ", " << point << ")\n";
+    ++index;
+  }
+  log << results.str();
+}
+std::vector<char> Simulation::makeSnapshot() const
+{
+  SnapshotWriter snapshot;
+  writeSnapshotHeader(snapshot);
+  snapshot.writeString(simulation_name_);
+  snapshot.write(simulation_delta_t_);
+  snapshot.write(simulated_time_);
+  snapshot.write(time_since_last_ants_average_distances_check_);
+  average_ants_distance_from_line_.saveToSnapshot(snapshot);
+  anthill_.saveToSnapshot(snapshot);
+  food_.saveToSnapshot(snapshot);
+  ants_.saveToSnapshot(snapshot);
+  to_anthill_ph_.saveToSnapshot(snapshot);
+  to_food_ph_.saveToSnapshot(snapshot);
+  return snapshot.releaseBuffer();
+}
+
+bool Simulation::saveSnapshot(std::string const& filepath)
+{
+  if (!ready_to_run_) {
+    log << "[ERROR]:\tfrom Simulation::saveSnapshot(std::string const& "
+           "filepath):\n\t\t\tThere's no simulation loaded to be saved\n";
+    return false;
+  }
+  // the older snapshot mustn't overwrite this one
+  if (pending_snapshot_.valid()) {
+    pending_snapshot_.get();
+  }
+  return saveSnapshotToFile(makeSnapshot(), filepath);
 }
-} // namespace kape
+
+void Simulation::saveSnapshotInBackground(std::string const& filepath)
+{
+  if (!ready_to_run_) {
+    log << "[ERROR]:\tfrom Simulation::saveSnapshotInBackground(std::string "
+           "const& filepath):\n\t\t\tThere's no simulation loaded to be "
+           "saved\n";
+    return;
+  }
+  if (pending_snapshot_.valid()) {
+    pending_snapshot_.get();
+  }
+  // copying the state is fast, writing it to disk may not be
+  pending_snapshot_ = std::async(
+      std::launch::async,
+      [filepath](std::vector<char> const& bytes) {
+        return saveSnapshotToFile(bytes, filepath);
+      },
+      makeSnapshot());
+}
+
+bool Simulation::loadSnapshot(std::string const& filepath)
+{
+  std::optional<std::vector<char>> const bytes{loadSnapshotFromFile(filepath)};
+  if (!bytes.has_value()) {
+    ready_to_run_ = false;
+    return false;
+  }
+
+  try {
+    SnapshotReader snapshot{*bytes};
+    readSnapshotHeader(snapshot);
+    std::string const simulation_name{snapshot.readString()};
+    double const simulation_delta_t{snapshot.read<double>()};
+    checkSnapshot(simulation_delta_t == simulation_delta_t_,
+                  "it was taken with a different time step");
+    double const simulated_time{snapshot.read<double>()};
+    double const time_since_last_ants_average_distances_check{
+        snapshot.read<double>()};
+    DecimatedSeries average_ants_distance_from_line;
+    average_ants_distance_from_line.loadFromSnapshot(snapshot);
+
+    // the obstacles, the configuration and the textures aren't in the snapshot.
+    // Obstacles::loadFromFile() appends to the ones already loaded
+    obstacles_ = Obstacles{};
+    if (!loadSimulationByName(simulation_name)) {
+      return false;
+    }
+    // if one of them throws the simulation can't run
+    anthill_.loadFromSnapshot(snapshot);
+    food_.loadFromSnapshot(snapshot);
+    ants_.loadFromSnapshot(snapshot);
+    to_anthill_ph_.loadFromSnapshot(snapshot);
+    to_food_ph_.loadFromSnapshot(snapshot);
+    checkSnapshot(snapshot.isAtEnd(), "unexpected data at its end");
+
+    simulated_time_ = simulated_time;
+    time_since_last_ants_average_distances_check_ =
+        time_since_last_ants_average_distances_check;
+    average_ants_distance_from_line_ =
+        std::move(average_ants_distance_from_line);
+  } catch (std::runtime_error const& error) {
+    log << "[ERROR]:\tfrom Simulation::loadSnapshot(std::string const& "
+           "filepath):\n\t\t\tCouldn't load \""
+        << filepath << "\": " << error.what() << '\n';
+    ready_to_run_ = false;
+    return false;
+  }
+
+  ready_to_run_ = true;
+  return true;
+}
+
+} // namespace kape
\ No newline at end of file
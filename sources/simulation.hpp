@@ -3,13 +3,32 @@
 #include "ants.hpp"
 #include "drawing.hpp"
 #include "environment.hpp"
+#include "metrics.hpp"
 #include <SFML/Graphics.hpp>
 #include <chrono>
 #include <filesystem>
+#include <future>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace kape {
 
+// statistics collected by Simulation::runHeadless()
+struct RunSummary
+{
+  std::size_t steps;
+  double simulated_time; // in seconds
+  double wall_time;      // in seconds
+  int food_collected;
+  std::size_t food_left;
+  std::size_t number_of_ants;
+  std::size_t number_of_threads; // used to update the ants
+  std::size_t number_of_to_anthill_pheromones;
+  std::size_t number_of_to_food_pheromones;
+  std::size_t number_of_checkpoints; // snapshots saved during the run
+};
+
 class Simulation
 {
  private:
@@ -35,6 +54,9 @@ class Simulation
   inline static sf::Color const CHOSEN_BUTTON_COLOR_{90, 99, 156};
   using clock = std::chrono::steady_clock;
 
+  unsigned int const seed_;
+  // name of the folder of the simulation loaded, e.g. "map_1"
+  std::string simulation_name_;
   Obstacles obstacles_;
   Anthill anthill_;
   Food food_;
@@ -42,12 +64,27 @@ class Simulation
   Pheromones to_anthill_ph_;
   Pheromones to_food_ph_;
   double const simulation_delta_t_;
+  // every update() advances the ants by number_of_substeps_ steps of
+  // simulation_delta_t_
+  std::size_t number_of_substeps_;
+  // simulated seconds since the simulation was loaded from its folder
+  double simulated_time_;
   std::chrono::time_point<clock> last_frame_update_;
+  // the snapshot being written in the background, if any
+  std::future<bool> pending_snapshot_;
 
   bool ready_to_run_;
-  Window window_;
+  // empty if the simulation is headless
+  std::optional<Window> window_;
   double time_since_last_ants_average_distances_check_;
-  std::vector<double> average_ants_distance_from_line_;
+  // at most DecimatedSeries::DEFAULT_CAPACITY points, however long the run
+  DecimatedSeries average_ants_distance_from_line_;
+  // empty if the metrics aren't being recorded
+  std::optional<MetricsRecorder> metrics_recorder_;
+  std::size_t steps_between_metrics_samples_;
+  std::size_t steps_since_metrics_sample_;
+  // wall time spent in update() since the last sample
+  std::chrono::duration<double> metrics_steps_wall_time_;
   bool is_debug_;
   bool calculate_ants_average_distances_;
   double optimal_line_slope_;
@@ -62,16 +99,104 @@ class Simulation
 
   bool timeToRender();
   bool timeToCalculateAverageDistances();
+  // the values of all the metrics now, for metrics_recorder_
+  MetricsSample makeMetricsSample();
+  // advances the simulation by getSimulationDeltaT()
+  void update();
+  // the whole state of the simulation, apart from what's loaded from its
+  // folder (obstacles, configuration and textures)
+  std::vector<char> makeSnapshot() const;
 
  public:
-  explicit Simulation();
+  inline static unsigned int const DEFAULT_SEED_{44444444u};
+  // an update() can't go past the period between two pheromone releases of an
+  // ant, 0.1s
+  inline static std::size_t const MAX_NUMBER_OF_SUBSTEPS_{10};
+  inline static std::string const DEFAULT_SNAPSHOT_FILEPATH_{
+      "./snapshot.kape"};
+
+  // if headless is true no window is opened and the simulation can only be run
+  // through runHeadless()
+  // number_of_threads are used to update the ants, 0 means one per hardware
+  // thread. The results don't depend on it
+  // may throw std::runtime_error if !headless and it fails to open the window
+  explicit Simulation(bool headless = false, unsigned int seed = DEFAULT_SEED_,
+                      std::size_t number_of_threads = 0);
   // returns:
   //    - true if it correctly loaded the simulation and is ready to run
   //    - false if it failed to load the simulation and is therefore unable to
   //      run
   bool chooseAndLoadSimulation();
+  // loads the simulation with the given name from the simulations folder, e.g.
+  // "map_1". If simulation_name is empty DEFAULT_SIMULATION_NAME_ is loaded
+  // returns:
+  //    - true if it correctly loaded the simulation and is ready to run
+  //    - false otherwise
+  bool loadSimulationByName(std::string const& simulation_name);
   bool isReadyToRun() const;
+  bool isHeadless() const;
+  // the simulated time every update advances by
+  double getSimulationDeltaT() const;
+  // from the next update on, the ants move number_of_substeps steps of
+  // SIMULATION_DELTA_T_ per update, and the ones far from obstacles, food and
+  // the anthill look around only after the last one. The rest of the
+  // simulation is updated once per update. 1 is the default
+  // may throw std::invalid_argument if number_of_substeps isn't in
+  //     [1, MAX_NUMBER_OF_SUBSTEPS_]
+  void setNumberOfSubsteps(std::size_t number_of_substeps);
+  std::size_t getNumberOfSubsteps() const;
+  double getSimulatedTime() const;
+  // empty if the simulation doesn't know its optimal path. Sampled every
+  // simulated second, until there are too many points: then pairs of them
+  // are averaged, and so on (see DecimatedSeries)
+  std::vector<double> const& getAverageAntsDistances() const;
+  // writes getAverageAntsDistances() to the logs, e.g. at the end of a
+  // headless run, where there's no window to graph them into. Nothing if the
+  // simulation doesn't know its optimal path
+  void logAverageAntsDistances() const;
+
+  // the simulation must be already loaded: they override what was read from
+  // its folder and return false if it isn't ready to run
+  // replaces the ants with number_of_ants new ones around the anthill
+  bool setNumberOfAnts(std::size_t number_of_ants);
+  // may throw std::invalid_argument if decrease_percentage_amount isn't in
+  // (0., 1.)
+  bool setPheromonesDecreasePercentageAmount(double decrease_percentage_amount);
+  // replaces the pheromones with empty ones of the given model. The FIELD
+  // model needs a map enclosed by obstacles, to lay out its grid: returns false
+  // otherwise. Better called before setPheromonesDecreasePercentageAmount(),
+  // since the new pheromones evaporate at the rate read from the folder
+  // may throw std::invalid_argument if diffusion_rate isn't in [0., 1.) or
+  // it's not 0. for the PARTICLES model
+  bool setPheromonesModel(Pheromones::Model model, double diffusion_rate = 0.);
+  // from the next step on, the metrics are appended to the CSV file at
+  // filepath every sampling_period simulated seconds, until the simulation is
+  // destroyed. If metrics is empty all of them are recorded
+  // returns false if the simulation isn't ready to run, the file couldn't be
+  // opened or it already has other columns
+  // may throw std::invalid_argument if sampling_period <= 0.
+  bool recordMetrics(std::string const& filepath, double sampling_period,
+                     std::vector<Metric> const& metrics = {});
+  // runs the simulation in the window until it's closed
   void run();
+  // runs number_of_steps updates as fast as possible, without rendering.
+  // If checkpoint_period > 0. a snapshot is saved to checkpoint_filepath every
+  // checkpoint_period simulated seconds, without waiting for it to be written
+  RunSummary runHeadless(
+      std::size_t number_of_steps, double checkpoint_period = 0.,
+      std::string const& checkpoint_filepath = DEFAULT_SNAPSHOT_FILEPATH_);
+
+  // returns false if the simulation isn't ready to run or the write failed
+  bool saveSnapshot(std::string const& filepath = DEFAULT_SNAPSHOT_FILEPATH_);
+  // the state is copied immediately, then it's written on another thread. If
+  // the previous snapshot is still being written it waits for it first
+  void saveSnapshotInBackground(
+      std::string const& filepath = DEFAULT_SNAPSHOT_FILEPATH_);
+  // loads the simulation the snapshot was taken from, then restores its state
+  // returns:
+  //    - true if it correctly loaded the snapshot and is ready to run
+  //    - false otherwise
+  bool loadSnapshot(std::string const& filepath = DEFAULT_SNAPSHOT_FILEPATH_);
 };
 } // namespace kape
 
@@ -0,0 +1,175 @@
+#include "snapshot.hpp"
+#include "logger.hpp"
+#include <cstdio> // for std::rename
+#include <cstring>
+#include <fstream>
+
+namespace kape {
+
+// SnapshotWriter class implementation---------------------
+SnapshotWriter::SnapshotWriter()
+    : buffer_{}
+{}
+
+void SnapshotWriter::writeBytes(void const* bytes, std::size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  std::size_t const old_size{buffer_.size()};
+  buffer_.resize(old_size + size);
+  std::memcpy(buffer_.data() + old_size, bytes, size);
+}
+
+void SnapshotWriter::writeString(std::string const& string)
+{
+  write<std::uint64_t>(string.size());
+  writeBytes(string.data(), string.size());
+}
+
+std::vector<char> const& SnapshotWriter::getBuffer() const
+{
+  return buffer_;
+}
+
+std::vector<char> SnapshotWriter::releaseBuffer()
+{
+  std::vector<char> buffer{std::move(buffer_)};
+  buffer_.clear();
+  return buffer;
+}
+
+// SnapshotReader class implementation---------------------
+SnapshotReader::SnapshotReader(std::vector<char> const& bytes)
+    : bytes_{bytes.data()}
+    , size_{bytes.size()}
+    , position_{0}
+{}
+
+void SnapshotReader::readBytes(void* bytes, std::size_t size)
+{
+  if (size > size_ - position_) {
+    throw std::runtime_error{"the snapshot is truncated"};
+  }
+  if (size == 0) {
+    return;
+  }
+  std::memcpy(bytes, bytes_ + position_, size);
+  position_ += size;
+}
+
+std::string SnapshotReader::readString()
+{
+  std::uint64_t const size{read<std::uint64_t>()};
+  if (size > size_ - position_) {
+    throw std::runtime_error{"the snapshot is truncated"};
+  }
+  std::string string(static_cast<std::size_t>(size), '\0');
+  readBytes(string.data(), string.size());
+  return string;
+}
+
+bool SnapshotReader::isAtEnd() const
+{
+  return position_ == size_;
+}
+
+void checkSnapshot(bool condition, std::string const& what)
+{
+  if (!condition) {
+    throw std::runtime_error{"badly formatted snapshot: " + what};
+  }
+}
+
+// a machine with the other byte order reads it as 0x04030201
+std::uint32_t const BYTE_ORDER_MARK{0x01020304u};
+
+void writeSnapshotHeader(SnapshotWriter& snapshot)
+{
+  for (char character : SNAPSHOT_MAGIC) {
+    snapshot.write(character);
+  }
+  snapshot.write(SNAPSHOT_VERSION);
+  snapshot.write(BYTE_ORDER_MARK);
+}
+
+// may throw std::runtime_error if the header isn't the one written by
+// writeSnapshotHeader() on a machine with the same byte order
+void readSnapshotHeader(SnapshotReader& snapshot)
+{
+  for (char character : SNAPSHOT_MAGIC) {
+    if (snapshot.read<char>() != character) {
+      throw std::runtime_error{"the file isn't a snapshot"};
+    }
+  }
+  std::uint32_t const version{snapshot.read<std::uint32_t>()};
+  if (version != SNAPSHOT_VERSION) {
+    throw std::runtime_error{"the snapshot has version "
+                             + std::to_string(version) + ", expected "
+                             + std::to_string(SNAPSHOT_VERSION)};
+  }
+  if (snapshot.read<std::uint32_t>() != BYTE_ORDER_MARK) {
+    throw std::runtime_error{
+        "the snapshot was written on a machine with a different byte order"};
+  }
+}
+
+bool saveSnapshotToFile(std::vector<char> const& bytes,
+                        std::string const& filepath)
+{
+  std::string const temporary_filepath{filepath + ".tmp"};
+  {
+    std::ofstream file_out{temporary_filepath,
+                           std::ios::out | std::ios::binary | std::ios::trunc};
+    if (!file_out.is_open()) {
+      kape::log << "[ERROR]:\tfrom saveSnapshotToFile(std::vector<char> const& "
+                   "bytes, std::string const& filepath):\n\t\t\tCouldn't open "
+                   "file at \""
+                << temporary_filepath << "\"\n";
+      return false;
+    }
+    file_out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file_out) {
+      kape::log << "[ERROR]:\tfrom saveSnapshotToFile(std::vector<char> const& "
+                   "bytes, std::string const& filepath):\n\t\t\tCouldn't write "
+                   "to \""
+                << temporary_filepath << "\"\n";
+      return false;
+    }
+  }
+
+  if (std::rename(temporary_filepath.c_str(), filepath.c_str()) != 0) {
+    kape::log << "[ERROR]:\tfrom saveSnapshotToFile(std::vector<char> const& "
+                 "bytes, std::string const& filepath):\n\t\t\tCouldn't "
+                 "rename \""
+              << temporary_filepath << "\" to \"" << filepath << "\"\n";
+    return false;
+  }
+  return true;
+}
+
+std::optional<std::vector<char>>
+loadSnapshotFromFile(std::string const& filepath)
+{
+  std::ifstream file_in{filepath,
+                        std::ios::in | std::ios::binary | std::ios::ate};
+  if (!file_in.is_open()) {
+    kape::log << "[ERROR]:\tfrom loadSnapshotFromFile(std::string const& "
+                 "filepath):\n\t\t\tCouldn't open file at \""
+              << filepath << "\"\n";
+    return std::nullopt;
+  }
+
+  std::streamsize const size{file_in.tellg()};
+  std::vector<char> bytes(static_cast<std::size_t>(size));
+  file_in.seekg(0);
+  if (!file_in.read(bytes.data(), size)) {
+    kape::log << "[ERROR]:\tfrom loadSnapshotFromFile(std::string const& "
+                 "filepath):\n\t\t\tCouldn't read \""
+              << filepath << "\"\n";
+    return std::nullopt;
+  }
+  return bytes;
+}
+
+} // namespace kape
@@ -0,0 +1,138 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace kape {
+
+// a snapshot is the state of a simulation saved as raw bytes, in the byte
+// order of the machine that wrote it: the arrays are copied in and out with a
+// single memcpy each. It can only be read by a build with the same
+// SNAPSHOT_VERSION on a machine with the same byte order
+
+// appends values to an in-memory buffer
+class SnapshotWriter
+{
+ private:
+  std::vector<char> buffer_;
+
+  void writeBytes(void const* bytes, std::size_t size);
+
+ public:
+  explicit SnapshotWriter();
+
+  // T must be an arithmetic type or an enum
+  template<class T>
+  void write(T value)
+  {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    writeBytes(&value, sizeof(T));
+  }
+  // writes the size and then all the elements at once
+  template<class T, class Allocator>
+  void writeArray(std::vector<T, Allocator> const& values)
+  {
+    static_assert(std::is_arithmetic_v<T>);
+    write<std::uint64_t>(values.size());
+    writeBytes(values.data(), values.size() * sizeof(T));
+  }
+  void writeString(std::string const& string);
+  // the random engines are saved through their textual representation, the
+  // only portable way to get their state
+  template<class Engine>
+  void writeRandomEngine(Engine const& engine)
+  {
+    std::ostringstream state;
+    state << engine;
+    writeString(state.str());
+  }
+
+  std::vector<char> const& getBuffer() const;
+  // leaves the writer empty
+  std::vector<char> releaseBuffer();
+};
+
+// reads the values back, in the same order they were written
+// every read may throw std::runtime_error if the snapshot is shorter than
+// expected
+class SnapshotReader
+{
+ private:
+  char const* bytes_;
+  std::size_t size_;
+  std::size_t position_;
+
+  void readBytes(void* bytes, std::size_t size);
+
+ public:
+  // the bytes aren't copied: they must outlive the reader
+  explicit SnapshotReader(std::vector<char> const& bytes);
+
+  template<class T>
+  T read()
+  {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    T value;
+    readBytes(&value, sizeof(T));
+    return value;
+  }
+  // may throw std::runtime_error if the size is larger than the bytes left
+  template<class T, class Allocator>
+  void readArray(std::vector<T, Allocator>& values)
+  {
+    static_assert(std::is_arithmetic_v<T>);
+    std::uint64_t const size{read<std::uint64_t>()};
+    if (size > (size_ - position_) / sizeof(T)) {
+      throw std::runtime_error{"the snapshot is truncated"};
+    }
+    values.resize(static_cast<std::size_t>(size));
+    readBytes(values.data(), values.size() * sizeof(T));
+  }
+  std::string readString();
+  // may throw std::runtime_error if the state is badly formatted
+  template<class Engine>
+  void readRandomEngine(Engine& engine)
+  {
+    std::istringstream state{readString()};
+    state >> engine;
+    if (state.fail()) {
+      throw std::runtime_error{"badly formatted random engine in the snapshot"};
+    }
+  }
+
+  bool isAtEnd() const;
+};
+
+// written at the beginning of every snapshot
+inline constexpr char SNAPSHOT_MAGIC[8]{'K', 'A', 'P', 'E', 'S', 'N', 'A', 'P'};
+// to be increased every time the content of a snapshot changes
+inline constexpr std::uint32_t SNAPSHOT_VERSION{3};
+
+// throws std::runtime_error if !condition: used to validate the values read
+// from a snapshot
+void checkSnapshot(bool condition, std::string const& what);
+
+// writes the magic, the version and a value that tells the byte order
+void writeSnapshotHeader(SnapshotWriter& snapshot);
+// may throw std::runtime_error if the header isn't the one written by
+// writeSnapshotHeader() on a machine with the same byte order
+void readSnapshotHeader(SnapshotReader& snapshot);
+
+// the bytes are first written to filepath + ".tmp", which is then renamed: an
+// interrupted write never leaves a half-written snapshot at filepath
+bool saveSnapshotToFile(std::vector<char> const& bytes,
+                        std::string const& filepath);
+// reads the whole file at once, returns an empty optional if it fails
+std::optional<std::vector<char>>
+loadSnapshotFromFile(std::string const& filepath);
+
+} // namespace kape
+
+#endif
@@ -0,0 +1,304 @@
+#include "sweep.hpp"
+#include "logger.hpp"
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace kape {
+
+std::vector<SweepRun> expandSweepSpec(SweepSpec const& spec)
+{
+  std::vector<SweepRun> runs;
+  runs.reserve(spec.simulation_names.size() * spec.seeds.size()
+               * spec.numbers_of_ants.size()
+               * spec.decrease_percentage_amounts.size());
+
+  for (auto const& simulation_name : spec.simulation_names) {
+    for (unsigned int seed : spec.seeds) {
+      for (std::size_t number_of_ants : spec.numbers_of_ants) {
+        for (double decrease_percentage_amount :
+             spec.decrease_percentage_amounts) {
+          runs.push_back(SweepRun{simulation_name, seed, number_of_ants,
+                                  decrease_percentage_amount});
+        }
+      }
+    }
+  }
+  return runs;
+}
+
+// reads all the names left in line, the ones with spaces are between quotes,
+// e.g. "path_check 1"
+std::vector<std::string> parseSweepNames(std::istringstream& line)
+{
+  std::vector<std::string> names;
+  std::string name;
+  while (line >> std::quoted(name)) {
+    names.push_back(name);
+  }
+  return names;
+}
+
+// reads all the numbers left in line
+// throws std::invalid_argument if one of them isn't a valid T
+template<class T>
+std::vector<T> parseSweepNumbers(std::istringstream& line)
+{
+  std::vector<T> numbers;
+  std::string token;
+  while (line >> token) {
+    if constexpr (std::is_floating_point_v<T>) {
+      try {
+        std::size_t parsed_characters{0};
+        numbers.push_back(static_cast<T>(std::stod(token, &parsed_characters)));
+        if (parsed_characters != token.size()) {
+          throw std::invalid_argument{token};
+        }
+      } catch (std::logic_error const&) { // not a number or out of range
+        throw std::invalid_argument{"invalid value \"" + token + "\""};
+      }
+    } else {
+      numbers.push_back(parseUnsignedNumber<T>(token));
+    }
+  }
+  return numbers;
+}
+
+std::optional<SweepSpec> loadSweepSpecFromFile(std::string const& filepath)
+{
+  std::ifstream file_in{filepath, std::ios::in};
+
+  // failed to open the file
+  if (!file_in.is_open()) {
+    kape::log << "[ERROR]:\tfrom loadSweepSpecFromFile(std::string const& "
+                 "filepath):\n\t\t\tCouldn't open file at \""
+              << filepath << "\"\n";
+    return std::nullopt;
+  }
+
+  SweepSpec spec{{}, {}, {0}, {0.}, 0., 0.};
+  std::vector<double> simulated_time;
+  std::vector<double> sample_period;
+  bool reached_end{false};
+
+  try {
+    std::string line_string;
+    while (!reached_end && std::getline(file_in, line_string)) {
+      std::istringstream line{line_string};
+      std::string key;
+      if (!(line >> key)) { // empty line
+        continue;
+      }
+
+      if (key == "END") {
+        reached_end = true;
+      } else if (key == "maps") {
+        spec.simulation_names = parseSweepNames(line);
+      } else if (key == "seeds") {
+        spec.seeds = parseSweepNumbers<unsigned int>(line);
+      } else if (key == "ants") {
+        spec.numbers_of_ants = parseSweepNumbers<std::size_t>(line);
+      } else if (key == "evaporation") {
+        spec.decrease_percentage_amounts = parseSweepNumbers<double>(line);
+      } else if (key == "seconds") {
+        simulated_time = parseSweepNumbers<double>(line);
+      } else if (key == "sample_period") {
+        sample_period = parseSweepNumbers<double>(line);
+      } else {
+        throw std::invalid_argument{"unknown parameter \"" + key + "\""};
+      }
+    }
+
+    if (!reached_end) {
+      throw std::invalid_argument{"missing END"};
+    }
+    if (spec.simulation_names.empty() || spec.seeds.empty()
+        || spec.numbers_of_ants.empty()
+        || spec.decrease_percentage_amounts.empty()) {
+      throw std::invalid_argument{"every parameter needs at least one value"};
+    }
+    if (simulated_time.size() != 1 || !(simulated_time[0] > 0.)) {
+      throw std::invalid_argument{"\"seconds\" must be a single value > 0"};
+    }
+    if (sample_period.size() > 1
+        || (sample_period.size() == 1 && !(sample_period[0] > 0.))) {
+      throw std::invalid_argument{
+          "\"sample_period\" must be a single value > 0"};
+    }
+    if (std::any_of(
+            spec.decrease_percentage_amounts.begin(),
+            spec.decrease_percentage_amounts.end(),
+            [](double amount) { return !(amount >= 0. && amount < 1.); })) {
+      throw std::invalid_argument{"\"evaporation\" values must be in [0., 1.)"};
+    }
+  } catch (std::invalid_argument const& error) {
+    kape::log << "[ERROR]:\tfrom loadSweepSpecFromFile(std::string const& "
+                 "filepath):\n\t\t\tTried to load from \""
+              << filepath << "\" but it was badly formatted: " << error.what()
+              << '\n';
+    return std::nullopt;
+  }
+
+  spec.simulated_time = simulated_time[0];
+  // a single sample at the end of the run
+  spec.sample_period =
+      sample_period.empty() ? spec.simulated_time : sample_period[0];
+  return spec;
+}
+
+// names of the simulations can contain spaces, e.g. "path_check 1"
+std::string quoteCsvField(std::string const& field)
+{
+  std::string quoted{'"'};
+  for (char character : field) {
+    if (character == '"') {
+      quoted += '"';
+    }
+    quoted += character;
+  }
+  return quoted + '"';
+}
+
+// the columns of a row that tell which run it's about: the simulation, the
+// seed, the number of ants and the evaporation, each followed by a comma
+std::string formatSweepRunColumns(SweepRun const& run)
+{
+  std::ostringstream columns;
+  columns << quoteCsvField(run.simulation_name) << ',' << run.seed << ','
+          << run.number_of_ants << ',' << run.decrease_percentage_amount << ',';
+  return columns.str();
+}
+
+// runs a single simulation of the sweep and returns its row of results,
+// without the run's index
+// ok is set to false if the simulation couldn't be loaded
+std::string runSweepSimulation(SweepRun const& run, SweepSpec const& spec,
+                               bool& ok)
+{
+  std::ostringstream row;
+  row << formatSweepRunColumns(run);
+
+  Simulation simulation{true, run.seed, 1};
+  ok = simulation.loadSimulationByName(run.simulation_name)
+    && (run.number_of_ants == 0
+        || simulation.setNumberOfAnts(run.number_of_ants))
+    && (run.decrease_percentage_amount == 0.
+        || simulation.setPheromonesDecreasePercentageAmount(
+            run.decrease_percentage_amount));
+  if (!ok) {
+    row << "failed,,,,,,,";
+    return row.str();
+  }
+
+  double const delta_t{simulation.getSimulationDeltaT()};
+  std::size_t const number_of_steps{
+      static_cast<std::size_t>(std::ceil(spec.simulated_time / delta_t))};
+  std::size_t const steps_between_samples{std::max(
+      std::size_t{1},
+      static_cast<std::size_t>(std::round(spec.sample_period / delta_t)))};
+
+  std::ostringstream food_collected_over_time;
+  RunSummary last_summary{};
+  int food_collected{0};
+  double wall_time{0.};
+  for (std::size_t steps_done{0}; steps_done < number_of_steps;) {
+    std::size_t const steps{
+        std::min(steps_between_samples, number_of_steps - steps_done)};
+    last_summary = simulation.runHeadless(steps);
+    steps_done += steps;
+    food_collected += last_summary.food_collected;
+    wall_time += last_summary.wall_time;
+    food_collected_over_time << (steps_done == steps ? "" : ";")
+                             << food_collected;
+  }
+
+  std::ostringstream average_distances;
+  for (double distance : simulation.getAverageAntsDistances()) {
+    average_distances << (average_distances.tellp() == 0 ? "" : ";")
+                      << distance;
+  }
+
+  row << "ok," << number_of_steps << ',' << wall_time << ','
+      << last_summary.number_of_ants << ',' << food_collected << ','
+      << last_summary.food_left << ',' << food_collected_over_time.str() << ','
+      << average_distances.str();
+  return row.str();
+}
+
+bool runSweep(SweepSpec const& spec, std::string const& results_filepath,
+              std::size_t number_of_concurrent_runs)
+{
+  std::ofstream file_out{results_filepath, std::ios::out | std::ios::trunc};
+
+  // failed to open the file
+  if (!file_out.is_open()) {
+    kape::log << "[ERROR]:\tfrom runSweep(SweepSpec const& spec, std::string "
+                 "const& results_filepath, std::size_t "
+                 "number_of_concurrent_runs):\n\t\t\tCouldn't open file at \""
+              << results_filepath << "\"\n";
+    return false;
+  }
+
+  std::vector<SweepRun> const runs{expandSweepSpec(spec)};
+  if (number_of_concurrent_runs == 0) {
+    number_of_concurrent_runs = std::thread::hardware_concurrency();
+  }
+  number_of_concurrent_runs =
+      std::clamp(number_of_concurrent_runs, std::size_t{1},
+                 std::max(runs.size(), std::size_t{1}));
+
+  file_out << "run,map,seed,ants,decrease_percentage_amount,status,steps,"
+              "wall_time,number_of_ants,food_collected,food_left,"
+              "food_collected_over_time,average_distances\n";
+
+  std::mutex results_mutex;
+  std::size_t runs_ended{0};
+  std::size_t runs_failed{0};
+
+  ThreadPool thread_pool{number_of_concurrent_runs};
+  thread_pool.run(runs.size(), [&](std::size_t index) {
+    bool ok{false};
+    std::string row;
+    try {
+      row = runSweepSimulation(runs[index], spec, ok);
+    } catch (std::exception const& error) {
+      ok = false;
+      kape::log << "[ERROR]:\tfrom runSweep(SweepSpec const& spec, std::string "
+                   "const& results_filepath, std::size_t "
+                   "number_of_concurrent_runs):\n\t\t\tThe run "
+                << index << " threw: " << error.what() << '\n';
+      row = formatSweepRunColumns(runs[index]) + "failed,,,,,,,";
+    }
+
+    log.write<LogLevel::INFO>("sweep_run_ended", "run", index, "map",
+                              runs[index].simulation_name, "seed",
+                              runs[index].seed, "ok", ok);
+
+    std::lock_guard<std::mutex> const lock{results_mutex};
+    // flushed, so that the rows of the runs ended are kept even if the sweep
+    // is interrupted
+    file_out << index << ',' << row << std::endl;
+    ++runs_ended;
+    if (!ok) {
+      ++runs_failed;
+    }
+    std::cout << "[INFO]: run " << runs_ended << '/' << runs.size()
+              << " ended (" << runs[index].simulation_name << ", seed "
+              << runs[index].seed << ")" << (ok ? "" : " FAILED") << '\n';
+  });
+
+  return runs_failed == 0 && file_out.good();
+}
+
+} // namespace kape
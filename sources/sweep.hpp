@@ -0,0 +1,84 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace kape {
+
+// token must be a whole non negative integer that fits in a T, e.g. a seed
+// read from the command line or from a sweep file. std::stoul would silently
+// accept negative numbers
+// may throw std::invalid_argument if it isn't
+template<class T>
+T parseUnsignedNumber(std::string const& token)
+{
+  try {
+    std::size_t parsed_characters{0};
+    long long const number{std::stoll(token, &parsed_characters)};
+    if (parsed_characters == token.size() && number >= 0
+        && static_cast<unsigned long long>(number)
+               <= std::numeric_limits<T>::max()) {
+      return static_cast<T>(number);
+    }
+  } catch (std::logic_error const&) { // not a number or out of range
+  }
+  throw std::invalid_argument{"invalid value \"" + token + "\""};
+}
+
+// a parameter sweep: one headless simulation is run for every combination of
+// the values below
+struct SweepSpec
+{
+  // names of the folders in ./assets/simulations, e.g. "map_1"
+  std::vector<std::string> simulation_names;
+  std::vector<unsigned int> seeds;
+  // 0: the number of ants read from the simulation's folder
+  std::vector<std::size_t> numbers_of_ants;
+  // 0.: the evaporation chosen by the simulation's configuration
+  std::vector<double> decrease_percentage_amounts;
+  double simulated_time; // of each run, in seconds
+  double sample_period;  // between two samples of the food collected, in s
+};
+
+// one of the combinations of a SweepSpec
+struct SweepRun
+{
+  std::string simulation_name;
+  unsigned int seed;
+  std::size_t number_of_ants;
+  double decrease_percentage_amount;
+};
+
+// the runs in the order they are started: the last value changes first
+std::vector<SweepRun> expandSweepSpec(SweepSpec const& spec);
+
+// the file has one line per parameter, with its values separated by spaces,
+// and ends with END:
+//    maps map_1 map_2
+//    seeds 1 2 3
+//    ants 0 250
+//    evaporation 0 0.02
+//    seconds 120
+//    sample_period 10
+//    END
+// the names with spaces must be between quotes, e.g. "path_check 1".
+// "ants", "evaporation" and "sample_period" can be omitted.
+// returns an empty optional if it fails
+std::optional<SweepSpec> loadSweepSpecFromFile(std::string const& filepath);
+
+// runs all the combinations of spec, number_of_concurrent_runs at a time (0:
+// one per hardware thread), each on a single thread. Only the runs in progress
+// are kept in memory: a CSV row is written to results_filepath as soon as each
+// of them ends, so the rows are in the order the runs ended
+// returns false if the results couldn't be written or at least one run failed
+bool runSweep(SweepSpec const& spec, std::string const& results_filepath,
+              std::size_t number_of_concurrent_runs = 0);
+
+} // namespace kape
+
+#endif
@@ -0,0 +1,192 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "sweep.hpp"
+#include "doctest.h"
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// writes contents to filepath and loads it as a sweep
+std::optional<kape::SweepSpec> loadSweepSpec(std::string const& filepath,
+                                             std::string const& contents)
+{
+  {
+    std::ofstream file_out{filepath, std::ios::out | std::ios::trunc};
+    file_out << contents;
+  }
+  return kape::loadSweepSpecFromFile(filepath);
+}
+
+TEST_CASE("Testing expandSweepSpec function")
+{
+  kape::SweepSpec const spec{
+      {"map_1", "map_2"}, {1, 2, 3}, {0, 250}, {0., 0.02}, 10., 1.};
+  std::vector<kape::SweepRun> const runs{kape::expandSweepSpec(spec)};
+
+  SUBCASE("there's a run for every combination")
+  {
+    CHECK(runs.size() == 2 * 3 * 2 * 2);
+  }
+  SUBCASE("the last value changes first")
+  {
+    REQUIRE(runs.size() == 24);
+    CHECK(runs[0].simulation_name == "map_1");
+    CHECK(runs[0].seed == 1);
+    CHECK(runs[0].number_of_ants == 0);
+    CHECK(runs[0].decrease_percentage_amount == 0.);
+    CHECK(runs[1].decrease_percentage_amount == 0.02);
+    CHECK(runs[1].number_of_ants == 0);
+    CHECK(runs[2].number_of_ants == 250);
+    CHECK(runs[2].seed == 1);
+    CHECK(runs[4].seed == 2);
+    CHECK(runs[11].simulation_name == "map_1");
+    CHECK(runs[12].simulation_name == "map_2");
+    CHECK(runs[23].seed == 3);
+    CHECK(runs[23].number_of_ants == 250);
+    CHECK(runs[23].decrease_percentage_amount == 0.02);
+  }
+  SUBCASE("no runs if a parameter has no values")
+  {
+    kape::SweepSpec empty_spec{spec};
+    empty_spec.seeds.clear();
+    CHECK(kape::expandSweepSpec(empty_spec).empty());
+  }
+}
+
+TEST_CASE("Testing loadSweepSpecFromFile function")
+{
+  std::string const filepath{"./sweep_test.txt"};
+
+  SUBCASE("a complete file")
+  {
+    auto const spec{loadSweepSpec(filepath, "maps map_1 map_2\n"
+                                            "seeds 1 2 3\n"
+                                            "ants 0 250\n"
+                                            "evaporation 0 0.02\n"
+                                            "\n"
+                                            "seconds 120\n"
+                                            "sample_period 10\n"
+                                            "END\n")};
+    REQUIRE(spec.has_value());
+    CHECK(spec->simulation_names == std::vector<std::string>{"map_1", "map_2"});
+    CHECK(spec->seeds == std::vector<unsigned int>{1, 2, 3});
+    CHECK(spec->numbers_of_ants == std::vector<std::size_t>{0, 250});
+    CHECK(spec->decrease_percentage_amounts == std::vector<double>{0., 0.02});
+    CHECK(spec->simulated_time == 120.);
+    CHECK(spec->sample_period == 10.);
+  }
+  SUBCASE("the names with spaces are between quotes")
+  {
+    auto const spec{loadSweepSpec(filepath, "maps \"path_check 1\" map_1\n"
+                                            "seeds 1\n"
+                                            "seconds 5\n"
+                                            "END\n")};
+    REQUIRE(spec.has_value());
+    CHECK(spec->simulation_names
+          == std::vector<std::string>{"path_check 1", "map_1"});
+  }
+  SUBCASE("ants, evaporation and sample_period can be omitted")
+  {
+    auto const spec{loadSweepSpec(filepath, "maps map_1\n"
+                                            "seeds 7\n"
+                                            "seconds 30\n"
+                                            "END\n")};
+    REQUIRE(spec.has_value());
+    // the values of the simulation's folder
+    CHECK(spec->numbers_of_ants == std::vector<std::size_t>{0});
+    CHECK(spec->decrease_percentage_amounts == std::vector<double>{0.});
+    // a single sample at the end of the run
+    CHECK(spec->sample_period == 30.);
+  }
+  SUBCASE("a file without END or with an unknown parameter")
+  {
+    CHECK_FALSE(loadSweepSpec(filepath, "maps map_1\n"
+                                        "seeds 1\n"
+                                        "seconds 5\n")
+                    .has_value());
+    CHECK_FALSE(loadSweepSpec(filepath, "maps map_1\n"
+                                        "seeds 1\n"
+                                        "seconds 5\n"
+                                        "threads 4\n"
+                                        "END\n")
+                    .has_value());
+  }
+  SUBCASE("the seeds must be non negative and fit in an unsigned int")
+  {
+    for (std::string seed : {"-1", "4294967296", "1.5", "one"}) {
+      CAPTURE(seed);
+      std::string const contents{"maps map_1\nseeds 1 " + seed
+                                 + "\nseconds 5\nEND\n"};
+      CHECK_FALSE(loadSweepSpec(filepath, contents).has_value());
+    }
+    auto const spec{loadSweepSpec(filepath, "maps map_1\n"
+                                            "seeds 0 4294967295\n"
+                                            "seconds 5\n"
+                                            "END\n")};
+    REQUIRE(spec.has_value());
+    CHECK(spec->seeds == std::vector<unsigned int>{0, 4294967295u});
+  }
+  SUBCASE("the values out of their range")
+  {
+    CHECK_FALSE(loadSweepSpec(filepath, "maps map_1\n"
+                                        "seeds 1\n"
+                                        "evaporation 1.\n"
+                                        "seconds 5\n"
+                                        "END\n")
+                    .has_value());
+    CHECK_FALSE(loadSweepSpec(filepath, "maps map_1\n"
+                                        "seeds 1\n"
+                                        "seconds 0\n"
+                                        "END\n")
+                    .has_value());
+    CHECK_FALSE(loadSweepSpec(filepath, "maps map_1\n"
+                                        "seeds 1\n"
+                                        "seconds 5 10\n"
+                                        "END\n")
+                    .has_value());
+  }
+  SUBCASE("a file that doesn't exist")
+  {
+    CHECK_FALSE(
+        kape::loadSweepSpecFromFile("./this_sweep_does_not_exist.txt")
+            .has_value());
+  }
+
+  std::remove(filepath.c_str());
+}
+
+TEST_CASE("Testing runSweep function")
+{
+  std::string const filepath{"./sweep_results_test.csv"};
+  kape::SweepSpec const spec{
+      {"this map does not exist"}, {4}, {250}, {0.02}, 1., 1.};
+
+  // the run fails, but its row still tells which one it was
+  CHECK_FALSE(kape::runSweep(spec, filepath, 1));
+  std::ifstream file_in{filepath};
+  std::string line;
+  REQUIRE(std::getline(file_in, line));
+  REQUIRE(std::getline(file_in, line));
+  CHECK(line == "0,\"this map does not exist\",4,250,0.02,failed,,,,,,,");
+  CHECK_FALSE(std::getline(file_in, line));
+
+  file_in.close();
+  std::remove(filepath.c_str());
+}
+
+TEST_CASE("Testing parseUnsignedNumber function")
+{
+  CHECK(kape::parseUnsignedNumber<unsigned int>("0") == 0);
+  CHECK(kape::parseUnsignedNumber<unsigned int>("4294967295") == 4294967295u);
+  CHECK(kape::parseUnsignedNumber<std::size_t>("12") == 12);
+  CHECK_THROWS_AS(kape::parseUnsignedNumber<unsigned int>("-1"),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(kape::parseUnsignedNumber<unsigned int>("4294967296"),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(kape::parseUnsignedNumber<std::size_t>("3x"),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(kape::parseUnsignedNumber<std::size_t>(""),
+                  std::invalid_argument);
+}
@@ -0,0 +1,129 @@
+#include "thread_pool.hpp"
+#include <cassert>
+#include <stdexcept> // for std::invalid_argument
+
+namespace kape {
+
+void ThreadPool::executeTasks(std::unique_lock<std::mutex>& lock)
+{
+  while (next_task_ < number_of_tasks_) {
+    std::size_t const task_index{next_task_++};
+    auto const& task{*task_};
+
+    lock.unlock();
+    try {
+      task(task_index);
+    } catch (...) {
+      lock.lock();
+      if (!first_error_) {
+        first_error_ = std::current_exception();
+      }
+      // no point in starting the remaining tasks
+      next_task_ = number_of_tasks_;
+      continue;
+    }
+    lock.lock();
+  }
+}
+
+void ThreadPool::workerLoop()
+{
+  std::unique_lock<std::mutex> lock{mutex_};
+  std::uint64_t last_generation{generation_};
+
+  while (true) {
+    work_available_.wait(
+        lock, [&] { return stopping_ || generation_ != last_generation; });
+    if (stopping_) {
+      return;
+    }
+    last_generation = generation_;
+
+    ++running_workers_;
+    executeTasks(lock);
+    --running_workers_;
+    work_finished_.notify_all();
+  }
+}
+
+// may throw std::invalid_argument if number_of_threads == 0
+ThreadPool::ThreadPool(std::size_t number_of_threads)
+    : workers_{}
+    , mutex_{}
+    , work_available_{}
+    , work_finished_{}
+    , task_{nullptr}
+    , number_of_tasks_{0}
+    , next_task_{0}
+    , running_workers_{0}
+    , generation_{0}
+    , stopping_{false}
+    , first_error_{}
+{
+  if (number_of_threads == 0) {
+    throw std::invalid_argument{"a ThreadPool needs at least one thread"};
+  }
+
+  workers_.reserve(number_of_threads - 1);
+  for (std::size_t i{1}; i < number_of_threads; ++i) {
+    workers_.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::size_t ThreadPool::getNumberOfThreads() const
+{
+  return workers_.size() + 1;
+}
+
+void ThreadPool::run(std::size_t number_of_tasks,
+                     std::function<void(std::size_t)> const& task)
+{
+  if (number_of_tasks == 0) {
+    return;
+  }
+
+  // nothing to distribute: avoid the synchronization altogether
+  if (workers_.empty() || number_of_tasks == 1) {
+    for (std::size_t i{0}; i != number_of_tasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock{mutex_};
+  assert(task_ == nullptr);
+  task_            = &task;
+  number_of_tasks_ = number_of_tasks;
+  next_task_       = 0;
+  first_error_     = nullptr;
+  ++generation_;
+  work_available_.notify_all();
+
+  // the calling thread helps too
+  executeTasks(lock);
+  work_finished_.wait(lock, [this] { return running_workers_ == 0; });
+
+  task_            = nullptr;
+  number_of_tasks_ = 0;
+  next_task_       = 0;
+
+  if (first_error_) {
+    std::exception_ptr error{first_error_};
+    first_error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace kape
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kape {
+
+// fixed set of threads that run the same task over a range of indices
+class ThreadPool
+{
+ private:
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_finished_;
+
+  // state of the current run(), protected by mutex_
+  std::function<void(std::size_t)> const* task_;
+  std::size_t number_of_tasks_;
+  std::size_t next_task_;
+  std::size_t running_workers_;
+  std::uint64_t generation_;
+  bool stopping_;
+  std::exception_ptr first_error_;
+
+  // executes tasks of the current run() until there are none left
+  void executeTasks(std::unique_lock<std::mutex>& lock);
+  void workerLoop();
+
+ public:
+  // number_of_threads counts also the thread calling run(), so a pool with 1
+  // thread runs everything on the caller's thread.
+  // may throw std::invalid_argument if number_of_threads == 0
+  explicit ThreadPool(std::size_t number_of_threads);
+  ThreadPool(ThreadPool const&)            = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+  ~ThreadPool();
+
+  std::size_t getNumberOfThreads() const;
+
+  // calls task(i) once for each i in [0, number_of_tasks), distributing the
+  // calls among the threads, and returns when all of them have returned.
+  // If any call throws, the first exception caught is rethrown here
+  void run(std::size_t number_of_tasks,
+           std::function<void(std::size_t)> const& task);
+};
+
+} // namespace kape
+
+#endif